@@ -0,0 +1,54 @@
+#!/usr/bin/env python3
+#
+# writes thread.json and catalog.json, synthetic pages shaped like
+# 4chan's api output, for jsonscan_bench.cpp. seeded, so the same
+# files come out every time.
+
+import json
+import random
+
+random.seed(1)
+
+
+def post(no, resto, op=False):
+    p = {
+        "no": no,
+        "now": "10/19/26(Mon)12:34:56",
+        "name": "Anonymous",
+        "com": "<a href=\"#p%d\" class=\"quotelink\">&gt;&gt;%d</a><br>" % (no - 1, no - 1)
+               + "lorem ipsum dolor sit amet " * random.randint(1, 12),
+        "time": 1760000000 + no,
+        "resto": resto,
+    }
+    if random.random() < 0.4:
+        p.update({
+            "filename": "image_%d" % no, "ext": ".jpg",
+            "w": 1920, "h": 1080, "tn_w": 250, "tn_h": 140,
+            "tim": 1760000000000 + no, "md5": "abcdefghijklmnopqrstuv==", "fsize": 123456,
+        })
+    if random.random() < 0.3:
+        p.update({"id": "aBcD1234", "country": "CA", "country_name": "Canada"})
+    if op:
+        p.update({
+            "sub": "Thread subject %d" % no, "replies": 300, "images": 120,
+            "bumplimit": 0, "imagelimit": 0, "semantic_url": "thread-subject", "unique_ips": 80,
+        })
+    return p
+
+
+posts = [post(1000, 0, True)] + [post(1000 + i, 1000) for i in range(1, 1500)]
+open("thread.json", "w").write(json.dumps({"posts": posts}))
+
+pages = []
+n = 5000
+for pg in range(10):
+    threads = []
+    for t in range(15):
+        op = post(n, 0, True)
+        n += 100
+        op["omitted_posts"] = 295
+        op["omitted_images"] = 118
+        op["last_replies"] = [post(n + i, op["no"]) for i in range(1, 6)]
+        threads.append(op)
+    pages.append({"page": pg + 1, "threads": threads})
+open("catalog.json", "w").write(json.dumps(pages))
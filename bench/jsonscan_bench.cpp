@@ -0,0 +1,127 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+
+// times gason's jsonParse and JSON_Scan at each simd level on the json
+// files given as arguments, and checks that they build the same DOM.
+// run with 'make bench' (the fixtures come from gen_fixtures.py).
+
+#include "../src/jsonscan.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// parses per timing, the best of the rounds is reported
+static const int RUNS = 50;
+static const int ROUNDS = 5;
+
+
+static bool same_dom(JsonValue a, JsonValue b)
+{
+    if (a.getTag() != b.getTag()) return false;
+
+    switch (a.getTag())
+    {
+        case JSON_NUMBER    : return a.toNumber() == b.toNumber();
+        case JSON_STRING    : return strcmp(a.toString(), b.toString()) == 0;
+        case JSON_ARRAY     :
+        case JSON_OBJECT    :
+        {
+            JsonNode* x = a.toNode();
+            JsonNode* y = b.toNode();
+            for (; x && y; x = x->next, y = y->next)
+            {
+                if (a.getTag() == JSON_OBJECT && strcmp(x->key, y->key) != 0) return false;
+                if (!same_dom(x->value, y->value)) return false;
+            }
+            return !x && !y;
+        }
+        default             : return true;
+    }
+}
+
+
+// -1 for gason, otherwise the simd level. returns ms per parse
+static double time_parse(const std::string& src, int level)
+{
+    double best = 1e9;
+    for (int r = 0; r < ROUNDS; ++r)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < RUNS; ++i)
+        {
+            std::string buf = src;
+            JsonAllocator allocator;
+            JsonValue value;
+            char* endptr;
+
+            if (level < 0)
+            {
+                jsonParse(&buf[0], &endptr, &value, allocator);
+            }
+            else
+            {
+                JSON_Scan::scan(&buf[0], buf.size(), &value, allocator, (JSON_Scan::e_simd_level)level);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count() / RUNS);
+    }
+
+    return best;
+}
+
+
+int main(int argc, char* argv[])
+{
+    static const char* level_names[] = {"scalar", "sse2", "avx2"};
+    int max_level = JSON_Scan::get_simd_level();
+    printf("cpu supports: %s\n", level_names[max_level]);
+
+    int ret = 0;
+    for (int f = 1; f < argc; ++f)
+    {
+        std::ifstream in(argv[f]);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string src = ss.str();
+
+        printf("%s (%zu KB)\n", argv[f], src.size() / 1024);
+        printf("  gason   %.3f ms\n", time_parse(src, -1));
+
+        std::string gason_buf = src;
+        JsonAllocator gason_allocator;
+        JsonValue gason_value;
+        char* endptr;
+        int gason_status = jsonParse(&gason_buf[0], &endptr, &gason_value, gason_allocator);
+
+        for (int level = 0; level <= max_level; ++level)
+        {
+            std::string buf = src;
+            JsonAllocator allocator;
+            JsonValue value;
+            int status = JSON_Scan::scan(&buf[0], buf.size(), &value, allocator, (JSON_Scan::e_simd_level)level);
+
+            bool b_same = status == gason_status &&
+                          (status != JSON_OK || same_dom(value, gason_value));
+            if (!b_same) ret = 1;
+
+            printf("  %-6s  %.3f ms%s\n",
+                level_names[level],
+                time_parse(src, level),
+                b_same ? "" : "  (DOM differs from gason's)");
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,453 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#include "archiver.h"
+#include "netops.h"
+#include "fileops.h"
+#include <cstdio>
+
+
+static const std::string ARCHIVE_JOB_POOL_ID = "ARCHIVE";
+// 4chan api rules: no more than one request per second
+static const std::chrono::milliseconds JSON_REQUEST_INTERVAL(1000);
+// caps the number of queued downloads (and therefore memory)
+static const int MAX_QUEUED_DOWNLOADS = 256;
+
+
+std::atomic<int> Archiver::threads_total(0);
+std::atomic<int> Archiver::threads_done(0);
+std::atomic<int> Archiver::threads_failed(0);
+std::atomic<int> Archiver::files_done(0);
+std::atomic<int> Archiver::files_skipped(0);
+std::atomic<int> Archiver::files_failed(0);
+std::atomic<long long> Archiver::bytes_done(0);
+
+int Archiver::jobs_queued = 0;
+std::mutex Archiver::jobs_mtx;
+std::condition_variable Archiver::jobs_cv;
+
+std::chrono::milliseconds Archiver::start_time(0);
+std::chrono::milliseconds Archiver::last_json_time(0);
+std::chrono::milliseconds Archiver::last_progress_time(0);
+
+
+// each worker thread keeps its own curl handle, so connections
+// to the image server are reused between downloads instead of
+// doing a new tls handshake for every file
+struct archiver_curl_handle
+{
+    archiver_curl_handle()
+    {
+        handle = curl_easy_init();
+    }
+
+    ~archiver_curl_handle()
+    {
+        if (handle)
+        {
+            curl_easy_cleanup(handle);
+        }
+    }
+
+
+    CURL* handle;
+
+
+    CURL* get()
+    {
+        if (handle)
+        {
+            curl_easy_reset(handle);
+        }
+
+        return handle;
+    }
+};
+
+static thread_local archiver_curl_handle curl_handle;
+
+
+int Archiver::run(std::string target)
+{
+    std::string url = target_to_url(target);
+    if (url.empty())
+    {
+        std::cout << "Not a board or thread: " << target << std::endl;
+        return 1;
+    }
+
+    start_time = time_now_ms();
+    last_progress_time = start_time;
+
+    data_4chan chan_data(url);
+    std::cout << "Archiving " << chan_data.parser.url;
+    std::cout << " into " << get_file_save_dir(chan_data.parser) << std::endl;
+
+    if (chan_data.parser.pagetype == e_page_type::pt_thread)
+    {
+        threads_total = 1;
+        archive_thread(url);
+    }
+    else
+    {
+        bool b_changed;
+        if (!get_json(chan_data, "catalog.json", b_changed))
+        {
+            std::cout << "Failed to load the catalog (HTTP response ";
+            std::cout << chan_data.http_response << ")" << std::endl;
+            return 1;
+        }
+
+        std::vector<int> thread_nums;
+        thread_nums.reserve(chan_data.page_data->posts.size());
+        for (auto& p : chan_data.page_data->posts)
+        {
+            thread_nums.push_back(p.num);
+        }
+
+        // the catalog's posts aren't needed anymore
+        chan_data.page_data = nullptr;
+        threads_total = thread_nums.size();
+
+        for (auto& num : thread_nums)
+        {
+            std::string thread_url = "a.4cdn.org/" + chan_data.parser.board;
+            thread_url += "/thread/" + std::to_string(num) + ".json";
+            archive_thread(thread_url);
+            print_progress();
+        }
+    }
+
+    // wait for downloads to finish
+    wait_for_jobs(1);
+    print_progress(true /* b_final */);
+
+    // must not outlive NetOps::shutdown()
+    if (curl_handle.handle)
+    {
+        curl_easy_cleanup(curl_handle.handle);
+        curl_handle.handle = nullptr;
+    }
+
+    // let scripts tell an incomplete mirror from a complete one
+    if (threads_failed > 0 || files_failed > 0 || threads_done == 0)
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
+
+std::string Archiver::target_to_url(std::string target)
+{
+    // just a board, e.g. 'g' or '/g/'
+    std::string board = target;
+    board.erase(
+        std::remove(board.begin(), board.end(), '/'),
+        board.end());
+
+    if (!board.empty() &&
+        board.find('.') == std::string::npos &&
+        std::count(target.begin(), target.end(), '/') <= 2)
+    {
+        return "a.4cdn.org/" + board + "/catalog.json";
+    }
+
+    url_parser parser(target);
+    if (parser.pagetype == e_page_type::pt_thread ||
+        parser.pagetype == e_page_type::pt_board_catalog)
+    {
+        return parser.url;
+    }
+
+    // any other page of a board, e.g. 'boards.4chan.org/g/'
+    if (parser.website == e_website::ws_4chan && !parser.board.empty())
+    {
+        return "a.4cdn.org/" + parser.board + "/catalog.json";
+    }
+
+    return "";
+}
+
+
+bool Archiver::get_json(data_4chan& chan_data, const std::string& file_name, bool& b_changed)
+{
+    if (!chan_data.url_is_valid()) return false;
+
+    std::chrono::milliseconds wait =
+        last_json_time + JSON_REQUEST_INTERVAL - time_now_ms();
+    if (wait.count() > 0)
+    {
+        std::this_thread::sleep_for(wait);
+    }
+    last_json_time = time_now_ms();
+
+    std::string json;
+    long last_mod = FileOps::last_modified(chan_data.file_path + file_name);
+
+    CURL* handle = curl_handle.get();
+    if (!handle) return false;
+
+    curl_easy_setopt(handle, CURLOPT_URL, chan_data.parser.url.c_str());
+    // fail if e.g. http error 404
+    curl_easy_setopt(handle, CURLOPT_FAILONERROR, true);
+    // jsons compress well
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+
+    // only get it again if it has changed since the last run
+    if (last_mod != 0)
+    {
+        curl_easy_setopt(handle, CURLOPT_TIMEVALUE, last_mod);
+        curl_easy_setopt(handle, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
+    }
+
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_string);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, static_cast<void*>(&json));
+    CURLcode success = curl_easy_perform(handle);
+
+    long code = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &code);
+    chan_data.curl_result = success;
+    chan_data.http_response = code;
+
+    if (success != CURLE_OK)
+    {
+        if (code == 404)
+        {
+            chan_data.error_type = et_http_404;
+        }
+
+        return false;
+    }
+
+    long unmet = 0;
+    curl_easy_getinfo(handle, CURLINFO_CONDITION_UNMET, &unmet);
+    b_changed = (unmet != 1);
+
+    if (b_changed)
+    {
+        FileOps::write_file(chan_data.file_path, file_name, json.c_str(), json.size());
+    }
+    else
+    {
+        std::stringstream buf;
+        FileOps::read_file(buf, chan_data.file_path + file_name);
+        json = buf.str();
+    }
+
+    chan_data.fetch_time = time_now_s().count();
+
+    // a mirror keeps the posts the user has filtered out
+    chan_data.page_data->b_apply_filters = false;
+    if (!chan_data.parse_json(std::move(json)))
+    {
+        chan_data.error_type = et_json_parse;
+        return false;
+    }
+
+    return true;
+}
+
+
+void Archiver::archive_thread(std::string url)
+{
+    data_4chan chan_data(url);
+    bool b_changed;
+    if (!get_json(chan_data, "thread.json", b_changed) ||
+        chan_data.page_data->posts.empty())
+    {
+        // e.g. pruned since the catalog was fetched
+        ERR("Archiver: failed to load " + chan_data.parser.url +
+            " (HTTP response " + std::to_string(chan_data.http_response) + ")");
+        threads_failed++;
+        return;
+    }
+
+    std::string board = chan_data.parser.board;
+    std::string thread_num_str = chan_data.parser.thread_num_str;
+
+    // same as Thread4chanWidget::save_to_disk()
+    std::string save_data = chan_data.parser.url;
+    save_data += "\n";
+    save_data += board;
+    save_data += "\n";
+    save_data += thread_num_str;
+    save_data += "\n";
+    save_data += chan_data.page_data->posts[0].subject;
+    save_data += "\n\0";
+    FileOps::write_file(
+        chan_data.file_path, SAVE_FILE, save_data.c_str(), save_data.size());
+
+    for (auto& p : chan_data.page_data->posts)
+    {
+        if (p.img_time == 0 || p.b_img_deleted) continue;
+
+        std::string img_url = "https://i.4cdn.org/" + board + "/";
+        img_url += std::to_string(p.img_time);
+
+        queue_download(img_url + std::string(p.img_ext), thread_num_str, p.img_fsize);
+        // add 's.jpg' to get the thumbnail version of the image
+        queue_download(img_url + "s.jpg", thread_num_str, -1);
+    }
+
+    threads_done++;
+}
+
+
+void Archiver::queue_download(std::string url, std::string thread_num_str, long expected_size)
+{
+    http_image_req req(url, vector2d(), "", thread_num_str, -1);
+    if (!req.url_is_valid()) return;
+
+    std::string file_path = req.get_file_path();
+    std::string file_name = req.get_file_name();
+
+    // already complete on disk
+    long size = FileOps::file_size(file_path + file_name);
+    if (size >= 0 && (expected_size < 0 || size == expected_size))
+    {
+        files_skipped++;
+        return;
+    }
+
+    wait_for_jobs(MAX_QUEUED_DOWNLOADS);
+
+    {
+        std::lock_guard<std::mutex> lock(jobs_mtx);
+        jobs_queued++;
+    }
+
+    THREAD_MAN.enqueue_job(
+        std::bind(download_file, req.parser.url, file_path, file_name, expected_size),
+        ARCHIVE_JOB_POOL_ID,
+        false /* b_push_to_front */);
+}
+
+
+void Archiver::download_file(std::string url, std::string file_path, std::string file_name, long expected_size)
+{
+    bool b_ok = false;
+
+    // written under a temporary name so that an interrupted
+    // download is never mistaken for a complete file
+    FileOps::mkdir(file_path);
+    std::string part = file_path + file_name + ".part";
+    FILE* file = fopen(part.c_str(), "wb");
+    CURL* handle = curl_handle.get();
+
+    if (file && handle)
+    {
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        // fail if e.g. http error 404
+        curl_easy_setopt(handle, CURLOPT_FAILONERROR, true);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_file);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, static_cast<void*>(file));
+        b_ok = curl_easy_perform(handle) == CURLE_OK;
+    }
+
+    if (file)
+    {
+        b_ok = (fclose(file) == 0) && b_ok;
+    }
+
+    if (b_ok && expected_size >= 0)
+    {
+        b_ok = FileOps::file_size(part) == expected_size;
+    }
+
+    if (b_ok && std::rename(part.c_str(), (file_path + file_name).c_str()) == 0)
+    {
+        files_done++;
+    }
+    else
+    {
+        std::remove(part.c_str());
+        files_failed++;
+        ERR("Archiver: failed to download " + url);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(jobs_mtx);
+        jobs_queued--;
+    }
+    jobs_cv.notify_all();
+}
+
+
+void Archiver::wait_for_jobs(int max_jobs)
+{
+    std::unique_lock<std::mutex> lock(jobs_mtx);
+    while (jobs_queued >= max_jobs)
+    {
+        jobs_cv.wait_for(lock, std::chrono::milliseconds(250));
+
+        lock.unlock();
+        print_progress();
+        lock.lock();
+    }
+}
+
+
+void Archiver::print_progress(bool b_final)
+{
+    std::chrono::milliseconds now = time_now_ms();
+    if (!b_final && now - last_progress_time < std::chrono::milliseconds(500))
+    {
+        return;
+    }
+    last_progress_time = now;
+
+    double secs = (now - start_time).count() / 1000.0;
+    if (secs <= 0) secs = 0.001;
+    double mb = bytes_done / (1024.0 * 1024.0);
+
+    if (!b_final)
+    {
+        printf("\rThreads %d/%d | Files %d (%d already saved, %d failed) | %.1f MB, %.2f MB/s   ",
+            threads_done + threads_failed,
+            (int)threads_total,
+            (int)files_done,
+            (int)files_skipped,
+            (int)files_failed,
+            mb,
+            mb / secs);
+        fflush(stdout);
+        return;
+    }
+
+    printf("\rArchived %d of %d threads (%d failed)                                        \n",
+        (int)threads_done, (int)threads_total, (int)threads_failed);
+    printf("Files: %d downloaded, %d already saved, %d failed\n",
+        (int)files_done, (int)files_skipped, (int)files_failed);
+    printf("Downloaded %.1f MB in %.1f s (%.2f MB/s, %.1f files/s)\n",
+        mb, secs, mb / secs, files_done / secs);
+    fflush(stdout);
+}
+
+
+size_t Archiver::curl_write_file(char* buffer, size_t size, size_t nmemb, void* out)
+{
+    // if the function returns less than this value,
+    // curl considers it an error and aborts the download
+    size_t real_size = size * nmemb;
+
+    size_t written = fwrite(buffer, 1, real_size, static_cast<FILE*>(out));
+    bytes_done += written;
+
+    return written;
+}
+
+
+size_t Archiver::curl_write_string(char* buffer, size_t size, size_t nmemb, void* out)
+{
+    size_t real_size = size * nmemb;
+    static_cast<std::string*>(out)->append(buffer, real_size);
+
+    return real_size;
+}
@@ -0,0 +1,77 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#pragma once
+#include "comfy.h"
+#include "threadman.h"
+#include <curl/curl.h>
+#include <condition_variable>
+
+struct data_4chan;
+
+
+// headless mirroring of a board or thread into IMAGEBOARDS_DIR.
+// no termbox, no X11 and no widgets are involved.
+//
+// the calling thread fetches the catalog and thread jsons one after
+// the other (4chan asks for no more than one api request a second),
+// while media downloads run on THREAD_MAN's workers. downloads are
+// streamed straight to disk and the number of queued downloads is
+// capped, so memory use doesn't grow with the size of the board.
+// files that are already complete on disk are skipped, so an
+// interrupted archive can simply be run again.
+class Archiver
+{
+
+public:
+
+    // target is a board (e.g. 'g' or '/g/'), a catalog url or a
+    // thread url. returns the exit code for the process: 1 if a
+    // thread or file failed to download or nothing was archived.
+    static int run(std::string target);
+
+
+protected:
+
+    // counters shared with the worker threads
+    static std::atomic<int> threads_total;
+    static std::atomic<int> threads_done;
+    static std::atomic<int> threads_failed;
+    static std::atomic<int> files_done;
+    static std::atomic<int> files_skipped;
+    static std::atomic<int> files_failed;
+    static std::atomic<long long> bytes_done;
+
+    // downloads that have been queued but haven't finished
+    static int jobs_queued;
+    static std::mutex jobs_mtx;
+    static std::condition_variable jobs_cv;
+
+    static std::chrono::milliseconds start_time;
+    static std::chrono::milliseconds last_json_time;
+    static std::chrono::milliseconds last_progress_time;
+
+    // returns the catalog or thread url for target, "" if invalid
+    static std::string target_to_url(std::string target);
+
+    // fetches a json into the cache. b_changed is false if
+    // the cached json was still current and was read from disk
+    static bool get_json(data_4chan& chan_data, const std::string& file_name, bool& b_changed);
+    static void archive_thread(std::string url);
+    static void queue_download(std::string url, std::string thread_num_str, long expected_size);
+    static void download_file(std::string url, std::string file_path, std::string file_name, long expected_size);
+
+    // blocks until fewer than max_jobs downloads are queued,
+    // printing progress in the meantime
+    static void wait_for_jobs(int max_jobs);
+    static void print_progress(bool b_final = false);
+
+    static size_t curl_write_file(char* buffer, size_t size, size_t nmemb, void* out);
+    static size_t curl_write_string(char* buffer, size_t size, size_t nmemb, void* out);
+
+};
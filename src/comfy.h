@@ -11,6 +11,8 @@
 #include <iostream>
 #include <sstream>
 #include <cctype>
+#include <cstring>
+#include <string_view>
 #include <algorithm>
 #include <memory>
 #include <map>
@@ -26,12 +28,15 @@
 
 #include "stringutils.h"
 #include "htmlutils.h"
+#include "jsonscan.h"
 #include "color.h"
 
 
 #define WIDGET_MAN          WidgetMan::get_instance()
 #define THREAD_MAN          ThreadMan::get_instance()
 #define IMG_MAN             ImgMan::get_instance()
+#define SEARCH_INDEX        SearchIndex::get_instance()
+#define POST_FILTER         PostFilter::get_instance()
 
 
 static const std::string VERSION = "v. 1.0.2";
@@ -41,12 +46,32 @@ extern std::string IMAGEBOARDS_DIR;
 extern std::string TEMP_DIR;
 extern std::string FLAGS_DIR;
 static const std::string SAVE_FILE = ".comfy.save";
+// in DATA_DIR, see PostFilter
+static const std::string FILTERS_FILE = "filters.txt";
 
 static const int POST_IMG_H = 20;   // in term cells
 static const int FLAG_IMG_H = 1;    // in term cells
+// widgets of posts released far from the screen that a thread
+// keeps to build posts from again (see post_tree)
+static const size_t POST_TREE_POOL_SIZE = 16;
+// downloads of a post's images that fail in a way that may
+// pass (e.g. a timeout) before they aren't tried again
+static const int IMG_MAX_TRIES = 3;
 
 extern Colors::color_scheme COLO;
 extern bool DISPLAY_IMAGES;
+// thread images are loaded when their post is within this
+// many rows above or below the visible part of the thread
+extern int IMG_PREFETCH_ROWS;
+// the screen is redrawn at most this many times a second,
+// whatever asked for a redraw in between is drawn together
+extern int MAX_FPS;
+// threads with at least this many posts only build the posts
+// that are on or near the screen (see Post4chanWidget::materialize)
+static const int VIRTUAL_POSTS_MIN = 150;
+// terminal resizes (e.g. while a window border is dragged)
+// are applied once they have stopped for this long
+static const std::chrono::milliseconds RESIZE_DEBOUNCE(150);
 
 
 // Time
@@ -180,6 +205,11 @@ namespace imageboard
 {
     using namespace std;
 
+    // string fields point into the json the post was parsed from, which
+    // is kept alive by the page_data holding the post (see buffers).
+    // a post that outlives its page_data, or is moved to another one,
+    // must take the buffers along (see page_data::add_post), and
+    // anything a widget keeps has to be copied into a std::string.
     struct post
     {
         post()
@@ -195,32 +225,32 @@ namespace imageboard
         
         , num(0)
         , thread_num(0)
-        , subject("")
-        , datetime("")
+        , subject()
+        , datetime()
 
-        , name("")
-        , trip("")
-        , id("")
-        , capcode("")
-        , text("")
+        , name()
+        , trip()
+        , id()
+        , capcode()
+        , text()
 
-        , img_filename("")
-        , img_ext("")
+        , img_filename()
+        , img_ext()
         , img_w(0)
         , img_h(0)
         , img_thumb_w(0)
         , img_thumb_h(0)
         , img_time(0)
-        , img_md5("")
+        , img_md5()
         , img_fsize(0)
 
         , b_img_deleted(false)
         , b_img_spoilered(false)
         , b_custom_spoiler(false)
 
-        , country("")
-        , troll_country("")
-        , country_name("")
+        , country()
+        , troll_country()
+        , country_name()
         {}
 
 
@@ -236,32 +266,32 @@ namespace imageboard
 
         int num;
         int thread_num;     // post num of thread OP
-        string subject;
-        string datetime;
+        string_view subject;
+        string_view datetime;
 
-        string name;
-        string trip;
-        string id;
-        string capcode;
-        string text;
+        string_view name;
+        string_view trip;
+        string_view id;
+        string_view capcode;
+        string_view text;
 
-        string img_filename;
-        string img_ext;
+        string_view img_filename;
+        string_view img_ext;
         int img_w;
         int img_h;
         int img_thumb_w;
         int img_thumb_h;
         int64_t img_time;
-        string img_md5;
+        string_view img_md5;
         int img_fsize;
 
         bool b_img_deleted;
         bool b_img_spoilered;
         bool b_custom_spoiler;
 
-        string country;         // e.g. CA
-        string troll_country;   // e.g. CA ;^)
-        string country_name;    // e.g. Canada
+        string_view country;         // e.g. CA
+        string_view troll_country;   // e.g. CA ;^)
+        string_view country_name;    // e.g. Canada
     };
 
 
@@ -272,6 +302,130 @@ namespace imageboard
     };
 
 
+    // who quotes whom in a thread, indexed as the posts are parsed
+    struct reply_graph
+    {
+        // post -> posts of the thread it quotes, in the order quoted
+        map<int, vector<int>> quotes;
+        // post -> posts quoting it, sorted
+        map<int, vector<int>> replies;
+        // post -> number of quote links to other threads and boards
+        map<int, int> cross_links;
+
+
+        // indexes the quote links in the text of p. a post that
+        // is added again has its old links replaced.
+        void add_post(const post& p)
+        {
+            remove_post(p.num);
+
+            vector<int> quoted;
+            int cross = 0;
+            HTML_Utils::find_quote_links(p.text.data(), p.text.length(), quoted, cross);
+
+            for (int q : quoted)
+            {
+                vector<int>& r = replies[q];
+                auto it = std::lower_bound(r.begin(), r.end(), p.num);
+                if (it == r.end() || *it != p.num)
+                {
+                    r.insert(it, p.num);
+                }
+            }
+
+            if (!quoted.empty())
+            {
+                quotes[p.num] = std::move(quoted);
+            }
+
+            if (cross > 0)
+            {
+                cross_links[p.num] = cross;
+            }
+        }
+
+        void remove_post(int num)
+        {
+            cross_links.erase(num);
+
+            auto it = quotes.find(num);
+            if (it == quotes.end()) return;
+
+            for (int q : it->second)
+            {
+                auto r = replies.find(q);
+                if (r == replies.end()) continue;
+
+                auto num_it = std::lower_bound(r->second.begin(), r->second.end(), num);
+                if (num_it != r->second.end() && *num_it == num)
+                {
+                    r->second.erase(num_it);
+                }
+
+                if (r->second.empty())
+                {
+                    replies.erase(r);
+                }
+            }
+
+            quotes.erase(it);
+        }
+
+        const vector<int>& get_quotes(int num) const
+        {
+            static const vector<int> none;
+            auto it = quotes.find(num);
+            return it != quotes.end() ? it->second : none;
+        }
+
+        const vector<int>& get_replies(int num) const
+        {
+            static const vector<int> none;
+            auto it = replies.find(num);
+            return it != replies.end() ? it->second : none;
+        }
+
+        int get_cross_links(int num) const
+        {
+            auto it = cross_links.find(num);
+            return it != cross_links.end() ? it->second : 0;
+        }
+
+        // num, the posts it quotes and the posts they quote, and so
+        // on up, and the posts quoting it and the posts quoting them,
+        // and so on down. siblings (other replies to a post up the
+        // chain) are left out, or a busy thread would be all chain.
+        set<int> get_chain(int num) const
+        {
+            set<int> chain;
+            chain.insert(num);
+
+            // down the replies, then up the quotes
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                bool b_up = pass == 1;
+                vector<int> open;
+                open.push_back(num);
+                while (!open.empty())
+                {
+                    int n = open.back();
+                    open.pop_back();
+
+                    for (int linked : (b_up ? get_quotes(n) : get_replies(n)))
+                    {
+                        if (chain.insert(linked).second)
+                        {
+                            open.push_back(linked);
+                        }
+                    }
+                }
+            }
+
+            return chain;
+        }
+    };
+
+
     struct page_data
     {
         string url;
@@ -279,10 +433,40 @@ namespace imageboard
         string thread_num_str;      // post num of thread OP
         vector<post> posts;
         vector<board_listing> board_listings;
+        // the parsed json, which the strings of posts point into
+        vector<shared_ptr<const string>> buffers;
+        // quotes between the posts
+        reply_graph graph;
+        // posts the user filters out are left out while parsing
+        bool b_apply_filters = true;
+
+
+        // adds a copy of p, which points into src's buffers
+        void add_post(const post& p, const page_data& src)
+        {
+            posts.push_back(p);
+            graph.add_post(p);
+
+            for (auto& buf : src.buffers)
+            {
+                if (std::find(buffers.begin(), buffers.end(), buf) == buffers.end())
+                {
+                    buffers.push_back(buf);
+                }
+            }
+        }
     };
 };
 
 
+class PostFilterSet;
+// the user's filters (see PostFilter), nullptr if there are none.
+// it locks, so it's fetched once per page rather than per post
+std::shared_ptr<const PostFilterSet> get_post_filters();
+// true if filters hide p
+bool post_is_filtered(const PostFilterSet& filters, const imageboard::post& p, std::string_view board);
+
+
 // JSON
 
 namespace JSON_Utils
@@ -297,160 +481,232 @@ namespace JSON_Utils
     };
 
 
-    static post parse_4chan_post(JsonValue* j)
+    // the json is parsed in place and the strings point into the
+    // buffer, so json_data is moved into buf, which has to be kept
+    // for as long as those strings are used
+    static bool parse_in_place(string json_data, json& json_dom, shared_ptr<string>& buf, bool b_catalog = false)
+    {
+        buf = make_shared<string>(std::move(json_data));
+        int status = JSON_Scan::parse(&(*buf)[0], buf->size(), &(json_dom.value), json_dom.allocator, b_catalog);
+
+        return status == JSON_OK;
+    }
+
+
+    // FNV-1a hash of a json key. the keys of a post are dispatched
+    // on it with a switch, and since two keys hashing to the same
+    // value would be duplicate case labels, the switch only compiles
+    // while the hash is perfect over the keys that are parsed
+    static constexpr uint32_t key_hash(const char* key)
     {
-        post p;
-        if (!j) return p;
+        uint32_t h = 2166136261u;
+        while (*key)
+        {
+            h = (h ^ static_cast<uint8_t>(*key++)) * 16777619u;
+        }
+
+        return h;
+    }
+
+
+    // fills in p, which is usually already in place in page_data.
+    // returns false if filters (from get_post_filters) hide it on
+    // board. posts aren't filtered if filters is nullptr
+    static bool parse_4chan_post(JsonValue* j, post& p, const PostFilterSet* filters = nullptr, std::string_view board = "")
+    {
+        if (!j) return false;
 
         // post data
         for (auto k : *j)
         {
-            string key = k->key;
+            const char* key = k->key;
+            // keys not parsed here (e.g. ones added to the api later)
+            // can still share a hash with one that is, so the key is
+            // compared once to confirm the match
+            auto is = [key](const char* s) { return strcmp(key, s) == 0; };
 
-            if (key.compare("no") == 0)
-            {
-                p.num = k->value.toNumber();
-            }
-            else if (key.compare("resto") == 0)
-            {
-                p.thread_num = k->value.toNumber();
-                if (p.thread_num == 0)
-                {
-                    p.b_op = true;
-                }
-            }
-            else if (key.compare("sticky") == 0)
-            {
-                p.b_sticky = true;
-            }
-            else if (key.compare("closed") == 0)
-            {
-                p.b_closed = true;
-            }
-            else if (key.compare("now") == 0)
-            {
-                p.datetime = k->value.toString();
-            }
-            else if (key.compare("name") == 0)
-            {
-                p.name = k->value.toString();
-            }
-            else if (key.compare("trip") == 0)
-            {
-                p.trip = k->value.toString();
-            }
-            else if (key.compare("id") == 0)
-            {
-                p.id = k->value.toString();
-            }
-            else if (key.compare("capcode") == 0)
-            {
-                p.capcode = k->value.toString();
-            }
-            else if (key.compare("country") == 0)
-            {
-                p.country = k->value.toString();
-            }
-            else if (key.compare("troll_country") == 0)
-            {
-                p.troll_country = k->value.toString();
-            }
-            else if (key.compare("country_name") == 0)
-            {
-                p.country_name = k->value.toString();
-            }
-            else if (key.compare("sub") == 0)
-            {
-                p.subject = k->value.toString();
-            }
-            else if (key.compare("com") == 0)
-            {
-                p.text = k->value.toString();
-            }
-            else if (key.compare("tim") == 0)
+            switch (key_hash(key))
             {
-                p.img_time = k->value.toNumber();
-            }
-            else if (key.compare("filename") == 0)
-            {
-                p.img_filename = k->value.toString();
-            }
-            else if (key.compare("ext") == 0)
-            {
-                p.img_ext = k->value.toString();
-            }
-            else if (key.compare("fsize") == 0)
-            {
-                p.img_fsize = k->value.toNumber();
-            }
-            else if (key.compare("md5") == 0)
-            {
-                p.img_md5 = k->value.toString();
-            }
-            else if (key.compare("w") == 0)
-            {
-                p.img_w = k->value.toNumber();
-            }
-            else if (key.compare("h") == 0)
-            {
-                p.img_h = k->value.toNumber();
-            }
-            else if (key.compare("tn_w") == 0)
-            {
-                p.img_thumb_w = k->value.toNumber();
-            }
-            else if (key.compare("tn_h") == 0)
-            {
-                p.img_thumb_h = k->value.toNumber();
-            }
-            else if (key.compare("filedeleted") == 0)
-            {
-                p.b_img_deleted = true;
-            }
-            else if (key.compare("spoiler") == 0)
-            {
-                p.b_img_spoilered = true;
-            }
-            else if (key.compare("custom_spoiler") == 0)
-            {
-                p.b_custom_spoiler = true;
-            }
-            else if (key.compare("replies") == 0)
-            {
-                p.replies = k->value.toNumber();
-            }
-            else if (key.compare("images") == 0)
-            {
-                p.images = k->value.toNumber();
-            }
-            else if (key.compare("bumplimit") == 0)
-            {
-                p.b_bumplimit = true;
-            }
-            else if (key.compare("imagelimit") == 0)
-            {
-                p.b_imagelimit = true;
-            }
-            else if (key.compare("unique_ips") == 0)
-            {
-                p.unique_ips = k->value.toNumber();
-            }
-            else if (key.compare("archived") == 0)
-            {
-                p.b_archived = true;
+                case key_hash("no"):
+                    if (is("no")) p.num = k->value.toNumber();
+                    break;
+
+                case key_hash("resto"):
+                    if (is("resto"))
+                    {
+                        p.thread_num = k->value.toNumber();
+                        if (p.thread_num == 0)
+                        {
+                            p.b_op = true;
+                        }
+                    }
+                    break;
+
+                case key_hash("sticky"):
+                    if (is("sticky")) p.b_sticky = true;
+                    break;
+
+                case key_hash("closed"):
+                    if (is("closed")) p.b_closed = true;
+                    break;
+
+                case key_hash("now"):
+                    if (is("now")) p.datetime = k->value.toString();
+                    break;
+
+                case key_hash("name"):
+                    if (is("name")) p.name = k->value.toString();
+                    break;
+
+                case key_hash("trip"):
+                    if (is("trip")) p.trip = k->value.toString();
+                    break;
+
+                case key_hash("id"):
+                    if (is("id")) p.id = k->value.toString();
+                    break;
+
+                case key_hash("capcode"):
+                    if (is("capcode")) p.capcode = k->value.toString();
+                    break;
+
+                case key_hash("country"):
+                    if (is("country")) p.country = k->value.toString();
+                    break;
+
+                case key_hash("troll_country"):
+                    if (is("troll_country")) p.troll_country = k->value.toString();
+                    break;
+
+                case key_hash("country_name"):
+                    if (is("country_name")) p.country_name = k->value.toString();
+                    break;
+
+                case key_hash("sub"):
+                    if (is("sub")) p.subject = k->value.toString();
+                    break;
+
+                case key_hash("com"):
+                    if (is("com")) p.text = k->value.toString();
+                    break;
+
+                case key_hash("tim"):
+                    if (is("tim")) p.img_time = k->value.toNumber();
+                    break;
+
+                case key_hash("filename"):
+                    if (is("filename")) p.img_filename = k->value.toString();
+                    break;
+
+                case key_hash("ext"):
+                    if (is("ext")) p.img_ext = k->value.toString();
+                    break;
+
+                case key_hash("fsize"):
+                    if (is("fsize")) p.img_fsize = k->value.toNumber();
+                    break;
+
+                case key_hash("md5"):
+                    if (is("md5")) p.img_md5 = k->value.toString();
+                    break;
+
+                case key_hash("w"):
+                    if (is("w")) p.img_w = k->value.toNumber();
+                    break;
+
+                case key_hash("h"):
+                    if (is("h")) p.img_h = k->value.toNumber();
+                    break;
+
+                case key_hash("tn_w"):
+                    if (is("tn_w")) p.img_thumb_w = k->value.toNumber();
+                    break;
+
+                case key_hash("tn_h"):
+                    if (is("tn_h")) p.img_thumb_h = k->value.toNumber();
+                    break;
+
+                case key_hash("filedeleted"):
+                    if (is("filedeleted")) p.b_img_deleted = true;
+                    break;
+
+                case key_hash("spoiler"):
+                    if (is("spoiler")) p.b_img_spoilered = true;
+                    break;
+
+                case key_hash("custom_spoiler"):
+                    if (is("custom_spoiler")) p.b_custom_spoiler = true;
+                    break;
+
+                case key_hash("replies"):
+                    if (is("replies")) p.replies = k->value.toNumber();
+                    break;
+
+                case key_hash("images"):
+                    if (is("images")) p.images = k->value.toNumber();
+                    break;
+
+                case key_hash("bumplimit"):
+                    if (is("bumplimit")) p.b_bumplimit = true;
+                    break;
+
+                case key_hash("imagelimit"):
+                    if (is("imagelimit")) p.b_imagelimit = true;
+                    break;
+
+                case key_hash("unique_ips"):
+                    if (is("unique_ips")) p.unique_ips = k->value.toNumber();
+                    break;
+
+                case key_hash("archived"):
+                    if (is("archived")) p.b_archived = true;
+                    break;
             }
         }
 
-        return p;
+        return !filters || !post_is_filtered(*filters, p, board);
     }
 
 
-    static bool parse_4chan_boards_list(const char* json_data, page_data& data)
+    // the filters for the posts of data, nullptr if they aren't filtered
+    static shared_ptr<const PostFilterSet> page_filters(const page_data& data)
+    {
+        if (!data.b_apply_filters || data.board.empty()) return nullptr;
+
+        return get_post_filters();
+    }
+
+
+    // parses j into a post at the back of data.posts. a post that
+    // filters hide is taken off again, unless it's the op of a
+    // thread, so it never gets a widget or has its images loaded.
+    // returns true if the post was added.
+    static bool add_4chan_post(JsonValue* j, page_data& data, bool b_thread, const PostFilterSet* filters)
+    {
+        data.posts.emplace_back();
+        post& p = data.posts.back();
+
+        bool b_shown = parse_4chan_post(j, p, filters, data.board);
+        if (!b_shown && !(b_thread && p.b_op))
+        {
+            data.posts.pop_back();
+            return false;
+        }
+
+        if (b_thread)
+        {
+            data.graph.add_post(p);
+        }
+
+        return true;
+    }
+
+
+    static bool parse_4chan_boards_list(string json_data, page_data& data)
     {
         json json_dom;
-        char *endptr;
-        int status = jsonParse(json_data, &endptr, &(json_dom.value), json_dom.allocator);
-        if (status != JSON_OK)
+        shared_ptr<string> buf;
+        if (!parse_in_place(std::move(json_data), json_dom, buf))
         {
             return false;
         }
@@ -469,19 +725,17 @@ namespace JSON_Utils
 
                             for (auto k : j->value)
                             {
-                                string key = k->key;
-
-                                if (key.compare("board") == 0)
+                                if (strcmp(k->key, "board") == 0)
                                 {
                                     b.path = k->value.toString();
                                 }
-                                if (key.compare("title") == 0)
+                                else if (strcmp(k->key, "title") == 0)
                                 {
                                     b.title = k->value.toString();
                                 }
                             }
 
-                            data.board_listings.push_back(b);
+                            data.board_listings.push_back(std::move(b));
                         }
                     }
                 }
@@ -492,34 +746,41 @@ namespace JSON_Utils
     }
 
 
-    static bool parse_4chan_thread(const char* json_data, page_data& data)
+    static bool parse_4chan_thread(string json_data, page_data& data)
     {
         json json_dom;
-        char *endptr;
-        int status = jsonParse(json_data, &endptr, &(json_dom.value), json_dom.allocator);
-        if (status != JSON_OK)
+        shared_ptr<string> buf;
+        if (!parse_in_place(std::move(json_data), json_dom, buf))
         {
             return false;
         }
+        // the posts' strings point into it
+        data.buffers.push_back(buf);
 
         if (json_dom.value.getTag() == JSON_OBJECT)
         {
             for (auto i : json_dom.value)
             {
-                string key = i->key;
-
                 // posts array
-                if (key.compare("posts") == 0)
+                if (strcmp(i->key, "posts") == 0)
                 {
                     if (i->value.getTag() == JSON_ARRAY)
                     {
+                        // count first, so posts are never moved around
+                        size_t count = data.posts.size();
+                        for (auto j : i->value)
+                        {
+                            if (j->value.getTag() == JSON_OBJECT) count++;
+                        }
+                        data.posts.reserve(count);
+
+                        auto filters = page_filters(data);
                         for (auto j : i->value)
                         {
-                            // post
+                            // post, parsed in place
                             if (j->value.getTag() == JSON_OBJECT)
                             {
-                                post p = parse_4chan_post(&j->value);
-                                data.posts.push_back(p);
+                                add_4chan_post(&j->value, data, true /* b_thread */, filters.get());
                             }
                         }
                     }
@@ -531,18 +792,37 @@ namespace JSON_Utils
     }
 
 
-    static bool parse_4chan_catalog(const char* json_data, page_data& data)
+    static bool parse_4chan_catalog(string json_data, page_data& data)
     {
         json json_dom;
-        char *endptr;
-        int status = jsonParse(json_data, &endptr, &(json_dom.value), json_dom.allocator);
-        if (status != JSON_OK)
+        shared_ptr<string> buf;
+        if (!parse_in_place(std::move(json_data), json_dom, buf, true /* b_catalog */))
         {
             return false;
         }
+        // the posts' strings point into it
+        data.buffers.push_back(buf);
 
         if (json_dom.value.getTag() == JSON_ARRAY)
         {
+            // count the threads on all pages first,
+            // so posts are never moved around
+            size_t count = data.posts.size();
+            for (auto i : json_dom.value)
+            {
+                if (i->value.getTag() != JSON_OBJECT) continue;
+
+                for (auto j : i->value)
+                {
+                    if (strcmp(j->key, "threads") == 0)
+                    {
+                        for (auto k : j->value) { (void)k; count++; }
+                    }
+                }
+            }
+            data.posts.reserve(count);
+
+            auto filters = page_filters(data);
             // catalog pages
             for (auto i : json_dom.value)
             {
@@ -551,14 +831,13 @@ namespace JSON_Utils
                     // items in page object
                     for (auto j : i->value)
                     {
-                        string key = j->key;
                         // threads array (they are posts)
-                        if (key.compare("threads") == 0)
+                        if (strcmp(j->key, "threads") == 0)
                         {
                             for (auto k : j->value)
                             {
-                                post p = parse_4chan_post(&k->value);
-                                data.posts.push_back(p);
+                                // parsed in place
+                                add_4chan_post(&k->value, data, false /* b_thread */, filters.get());
                             }
                         }
                     }
@@ -569,6 +848,178 @@ namespace JSON_Utils
         return true;
     }
 
+
+    // splits a thread or catalog json into posts while it is being
+    // received, so the posts that have arrived can be shown before
+    // the rest of the page. the bytes are only scanned for string
+    // quotes and brackets here; a post is parsed once its closing
+    // brace is in.
+    struct post_stream
+    {
+        // post_depth is the nesting level of the post objects,
+        // 3 in a thread ({"posts":[{...}]}) and 4 in a catalog
+        // ([{"threads":[{...}]}])
+        post_stream(int _post_depth)
+        : post_depth(_post_depth)
+        , scan_pos(0)
+        , depth(0)
+        , post_start(0)
+        , b_in_string(false)
+        , b_done(false)
+        , b_failed(false)
+        {}
+
+
+        // the json received so far
+        string received;
+
+
+        // appends the next part of the json
+        void feed(const char* data, size_t len)
+        {
+            received.append(data, len);
+            scan();
+        }
+
+        // the root value has been closed
+        bool done() const { return b_done && !b_failed; };
+        bool failed() const { return b_failed; };
+        // posts have been completed since the last take_posts
+        bool has_posts() const { return !slices.empty(); };
+
+        // parses the posts completed since the last call and adds
+        // them to data. they are parsed from one copy of their slices
+        // of received, which data keeps in its buffers.
+        // returns false on a parse error.
+        bool take_posts(page_data& data)
+        {
+            if (slices.empty()) return !b_failed;
+
+            string batch;
+            size_t len = 1 + slices.size();
+            for (auto& s : slices)
+            {
+                len += s.second - s.first;
+            }
+            batch.reserve(len);
+
+            batch += '[';
+            for (size_t i = 0; i < slices.size(); ++i)
+            {
+                if (i > 0) batch += ',';
+                batch.append(received, slices[i].first, slices[i].second - slices[i].first);
+            }
+            batch += ']';
+            slices.clear();
+
+            json dom;
+            shared_ptr<string> buf;
+            if (!parse_in_place(std::move(batch), dom, buf, post_depth != 3 /* b_catalog */) ||
+                dom.value.getTag() != JSON_ARRAY)
+            {
+                b_failed = true;
+                return false;
+            }
+            // the posts' strings point into it
+            data.buffers.push_back(buf);
+
+            auto filters = page_filters(data);
+            for (auto i : dom.value)
+            {
+                if (i->value.getTag() == JSON_OBJECT)
+                {
+                    add_4chan_post(&i->value, data, post_depth == 3 /* thread */, filters.get());
+                }
+            }
+
+            return true;
+        }
+
+
+    protected:
+
+        int post_depth;
+        // next byte of json to look at
+        size_t scan_pos;
+        int depth;
+        size_t post_start;
+        bool b_in_string;
+        bool b_done;
+        bool b_failed;
+        // [begin, end) of completed posts in received
+        vector<pair<size_t, size_t>> slices;
+
+
+        void scan()
+        {
+            const char* s = received.data();
+            size_t len = received.size();
+            size_t i = scan_pos;
+
+            while (i < len && !b_done && !b_failed)
+            {
+                if (b_in_string)
+                {
+                    const char* q = static_cast<const char*>(memchr(s + i, '"', len - i));
+                    if (!q)
+                    {
+                        i = len;
+                        break;
+                    }
+                    i = q - s;
+
+                    // an odd number of backslashes escapes the quote.
+                    // they may have come in with an earlier part, but
+                    // received still holds them
+                    size_t b = i;
+                    while (b > 0 && s[b - 1] == '\\') --b;
+                    if ((i - b) % 2 == 0)
+                    {
+                        b_in_string = false;
+                    }
+                    ++i;
+                    continue;
+                }
+
+                switch (s[i])
+                {
+                    case '"':
+                        b_in_string = true;
+                        break;
+
+                    case '{':
+                    case '[':
+                        ++depth;
+                        if (depth == post_depth && s[i] == '{')
+                        {
+                            post_start = i;
+                        }
+                        break;
+
+                    case '}':
+                    case ']':
+                        if (depth == post_depth && s[i] == '}')
+                        {
+                            slices.emplace_back(post_start, i + 1);
+                        }
+                        --depth;
+                        if (depth == 0)
+                        {
+                            b_done = true;
+                        }
+                        else if (depth < 0)
+                        {
+                            b_failed = true;
+                        }
+                        break;
+                }
+                ++i;
+            }
+
+            scan_pos = i;
+        }
+    };
+
 };
 
 
@@ -737,67 +1188,49 @@ struct vector4d
 };
 
 
-struct term_cell
+// formatting of a stretch of cells: colors, and termbox
+// attributes (TB_BOLD, TB_UNDERLINE, TB_REVERSE)
+struct style_run
 {
-    term_cell()
-    : coord(vector2d())
-    {
-        tb_data.ch = TB_NULL_CHAR;
-        tb_data.bg = 0;
-        tb_data.fg = 0;
-    }
-
-    term_cell(
-        vector2d _coord)
-    : coord(_coord)
-    {
-        tb_data.ch = TB_NULL_CHAR;
-        tb_data.bg = 0;
-        tb_data.fg = 0;
-    }
-
-    term_cell(
-        tb_cell _tb_data,
-        vector2d _coord
-    )
-    : tb_data(_tb_data)
-    , coord(_coord)
+    style_run(int _start = 0, int _length = 0, uint32_t _bg = 0, uint32_t _fg = 15, uint32_t _attrs = 0)
+    : start(_start)
+    , length(_length)
+    , bg(_bg)
+    , fg(_fg)
+    , attrs(_attrs)
     {}
 
+    int start;
+    int length;
+    uint32_t bg;
+    uint32_t fg;
+    uint32_t attrs;
 
-    tb_cell tb_data;
-    vector2d coord;
-
+    int end() const { return start + length; };
+};
 
-    inline void operator=(const term_cell& other)
-    {
-        coord = other.coord;
-        tb_data.ch = other.tb_data.ch;
-        tb_data.bg = other.tb_data.bg;
-        tb_data.fg = other.tb_data.fg;
-    }
 
-    bool is_null() const
-    {
-        return tb_data.ch == TB_NULL_CHAR;
-    }
-};
+static inline uint32_t make_attrs(bool b_bold, bool b_underline, bool b_reverse)
+{
+    return (b_bold ? TB_BOLD : 0) |
+           (b_underline ? TB_UNDERLINE : 0) |
+           (b_reverse ? TB_REVERSE : 0);
+}
 
 
 struct term_word
 {
     term_word()
-    : text(std::wstring())
+    : text(std::string())
     , bg(0)
     , fg(15)
-    , b_bold(false)
-    , b_underline(false)
-    , b_reverse(false)
+    , attrs(0)
     , b_newline(false)
+    , quote_num(-1)
     {}
 
     term_word(
-        std::wstring _text,
+        std::string _text,
         uint32_t _bg,
         uint32_t _fg,
         bool _b_bold = false,
@@ -807,14 +1240,13 @@ struct term_word
     : text(_text)
     , bg(_bg)
     , fg(_fg)
-    , b_bold(_b_bold)
-    , b_underline(_b_underline)
-    , b_reverse(_b_reverse)
+    , attrs(make_attrs(_b_bold, _b_underline, _b_reverse))
     , b_newline(false)
+    , quote_num(-1)
     {}
 
     term_word(
-        wchar_t* _text,
+        const char* _text,
         uint32_t _bg,
         uint32_t _fg,
         bool _b_bold = false,
@@ -824,19 +1256,20 @@ struct term_word
     : text(_text)
     , bg(_bg)
     , fg(_fg)
-    , b_bold(_b_bold)
-    , b_underline(_b_underline)
-    , b_reverse(_b_reverse)
+    , attrs(make_attrs(_b_bold, _b_underline, _b_reverse))
     , b_newline(false)
+    , quote_num(-1)
     {}
 
-    std::wstring text;
+    // utf-8
+    std::string text;
+    // the whole word is in one style
     uint32_t bg;
     uint32_t fg;
-    bool b_bold;
-    bool b_underline;
-    bool b_reverse;
+    uint32_t attrs;
     bool b_newline;
+    // post in the thread the word quotes, or -1
+    int quote_num;
 
     static term_word newline()
     {
@@ -850,10 +1283,9 @@ struct term_word
         text = other.text;
         bg = other.bg;
         fg = other.fg;
-        b_bold = other.b_bold;
-        b_underline = other.b_underline;
-        b_reverse = other.b_reverse;
+        attrs = other.attrs;
         b_newline = other.b_newline;
+        quote_num = other.quote_num;
     }
 };
 
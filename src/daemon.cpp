@@ -0,0 +1,982 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#include "daemon.h"
+#include "netops.h"
+#include "fileops.h"
+#include "imgman.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+// seconds a page counts as up to date after it was checked,
+// requests in that time are answered from the cache
+static const long PAGE_WARM_TIME = 5;
+// seconds a page stays on the watch list after it was last requested
+static const long PAGE_WATCH_TIME = 600;
+// bytes a client can fall behind by before it's dropped
+static const size_t CLIENT_OUT_BUF_MAX = 1 << 20;
+// seconds between refreshes of watched pages
+static const long THREAD_REFRESH_INTERVAL = 10;
+static const long CATALOG_REFRESH_INTERVAL = 60;
+
+
+// returns a connected socket, or -1 if no daemon is listening
+static int connect_socket()
+{
+    std::string sock_path = Daemon::get_socket_path();
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (sock_path.length() >= sizeof(addr.sun_path)) return -1;
+    strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    if (::connect(fd, (sockaddr*) &addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+static bool send_all(int fd, const std::string& data)
+{
+    size_t sent = 0;
+    while (sent < data.length())
+    {
+        // MSG_NOSIGNAL: a closed peer is an error, not SIGPIPE
+        ssize_t n = send(fd, data.c_str() + sent, data.length() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += n;
+    }
+
+    return true;
+}
+
+
+// json event line, see daemon.h
+static std::string json_event(const std::string& url, long fetch_time, int error_type, long http_response, int curl_result)
+{
+    std::string line = "JSON ";
+    line += std::to_string(fetch_time) + " ";
+    line += std::to_string(error_type) + " ";
+    line += std::to_string(http_response) + " ";
+    line += std::to_string(curl_result) + " ";
+    line += url;
+
+    return line;
+}
+
+
+  ////////////
+ // Daemon //
+////////////
+
+bool Daemon::b_run = false;
+int Daemon::listen_fd = -1;
+int Daemon::wake_pipe[2] = { -1, -1 };
+std::map<int, Daemon::client_state> Daemon::clients;
+std::map<std::string, Daemon::page_state> Daemon::pages;
+std::map<std::string, Daemon::image_state> Daemon::images;
+threadsafe_queue<Daemon::fetch_result> Daemon::results;
+
+
+std::string Daemon::get_socket_path()
+{
+    return DATA_DIR + "comfy.sock";
+}
+
+
+bool Daemon::is_running()
+{
+    int fd = connect_socket();
+    if (fd < 0) return false;
+
+    close(fd);
+    return true;
+}
+
+
+int Daemon::run()
+{
+    std::string sock_path = get_socket_path();
+
+    if (is_running())
+    {
+        ERR("DAEMON ERROR: a daemon is already running");
+        return 1;
+    }
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (sock_path.length() >= sizeof(addr.sun_path))
+    {
+        ERR("DAEMON ERROR: socket path is too long: " + sock_path);
+        return 1;
+    }
+    strncpy(addr.sun_path, sock_path.c_str(), sizeof(addr.sun_path) - 1);
+
+    // left over by a daemon that didn't exit cleanly
+    unlink(sock_path.c_str());
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 ||
+        bind(listen_fd, (sockaddr*) &addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 16) != 0)
+    {
+        ERR("DAEMON ERROR: could not listen on " + sock_path);
+        if (listen_fd >= 0) close(listen_fd);
+        return 1;
+    }
+    // only the user's own UIs can attach
+    chmod(sock_path.c_str(), S_IRUSR | S_IWUSR);
+
+    if (pipe(wake_pipe) != 0)
+    {
+        ERR("DAEMON ERROR: could not create pipe");
+        close(listen_fd);
+        unlink(sock_path.c_str());
+        return 1;
+    }
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+    b_run = true;
+    while (b_run)
+    {
+        std::vector<pollfd> fds;
+        fds.push_back({ listen_fd, POLLIN, 0 });
+        fds.push_back({ wake_pipe[0], POLLIN, 0 });
+        for (auto& c : clients)
+        {
+            short events = POLLIN;
+            if (!c.second.out_buf.empty()) events |= POLLOUT;
+            fds.push_back({ c.first, events, 0 });
+        }
+
+        int n = poll(fds.data(), fds.size(), 1000);
+        if (n < 0 && errno != EINTR)
+        {
+            ERR("DAEMON ERROR: poll failed");
+            break;
+        }
+
+        if (n > 0)
+        {
+            if (fds[0].revents & POLLIN)
+            {
+                accept_client();
+            }
+
+            if (fds[1].revents & POLLIN)
+            {
+                char buf[64];
+                while (read(wake_pipe[0], buf, sizeof(buf)) > 0);
+            }
+
+            for (size_t i = 2; i < fds.size(); ++i)
+            {
+                auto it = clients.find(fds[i].fd);
+                if (it == clients.end()) continue;
+
+                if (fds[i].revents & POLLOUT)
+                {
+                    flush_client(it->first, it->second);
+                }
+
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+                {
+                    if (!read_client(fds[i].fd))
+                    {
+                        it->second.b_gone = true;
+                    }
+                }
+            }
+        }
+
+        fetch_result result;
+        while (results.try_pop(result, std::chrono::milliseconds(0)))
+        {
+            handle_result(result);
+        }
+
+        refresh_watched();
+
+        // dropped here rather than where they failed, as that
+        // can be in the middle of going over the page subscribers
+        for (auto it = clients.begin(); it != clients.end();)
+        {
+            int fd = it->first;
+            bool b_gone = it->second.b_gone;
+            ++it;
+            if (b_gone) drop_client(fd);
+        }
+    }
+
+    while (!clients.empty())
+    {
+        drop_client(clients.begin()->first);
+    }
+
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(sock_path.c_str());
+    // the pipe is left open for the process exit, as
+    // jobs that are still running may write to it
+
+    return 0;
+}
+
+
+void Daemon::accept_client()
+{
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) return;
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    clients[fd] = client_state();
+}
+
+
+void Daemon::drop_client(int fd)
+{
+    close(fd);
+    clients.erase(fd);
+
+    for (auto& p : pages)
+    {
+        page_state& page = p.second;
+        page.subscribers.erase(fd);
+
+        for (auto it = page.waiters.begin(); it != page.waiters.end();)
+        {
+            if (it->fd == fd)
+            {
+                it = page.waiters.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    for (auto& i : images)
+    {
+        auto& waiters = i.second.waiters;
+        waiters.erase(std::remove(waiters.begin(), waiters.end(), fd), waiters.end());
+    }
+}
+
+
+// returns false if the client has gone
+bool Daemon::read_client(int fd)
+{
+    char buf[4096];
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return true;
+    }
+    if (n <= 0) return false;
+
+    std::string& in_buf = clients[fd].in_buf;
+    in_buf.append(buf, n);
+
+    size_t pos;
+    while ((pos = in_buf.find('\n')) != std::string::npos)
+    {
+        std::string line = in_buf.substr(0, pos);
+        in_buf.erase(0, pos + 1);
+        handle_line(fd, line);
+    }
+
+    // no sane request is this long
+    if (in_buf.length() > 65536) return false;
+
+    return true;
+}
+
+
+void Daemon::handle_line(int fd, const std::string& line)
+{
+    std::istringstream in(line);
+    std::string cmd;
+    in >> cmd;
+
+    if (cmd.compare("JSON") == 0)
+    {
+        long last_fetch_time = 0;
+        std::string url;
+        in >> last_fetch_time >> url;
+        request_page(fd, url, last_fetch_time);
+    }
+    else if (cmd.compare("IMG") == 0)
+    {
+        std::string thread_num_str;
+        std::string url;
+        in >> thread_num_str >> url;
+        if (thread_num_str.compare("-") == 0) thread_num_str = "";
+        request_image(fd, url, thread_num_str);
+    }
+    else if (cmd.compare("QUIT") == 0)
+    {
+        b_run = false;
+    }
+}
+
+
+void Daemon::request_page(int fd, std::string url, long last_fetch_time)
+{
+    data_4chan chan_data(url);
+    if (!chan_data.url_is_valid())
+    {
+        send_line(fd, json_event(url, 0, et_invalid_url, -1, -1));
+        return;
+    }
+
+    url = chan_data.parser.url;
+    long now = time_now_s().count();
+
+    page_state& page = pages[url];
+    page.pagetype = chan_data.parser.pagetype;
+    page.last_request = now;
+    if (page.pagetype == e_page_type::pt_thread ||
+        page.pagetype == e_page_type::pt_board_catalog)
+    {
+        page.subscribers.insert(fd);
+    }
+
+    // checked a moment ago (e.g. by another UI), answer from the cache
+    if (!page.b_in_flight &&
+        page.last_fetch != 0 &&
+        now - page.last_fetch < PAGE_WARM_TIME &&
+        (page.error_type != et_NONE ||
+         FileOps::file_exists(chan_data.file_path + chan_data.get_file_name())))
+    {
+        send_page(fd, url, page, last_fetch_time);
+        return;
+    }
+
+    page.waiters.push_back({ fd, last_fetch_time });
+
+    // requests for a page that is already on its way share the fetch
+    if (!page.b_in_flight)
+    {
+        page.b_in_flight = true;
+        THREAD_MAN.enqueue_job(
+            std::bind(fetch_page, url),
+            DEFAULT_JOB_POOL_ID,
+            true /* b_push_to_front */);
+    }
+}
+
+
+void Daemon::request_image(int fd, std::string url, std::string thread_num_str)
+{
+    http_image_req req(url, vector2d(), "", thread_num_str, -1);
+    if (!req.url_is_valid())
+    {
+        send_line(fd, "IMG 0 " + std::to_string(et_invalid_url) + " -1 -1 " + url);
+        return;
+    }
+
+    image_state& img = images[url];
+    img.waiters.push_back(fd);
+
+    if (!img.b_in_flight)
+    {
+        img.b_in_flight = true;
+        THREAD_MAN.enqueue_job(
+            std::bind(fetch_image, url, req.get_file_path(), req.get_file_name()),
+            DEFAULT_JOB_POOL_ID,
+            true /* b_push_to_front */);
+    }
+}
+
+
+void Daemon::refresh_watched()
+{
+    long now = time_now_s().count();
+
+    for (auto it = pages.begin(); it != pages.end();)
+    {
+        page_state& page = it->second;
+
+        if (page.b_in_flight)
+        {
+            ++it;
+            continue;
+        }
+
+        // no UI has asked for it in a while
+        if (now - page.last_request > PAGE_WATCH_TIME)
+        {
+            it = pages.erase(it);
+            continue;
+        }
+
+        long interval = page.pagetype == e_page_type::pt_thread ?
+            THREAD_REFRESH_INTERVAL : CATALOG_REFRESH_INTERVAL;
+
+        // 404'd threads aren't coming back
+        if (!page.subscribers.empty() &&
+            page.error_type != et_http_404 &&
+            now - page.last_fetch >= interval)
+        {
+            page.b_in_flight = true;
+            THREAD_MAN.enqueue_job(
+                std::bind(fetch_page, it->first),
+                DEFAULT_JOB_POOL_ID,
+                false /* b_push_to_front */);
+        }
+
+        ++it;
+    }
+}
+
+
+void Daemon::handle_result(fetch_result& result)
+{
+    if (result.b_image)
+    {
+        auto it = images.find(result.url);
+        if (it == images.end()) return;
+
+        bool b_ok = result.error_type == et_NONE && result.curl_result == CURLE_OK;
+        std::string line = "IMG ";
+        line += b_ok ? "1 " : "0 ";
+        line += std::to_string(result.error_type) + " ";
+        line += std::to_string(result.http_response) + " ";
+        line += std::to_string(result.curl_result) + " ";
+        line += result.url;
+
+        for (int fd : it->second.waiters)
+        {
+            send_line(fd, line);
+        }
+
+        images.erase(it);
+        return;
+    }
+
+    auto it = pages.find(result.url);
+    if (it == pages.end()) return;
+
+    page_state& page = it->second;
+    page.b_in_flight = false;
+    page.last_fetch = time_now_s().count();
+    page.error_type = result.error_type;
+    page.http_response = result.http_response;
+    page.curl_result = result.curl_result;
+    if (result.error_type == et_NONE)
+    {
+        page.last_change = result.fetch_time;
+    }
+
+    std::set<int> answered;
+    for (auto& w : page.waiters)
+    {
+        send_page(w.fd, result.url, page, w.last_fetch_time);
+        answered.insert(w.fd);
+    }
+    page.waiters.clear();
+
+    // push the change to every other UI that has the page open
+    if (result.b_changed)
+    {
+        for (int fd : page.subscribers)
+        {
+            if (answered.find(fd) == answered.end())
+            {
+                send_page(fd, result.url, page, 0);
+            }
+        }
+    }
+}
+
+
+void Daemon::send_page(int fd, const std::string& url, const page_state& page, long last_fetch_time)
+{
+    if (page.error_type != et_NONE)
+    {
+        send_line(fd, json_event(url, 0, page.error_type, page.http_response, page.curl_result));
+    }
+    // the client already has this version
+    else if (last_fetch_time != 0 && last_fetch_time >= page.last_change)
+    {
+        send_line(fd, json_event(url, last_fetch_time, et_not_mod_since, page.http_response, page.curl_result));
+    }
+    else
+    {
+        send_line(fd, json_event(url, page.last_change, et_NONE, page.http_response, page.curl_result));
+    }
+}
+
+
+void Daemon::fetch_page(std::string url)
+{
+    fetch_result result;
+    result.url = url;
+
+    data_4chan chan_data(url);
+    std::string f_name = chan_data.get_file_name();
+    long last_mod = FileOps::last_modified(chan_data.file_path + f_name);
+
+    std::stringstream out_buf;
+    long code = 0;
+    bool b_unmet = false;
+    CURLcode success = NetOps::curl__get(
+        chan_data.parser.url, out_buf, last_mod, code, b_unmet);
+
+    result.http_response = code;
+    result.curl_result = success;
+
+    if (code == 404)
+    {
+        result.error_type = et_http_404;
+    }
+    else if (success == CURLE_OK && !b_unmet)
+    {
+        // don't let a broken response replace a good cache
+        if (!chan_data.parse_json(out_buf.str()))
+        {
+            result.error_type = et_json_parse;
+        }
+        else
+        {
+            FileOps::write_file_atomic(chan_data.file_path, f_name, out_buf.str().c_str(), out_buf.str().length());
+            result.fetch_time = FileOps::last_modified(chan_data.file_path + f_name);
+            result.b_changed = true;
+        }
+    }
+    // not modified, or the network failed and the cache is all there is
+    else
+    {
+        result.fetch_time = last_mod;
+    }
+
+    push_result(result);
+}
+
+
+void Daemon::fetch_image(std::string url, std::string file_path, std::string file_name)
+{
+    fetch_result result;
+    result.b_image = true;
+    result.url = url;
+
+    // e.g. fetched for another UI while this request was queued
+    if (FileOps::file_exists(file_path + file_name))
+    {
+        result.curl_result = CURLE_OK;
+    }
+    else
+    {
+        std::stringstream out_buf;
+        long code = 0;
+        bool b_unmet = false;
+        CURLcode success = NetOps::curl__get(url, out_buf, 0, code, b_unmet);
+
+        result.http_response = code;
+        result.curl_result = success;
+
+        // as in NetOps, only a 404 has an error type of its own,
+        // other failures are told apart by the response and result
+        if (code == 404)
+        {
+            result.error_type = et_http_404;
+        }
+
+        if (success == CURLE_OK)
+        {
+            FileOps::write_file_atomic(file_path, file_name, out_buf.str().c_str(), out_buf.str().length());
+        }
+    }
+
+    push_result(result);
+}
+
+
+void Daemon::push_result(fetch_result& result)
+{
+    results.push(result);
+
+    // wake up poll()
+    char c = 1;
+    write(wake_pipe[1], &c, 1);
+}
+
+
+void Daemon::send_line(int fd, const std::string& line)
+{
+    auto it = clients.find(fd);
+    if (it == clients.end() || it->second.b_gone) return;
+
+    client_state& client = it->second;
+    client.out_buf += line;
+    client.out_buf += '\n';
+    flush_client(fd, client);
+
+    // the UI isn't reading, e.g. it is stopped
+    if (client.out_buf.length() > CLIENT_OUT_BUF_MAX)
+    {
+        client.b_gone = true;
+    }
+}
+
+
+void Daemon::flush_client(int fd, client_state& client)
+{
+    size_t sent = 0;
+    while (sent < client.out_buf.length())
+    {
+        // MSG_NOSIGNAL: a closed peer is an error, not SIGPIPE
+        ssize_t n = send(fd, client.out_buf.c_str() + sent, client.out_buf.length() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        // the rest goes when poll() says there is room
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n <= 0)
+        {
+            client.b_gone = true;
+            break;
+        }
+        sent += n;
+    }
+
+    client.out_buf.erase(0, sent);
+}
+
+
+  //////////////////
+ // DaemonClient //
+//////////////////
+
+std::atomic<bool> DaemonClient::b_attached(false);
+int DaemonClient::sock = -1;
+std::thread DaemonClient::reader;
+std::mutex DaemonClient::mtx;
+std::mutex DaemonClient::send_mtx;
+std::multimap<std::string, DaemonClient::pending_json> DaemonClient::pending_jsons;
+std::multimap<std::string, DaemonClient::pending_image> DaemonClient::pending_images;
+
+
+bool DaemonClient::connect()
+{
+    if (b_attached) return true;
+
+    sock = connect_socket();
+    if (sock < 0) return false;
+
+    b_attached = true;
+    reader = std::thread(read_loop);
+
+    return true;
+}
+
+
+void DaemonClient::disconnect()
+{
+    if (sock < 0) return;
+
+    b_attached = false;
+    // wakes up the reader
+    shutdown(sock, SHUT_RDWR);
+    if (reader.joinable())
+    {
+        reader.join();
+    }
+
+    close(sock);
+    sock = -1;
+}
+
+
+bool DaemonClient::stop_daemon()
+{
+    int fd = connect_socket();
+    if (fd < 0) return false;
+
+    send_all(fd, "QUIT\n");
+    close(fd);
+
+    return true;
+}
+
+
+void DaemonClient::request_json(std::string url, std::string wgt_id, bool b_steal_focus, long last_fetch_time)
+{
+    data_4chan chan_data(url, wgt_id);
+    // error: invalid url
+    if (!chan_data.url_is_valid())
+    {
+        chan_data.error_type = e_error_type::et_invalid_url;
+        NetOps::queue__4chan_json.push(chan_data);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        pending_jsons.insert({ chan_data.parser.url, { chan_data.wgt_id, b_steal_focus } });
+    }
+
+    std::string line = "JSON ";
+    line += std::to_string(last_fetch_time) + " ";
+    line += chan_data.parser.url;
+
+    if (!send_line(line))
+    {
+        fall_back();
+    }
+}
+
+
+bool DaemonClient::request_image(http_image_req& req, std::string job_pool_id)
+{
+    // e.g. flags, which are kept outside of the page dirs
+    if (!req.custom_file_path.empty() || !req.custom_file_name.empty())
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        pending_image img;
+        img.size = req.size;
+        img.thread_key = req.thread_key;
+        img.post_key = req.post_key;
+        img.thread_num_str = req.thread_num_str;
+        img.job_pool_id = job_pool_id;
+        pending_images.insert({ req.parser.url, img });
+    }
+
+    std::string line = "IMG ";
+    line += req.thread_num_str.empty() ? "-" : req.thread_num_str;
+    line += " " + req.parser.url;
+
+    if (!send_line(line))
+    {
+        fall_back();
+    }
+
+    return true;
+}
+
+
+bool DaemonClient::send_line(const std::string& line)
+{
+    if (!b_attached) return false;
+
+    std::lock_guard<std::mutex> lock(send_mtx);
+
+    return send_all(sock, line + "\n");
+}
+
+
+void DaemonClient::read_loop()
+{
+    std::string in_buf;
+    char buf[4096];
+
+    while (b_attached)
+    {
+        ssize_t n = recv(sock, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        in_buf.append(buf, n);
+
+        size_t pos;
+        while ((pos = in_buf.find('\n')) != std::string::npos)
+        {
+            std::string line = in_buf.substr(0, pos);
+            in_buf.erase(0, pos + 1);
+            handle_line(line);
+        }
+    }
+
+    // the daemon went away, the UI carries on by itself
+    if (b_attached)
+    {
+        ERR("DAEMON CLIENT: lost connection to daemon, fetching directly");
+        fall_back();
+    }
+}
+
+
+void DaemonClient::handle_line(const std::string& line)
+{
+    std::istringstream in(line);
+    std::string cmd;
+    in >> cmd;
+
+    if (cmd.compare("JSON") == 0)
+    {
+        long fetch_time = 0;
+        int error_type = 0;
+        long http_response = 0;
+        int curl_result = -1;
+        std::string url;
+        in >> fetch_time >> error_type >> http_response >> curl_result >> url;
+
+        std::vector<pending_json> waiting;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            auto range = pending_jsons.equal_range(url);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                waiting.push_back(it->second);
+            }
+            pending_jsons.erase(range.first, range.second);
+        }
+
+        // pushed by the daemon, update the page if it is open
+        if (waiting.empty())
+        {
+            // nothing new to show
+            if (error_type != et_NONE) return;
+            waiting.push_back({ url, false });
+        }
+
+        data_4chan chan_data(url);
+        chan_data.fetch_time = fetch_time;
+        chan_data.error_type = (e_error_type) error_type;
+        chan_data.http_response = http_response;
+        chan_data.curl_result = curl_result;
+
+        // parsing is left to the workers, so the
+        // reader can get on with the next event
+        THREAD_MAN.enqueue_job(
+            std::bind(load_json, chan_data, waiting),
+            waiting.front().wgt_id,
+            true /* b_push_to_front */);
+    }
+    else if (cmd.compare("IMG") == 0)
+    {
+        int ok = 0;
+        int error_type = 0;
+        long http_response = 0;
+        int curl_result = -1;
+        std::string url;
+        in >> ok >> error_type >> http_response >> curl_result >> url;
+
+        std::vector<pending_image> waiting;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+
+            auto range = pending_images.equal_range(url);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                waiting.push_back(it->second);
+            }
+            pending_images.erase(range.first, range.second);
+        }
+
+        if (!DISPLAY_IMAGES) return;
+
+        for (auto& img : waiting)
+        {
+            http_image_req req(url, img.size, img.thread_key, img.thread_num_str, img.post_key);
+
+            img_packet pac(
+                img.size,
+                img.thread_key,
+                img.post_key,
+                req.parser,
+                req.get_file_path());
+
+            if (ok)
+            {
+                IMG_MAN.load_img_from_disk(pac, img.job_pool_id);
+            }
+            else
+            {
+                req.error_type = (e_error_type) error_type;
+                req.http_response = http_response;
+                req.curl_result = curl_result;
+                IMG_MAN.fail_image(pac, !req.failed_for_good());
+            }
+        }
+    }
+}
+
+
+void DaemonClient::load_json(data_4chan chan_data, std::vector<pending_json> waiting)
+{
+    if (chan_data.error_type == et_NONE)
+    {
+        std::stringstream json;
+        FileOps::read_file(json, chan_data.file_path + chan_data.get_file_name());
+
+        if (!chan_data.parse_json(json.str()))
+        {
+            chan_data.error_type = et_json_parse;
+        }
+    }
+
+    // every waiting widget shares the parsed page
+    for (auto& w : waiting)
+    {
+        data_4chan wgt_data = chan_data;
+        wgt_data.wgt_id = w.wgt_id;
+        wgt_data.b_steal_focus = w.b_steal_focus;
+        NetOps::queue__4chan_json.push(wgt_data);
+    }
+}
+
+
+void DaemonClient::fall_back()
+{
+    b_attached = false;
+
+    std::multimap<std::string, pending_json> jsons;
+    std::multimap<std::string, pending_image> imgs;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        jsons.swap(pending_jsons);
+        imgs.swap(pending_images);
+    }
+
+    for (auto& j : jsons)
+    {
+        NetOps::http_get__4chan_json(j.first, j.second.wgt_id, j.second.b_steal_focus, 0);
+    }
+
+    for (auto& i : imgs)
+    {
+        if (!DISPLAY_IMAGES) break;
+
+        IMG_MAN.request_image(
+            i.first,
+            i.second.size,
+            i.second.thread_key,
+            i.second.thread_num_str,
+            i.second.post_key,
+            i.second.job_pool_id);
+    }
+}
@@ -0,0 +1,226 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#pragma once
+#include "comfy.h"
+#include "threadman.h"
+#include <set>
+
+struct http_image_req;
+struct data_4chan;
+
+
+/*
+ *  The daemon owns the network side of comfy: the worker threads,
+ *  the disk cache in IMAGEBOARDS_DIR and a watch list of pages that
+ *  clients have opened, which it keeps refreshing. UIs attach to it
+ *  over a UNIX socket in DATA_DIR and ask it for pages and images
+ *  instead of fetching them themselves, so several terminals share
+ *  one set of downloads and a new UI starts with warm caches.
+ *
+ *  The protocol is one request or event per line, url last:
+ *
+ *  client -> daemon
+ *      JSON <last fetch time> <url>    get a catalog, thread, etc.
+ *      IMG <thread num> <url>          get an image into the cache
+ *      QUIT                            stop the daemon
+ *
+ *  daemon -> client
+ *      JSON <fetch time> <error type> <http response> <curl result> <url>
+ *      IMG <1 if ok> <error type> <http response> <curl result> <url>
+ *
+ *  A JSON event means the page is up to date in the shared cache and
+ *  can be parsed from there. They are also sent unrequested when a
+ *  watched page has changed.
+ */
+
+class Daemon
+{
+
+public:
+
+    // runs until a client sends QUIT or the process is terminated.
+    // returns the exit code for the process.
+    static int run();
+
+    static std::string get_socket_path();
+    static bool is_running();
+
+
+protected:
+
+    struct page_waiter
+    {
+        int fd;
+        long last_fetch_time;
+    };
+
+    struct page_state
+    {
+        page_state()
+        : pagetype(HTML_Utils::e_page_type::pt_UNKNOWN)
+        , last_fetch(0)
+        , last_change(0)
+        , last_request(0)
+        , b_in_flight(false)
+        , error_type(0)
+        , http_response(0)
+        , curl_result(-1)
+        {}
+
+        HTML_Utils::e_page_type pagetype;
+        // seconds since epoch
+        long last_fetch;
+        // fetch time of the json in the cache
+        long last_change;
+        long last_request;
+        bool b_in_flight;
+        // outcome of the last fetch
+        int error_type;
+        long http_response;
+        int curl_result;
+        std::vector<page_waiter> waiters;
+        // clients that have this page open
+        std::set<int> subscribers;
+    };
+
+    struct image_state
+    {
+        image_state()
+        : b_in_flight(false)
+        {}
+
+        bool b_in_flight;
+        std::vector<int> waiters;
+    };
+
+    // handed back from the worker threads
+    struct fetch_result
+    {
+        fetch_result()
+        : b_image(false)
+        , b_changed(false)
+        , fetch_time(0)
+        , error_type(0)
+        , http_response(0)
+        , curl_result(-1)
+        {}
+
+        bool b_image;
+        bool b_changed;
+        std::string url;
+        long fetch_time;
+        int error_type;
+        long http_response;
+        int curl_result;
+    };
+
+    // client sockets don't block, so a UI that stops reading can't
+    // hold up the others. what it hasn't taken yet waits in out_buf.
+    struct client_state
+    {
+        client_state()
+        : b_gone(false)
+        {}
+
+        std::string in_buf;
+        std::string out_buf;
+        // the socket failed or out_buf got too big,
+        // dropped once it's safe to (see run())
+        bool b_gone;
+    };
+
+    static bool b_run;
+    static int listen_fd;
+    // written to by worker threads to wake up poll()
+    static int wake_pipe[2];
+    static std::map<int, client_state> clients;
+    static std::map<std::string, page_state> pages;
+    static std::map<std::string, image_state> images;
+    static threadsafe_queue<fetch_result> results;
+
+    static void accept_client();
+    static void drop_client(int fd);
+    static bool read_client(int fd);
+    static void handle_line(int fd, const std::string& line);
+
+    static void request_page(int fd, std::string url, long last_fetch_time);
+    static void request_image(int fd, std::string url, std::string thread_num_str);
+    static void refresh_watched();
+    static void handle_result(fetch_result& result);
+    static void send_page(int fd, const std::string& url, const page_state& page, long last_fetch_time);
+
+    // run on THREAD_MAN's workers
+    static void fetch_page(std::string url);
+    static void fetch_image(std::string url, std::string file_path, std::string file_name);
+    static void push_result(fetch_result& result);
+
+    // queues line for the client and sends as much as the socket takes
+    static void send_line(int fd, const std::string& line);
+    // sends what the socket takes of the client's out_buf
+    static void flush_client(int fd, client_state& client);
+
+};
+
+
+// the UI's connection to a running daemon.
+// when attached, NetOps hands its requests to the daemon.
+class DaemonClient
+{
+
+public:
+
+    // returns true if a daemon is running and the UI attached to it
+    static bool connect();
+    static void disconnect();
+    static bool attached() { return b_attached; };
+
+    // asks a running daemon to quit, returns false if none is running
+    static bool stop_daemon();
+
+    static void request_json(std::string url, std::string wgt_id, bool b_steal_focus, long last_fetch_time);
+    // returns false if the image has to be fetched directly
+    static bool request_image(http_image_req& req, std::string job_pool_id);
+
+
+protected:
+
+    struct pending_json
+    {
+        std::string wgt_id;
+        bool b_steal_focus;
+    };
+
+    struct pending_image
+    {
+        vector2d size;
+        std::string thread_key;
+        int post_key;
+        std::string thread_num_str;
+        std::string job_pool_id;
+    };
+
+    static std::atomic<bool> b_attached;
+    static int sock;
+    static std::thread reader;
+    // guards the pending requests
+    static std::mutex mtx;
+    // guards writes to sock
+    static std::mutex send_mtx;
+    static std::multimap<std::string, pending_json> pending_jsons;
+    static std::multimap<std::string, pending_image> pending_images;
+
+    static bool send_line(const std::string& line);
+    static void read_loop();
+    static void handle_line(const std::string& line);
+    // parses a json from the cache and hands it to each waiting widget
+    static void load_json(data_4chan chan_data, std::vector<pending_json> waiting);
+    // re-issues pending requests directly after losing the daemon
+    static void fall_back();
+
+};
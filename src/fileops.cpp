@@ -9,6 +9,8 @@
 #include "fileops.h"
 #include <experimental/filesystem>
 #include <fstream>
+#include <cstdio>
+#include <sys/stat.h>
 
 using namespace experimental::filesystem;
 
@@ -40,6 +42,30 @@ bool FileOps::file_exists(const string& file_path)
 }
 
 
+long FileOps::last_modified(const string& file_path)
+{
+    struct stat st;
+    if (file_path.empty() || stat(file_path.c_str(), &st) != 0)
+    {
+        return 0;
+    }
+
+    return st.st_mtime;
+}
+
+
+long FileOps::file_size(const string& file_path)
+{
+    struct stat st;
+    if (file_path.empty() || stat(file_path.c_str(), &st) != 0)
+    {
+        return -1;
+    }
+
+    return st.st_size;
+}
+
+
 void FileOps::mkdir(const string& path)
 {
     if (!valid_dir(path)) return;
@@ -59,6 +85,17 @@ void FileOps::write_file(const string& file_path, const string& file_name, const
 }
 
 
+void FileOps::write_file_atomic(const string& file_path, const string& file_name, const char* buf, int buf_size)
+{
+    if (!valid_dir(file_path) || file_name.empty()) return;
+
+    write_file(file_path, file_name + ".part", buf, buf_size);
+    std::rename(
+        (file_path + file_name + ".part").c_str(),
+        (file_path + file_name).c_str());
+}
+
+
 vector<string> FileOps::get_dir_contents(string path)
 {
     vector<string> dir;
@@ -18,8 +18,15 @@ public:
 
     static bool valid_dir(string dir);
     static bool file_exists(const string& file_path);
+    // seconds since epoch, 0 if the file doesn't exist
+    static long last_modified(const string& file_path);
+    // in bytes, -1 if the file doesn't exist
+    static long file_size(const string& file_path);
     static void mkdir(const string& path);
     static void write_file(const string& file_path, const string& file_name, const char* buf, int buf_size);
+    // writes to file_name.part and renames it to file_name, so
+    // that a reader never sees a half written file
+    static void write_file_atomic(const string& file_path, const string& file_name, const char* buf, int buf_size);
     static vector<string> get_dir_contents(string path);
     static void delete_all_in_dir(string path);
     static void delete_file(string path);
@@ -0,0 +1,600 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#include "comfy.h"
+
+
+namespace HTML_Utils
+{
+
+namespace
+{
+    struct entity
+    {
+        const char* name;
+        uint32_t code_point;
+    };
+
+    // the html 4 entities, and &apos;. sorted by name. the rest of
+    // the html 5 ones aren't decoded, 4chan escapes only &, <, >, "
+    // and ' in what it serves, so others are only there if typed in.
+    const entity entities[] =
+    {
+        { "AElig", 198 }, { "Aacute", 193 }, { "Acirc", 194 }, { "Agrave", 192 },
+        { "Alpha", 913 }, { "Aring", 197 }, { "Atilde", 195 }, { "Auml", 196 },
+        { "Beta", 914 }, { "Ccedil", 199 }, { "Chi", 935 }, { "Dagger", 8225 },
+        { "Delta", 916 }, { "ETH", 208 }, { "Eacute", 201 }, { "Ecirc", 202 },
+        { "Egrave", 200 }, { "Epsilon", 917 }, { "Eta", 919 }, { "Euml", 203 },
+        { "Gamma", 915 }, { "Iacute", 205 }, { "Icirc", 206 }, { "Igrave", 204 },
+        { "Iota", 921 }, { "Iuml", 207 }, { "Kappa", 922 }, { "Lambda", 923 },
+        { "Mu", 924 }, { "Ntilde", 209 }, { "Nu", 925 }, { "OElig", 338 },
+        { "Oacute", 211 }, { "Ocirc", 212 }, { "Ograve", 210 }, { "Omega", 937 },
+        { "Omicron", 927 }, { "Oslash", 216 }, { "Otilde", 213 }, { "Ouml", 214 },
+        { "Phi", 934 }, { "Pi", 928 }, { "Prime", 8243 }, { "Psi", 936 },
+        { "Rho", 929 }, { "Scaron", 352 }, { "Sigma", 931 }, { "THORN", 222 },
+        { "Tau", 932 }, { "Theta", 920 }, { "Uacute", 218 }, { "Ucirc", 219 },
+        { "Ugrave", 217 }, { "Upsilon", 933 }, { "Uuml", 220 }, { "Xi", 926 },
+        { "Yacute", 221 }, { "Yuml", 376 }, { "Zeta", 918 }, { "aacute", 225 },
+        { "acirc", 226 }, { "acute", 180 }, { "aelig", 230 }, { "agrave", 224 },
+        { "alefsym", 8501 }, { "alpha", 945 }, { "amp", 38 }, { "and", 8743 },
+        { "ang", 8736 }, { "apos", 39 }, { "aring", 229 }, { "asymp", 8776 },
+        { "atilde", 227 }, { "auml", 228 }, { "bdquo", 8222 }, { "beta", 946 },
+        { "brvbar", 166 }, { "bull", 8226 }, { "cap", 8745 }, { "ccedil", 231 },
+        { "cedil", 184 }, { "cent", 162 }, { "chi", 967 }, { "circ", 710 },
+        { "clubs", 9827 }, { "cong", 8773 }, { "copy", 169 }, { "crarr", 8629 },
+        { "cup", 8746 }, { "curren", 164 }, { "dArr", 8659 }, { "dagger", 8224 },
+        { "darr", 8595 }, { "deg", 176 }, { "delta", 948 }, { "diams", 9830 },
+        { "divide", 247 }, { "eacute", 233 }, { "ecirc", 234 }, { "egrave", 232 },
+        { "empty", 8709 }, { "emsp", 8195 }, { "ensp", 8194 }, { "epsilon", 949 },
+        { "equiv", 8801 }, { "eta", 951 }, { "eth", 240 }, { "euml", 235 },
+        { "euro", 8364 }, { "exist", 8707 }, { "fnof", 402 }, { "forall", 8704 },
+        { "frac12", 189 }, { "frac14", 188 }, { "frac34", 190 }, { "frasl", 8260 },
+        { "gamma", 947 }, { "ge", 8805 }, { "gt", 62 }, { "hArr", 8660 },
+        { "harr", 8596 }, { "hearts", 9829 }, { "hellip", 8230 }, { "iacute", 237 },
+        { "icirc", 238 }, { "iexcl", 161 }, { "igrave", 236 }, { "image", 8465 },
+        { "infin", 8734 }, { "int", 8747 }, { "iota", 953 }, { "iquest", 191 },
+        { "isin", 8712 }, { "iuml", 239 }, { "kappa", 954 }, { "lArr", 8656 },
+        { "lambda", 955 }, { "lang", 9001 }, { "laquo", 171 }, { "larr", 8592 },
+        { "lceil", 8968 }, { "ldquo", 8220 }, { "le", 8804 }, { "lfloor", 8970 },
+        { "lowast", 8727 }, { "loz", 9674 }, { "lrm", 8206 }, { "lsaquo", 8249 },
+        { "lsquo", 8216 }, { "lt", 60 }, { "macr", 175 }, { "mdash", 8212 },
+        { "micro", 181 }, { "middot", 183 }, { "minus", 8722 }, { "mu", 956 },
+        { "nabla", 8711 }, { "nbsp", 160 }, { "ndash", 8211 }, { "ne", 8800 },
+        { "ni", 8715 }, { "not", 172 }, { "notin", 8713 }, { "nsub", 8836 },
+        { "ntilde", 241 }, { "nu", 957 }, { "oacute", 243 }, { "ocirc", 244 },
+        { "oelig", 339 }, { "ograve", 242 }, { "oline", 8254 }, { "omega", 969 },
+        { "omicron", 959 }, { "oplus", 8853 }, { "or", 8744 }, { "ordf", 170 },
+        { "ordm", 186 }, { "oslash", 248 }, { "otilde", 245 }, { "otimes", 8855 },
+        { "ouml", 246 }, { "para", 182 }, { "part", 8706 }, { "permil", 8240 },
+        { "perp", 8869 }, { "phi", 966 }, { "pi", 960 }, { "piv", 982 },
+        { "plusmn", 177 }, { "pound", 163 }, { "prime", 8242 }, { "prod", 8719 },
+        { "prop", 8733 }, { "psi", 968 }, { "quot", 34 }, { "rArr", 8658 },
+        { "radic", 8730 }, { "rang", 9002 }, { "raquo", 187 }, { "rarr", 8594 },
+        { "rceil", 8969 }, { "rdquo", 8221 }, { "real", 8476 }, { "reg", 174 },
+        { "rfloor", 8971 }, { "rho", 961 }, { "rlm", 8207 }, { "rsaquo", 8250 },
+        { "rsquo", 8217 }, { "sbquo", 8218 }, { "scaron", 353 }, { "sdot", 8901 },
+        { "sect", 167 }, { "shy", 173 }, { "sigma", 963 }, { "sigmaf", 962 },
+        { "sim", 8764 }, { "spades", 9824 }, { "sub", 8834 }, { "sube", 8838 },
+        { "sum", 8721 }, { "sup", 8835 }, { "sup1", 185 }, { "sup2", 178 },
+        { "sup3", 179 }, { "supe", 8839 }, { "szlig", 223 }, { "tau", 964 },
+        { "there4", 8756 }, { "theta", 952 }, { "thetasym", 977 }, { "thinsp", 8201 },
+        { "thorn", 254 }, { "tilde", 732 }, { "times", 215 }, { "trade", 8482 },
+        { "uArr", 8657 }, { "uacute", 250 }, { "uarr", 8593 }, { "ucirc", 251 },
+        { "ugrave", 249 }, { "uml", 168 }, { "upsih", 978 }, { "upsilon", 965 },
+        { "uuml", 252 }, { "weierp", 8472 }, { "xi", 958 }, { "yacute", 253 },
+        { "yen", 165 }, { "yuml", 255 }, { "zeta", 950 }, { "zwj", 8205 },
+        { "zwnj", 8204 },
+    };
+
+    enum e_tag
+    {
+        tag_other,
+        tag_a,
+        tag_span,
+        tag_s,
+        tag_b,
+        tag_i,
+        tag_code,
+        tag_br,
+        tag_wbr,
+        tag_void,
+    };
+
+    struct tag_token
+    {
+        tag_token()
+        : tag(tag_other)
+        , b_closing(false)
+        , b_self_closing(false)
+        , cls(nullptr)
+        , cls_len(0)
+        , href(nullptr)
+        , href_len(0)
+        {}
+
+        e_tag tag;
+        bool b_closing;
+        bool b_self_closing;
+        const char* cls;
+        size_t cls_len;
+        const char* href;
+        size_t href_len;
+    };
+
+    struct open_tag
+    {
+        e_tag tag;
+        uint32_t style;
+        int quote_num;
+    };
+
+    inline bool is_alpha(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    inline bool is_digit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    inline char to_lower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+
+    // s is name, ignoring case. name is lower case.
+    bool name_is(const char* s, size_t len, const char* name)
+    {
+        size_t i = 0;
+        for (; i < len && name[i]; ++i)
+        {
+            if (to_lower(s[i]) != name[i])
+            {
+                return false;
+            }
+        }
+
+        return i == len && !name[i];
+    }
+
+    // the class attribute cls has name in its list of classes
+    bool has_class(const char* cls, size_t len, const char* name)
+    {
+        size_t i = 0;
+        while (i < len)
+        {
+            while (i < len && cls[i] == ' ') ++i;
+            size_t start = i;
+            while (i < len && cls[i] != ' ') ++i;
+
+            if (i > start && name_is(cls + start, i - start, name))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    e_tag get_tag(const char* s, size_t len)
+    {
+        if (name_is(s, len, "a"))       return tag_a;
+        if (name_is(s, len, "span"))    return tag_span;
+        if (name_is(s, len, "br"))      return tag_br;
+        if (name_is(s, len, "wbr"))     return tag_wbr;
+        if (name_is(s, len, "s"))       return tag_s;
+        if (name_is(s, len, "b") ||
+            name_is(s, len, "strong"))  return tag_b;
+        if (name_is(s, len, "i") ||
+            name_is(s, len, "em"))      return tag_i;
+        if (name_is(s, len, "code") ||
+            name_is(s, len, "pre"))     return tag_code;
+        if (name_is(s, len, "img") ||
+            name_is(s, len, "hr"))      return tag_void;
+
+        return tag_other;
+    }
+
+    // post num of a quote link within the thread (e.g. "#p570368")
+    int get_quote_num(const char* href, size_t len)
+    {
+        if (len < 3 || href[0] != '#' || href[1] != 'p')
+        {
+            return -1;
+        }
+
+        int64_t num = 0;
+        for (size_t i = 2; i < len; ++i)
+        {
+            if (!is_digit(href[i]) || num > INT32_MAX / 10)
+            {
+                return -1;
+            }
+
+            num = num * 10 + (href[i] - '0');
+        }
+
+        return num <= INT32_MAX ? (int)num : -1;
+    }
+
+    // parses the tag starting at html[i] ('<'). returns the index
+    // after its '>', or 0 if there isn't a tag at i (e.g. "a < b").
+    size_t parse_tag(const char* html, size_t len, size_t i, tag_token& tok)
+    {
+        size_t p = i + 1;
+        if (p < len && html[p] == '/')
+        {
+            tok.b_closing = true;
+            ++p;
+        }
+
+        if (p >= len || !is_alpha(html[p]))
+        {
+            return 0;
+        }
+
+        size_t name_start = p;
+        while (p < len && (is_alpha(html[p]) || is_digit(html[p]))) ++p;
+        tok.tag = get_tag(html + name_start, p - name_start);
+
+        // attributes
+        while (p < len && html[p] != '>')
+        {
+            if (html[p] == '/')
+            {
+                tok.b_self_closing = true;
+                ++p;
+                continue;
+            }
+
+            if (!is_alpha(html[p]))
+            {
+                ++p;
+                continue;
+            }
+
+            size_t attr_start = p;
+            while (p < len && (is_alpha(html[p]) || html[p] == '-')) ++p;
+            size_t attr_len = p - attr_start;
+
+            while (p < len && html[p] == ' ') ++p;
+            if (p >= len || html[p] != '=')
+            {
+                continue;
+            }
+
+            ++p;
+            while (p < len && html[p] == ' ') ++p;
+
+            size_t val_start = p;
+            size_t val_len = 0;
+            if (p < len && (html[p] == '"' || html[p] == '\''))
+            {
+                char quote = html[p];
+                val_start = ++p;
+                while (p < len && html[p] != quote) ++p;
+                val_len = p - val_start;
+                if (p < len) ++p;
+            }
+            else
+            {
+                while (p < len && html[p] != ' ' && html[p] != '>') ++p;
+                val_len = p - val_start;
+            }
+
+            if (name_is(html + attr_start, attr_len, "class"))
+            {
+                tok.cls = html + val_start;
+                tok.cls_len = val_len;
+            }
+            else if (name_is(html + attr_start, attr_len, "href"))
+            {
+                tok.href = html + val_start;
+                tok.href_len = val_len;
+            }
+        }
+
+        // never closed
+        if (p >= len)
+        {
+            return 0;
+        }
+
+        return p + 1;
+    }
+}
+
+
+size_t decode_entity(const char* s, size_t len, uint32_t& cp)
+{
+    if (len < 3 || s[0] != '&')
+    {
+        return 0;
+    }
+
+    // numeric
+    if (s[1] == '#')
+    {
+        size_t p = 2;
+        bool b_hex = false;
+        if (s[p] == 'x' || s[p] == 'X')
+        {
+            b_hex = true;
+            ++p;
+        }
+
+        size_t digits_start = p;
+        uint32_t code_point = 0;
+        // at most 8 digits, enough for any code point
+        while (p < len && p < digits_start + 8)
+        {
+            char c = to_lower(s[p]);
+            if (is_digit(c))
+                code_point = code_point * (b_hex ? 16 : 10) + (c - '0');
+            else if (b_hex && c >= 'a' && c <= 'f')
+                code_point = code_point * 16 + (c - 'a' + 10);
+            else
+                break;
+
+            ++p;
+        }
+
+        if (p == digits_start || p >= len || s[p] != ';')
+        {
+            return 0;
+        }
+
+        if (code_point == 0 || code_point > 0x10FFFF ||
+            (code_point >= 0xD800 && code_point <= 0xDFFF))
+        {
+            code_point = 0xFFFD;
+        }
+
+        cp = code_point;
+        return p + 1;
+    }
+
+    // named, the longest name has 8 chars
+    char name[9];
+    size_t p = 1;
+    while (p < len && p <= 8 && (is_alpha(s[p]) || is_digit(s[p])))
+    {
+        name[p - 1] = s[p];
+        ++p;
+    }
+
+    if (p == 1 || p >= len || s[p] != ';')
+    {
+        return 0;
+    }
+
+    name[p - 1] = 0;
+
+    const entity* end = entities + sizeof(entities) / sizeof(entities[0]);
+    const entity* it = std::lower_bound(
+        entities,
+        end,
+        name,
+        [](const entity& e, const char* n) {
+            return std::strcmp(e.name, n) < 0;
+        });
+
+    if (it == end || std::strcmp(it->name, name) != 0)
+    {
+        return 0;
+    }
+
+    cp = it->code_point;
+    return p + 1;
+}
+
+
+void find_quote_links(const char* html, size_t len, vector<int>& quotes, int& cross_links)
+{
+    const char* end = html + len;
+    const char* p = html;
+    while ((p = (const char*)std::memchr(p, '<', end - p)))
+    {
+        if (p + 1 >= end || (p[1] != 'a' && p[1] != 'A'))
+        {
+            p++;
+            continue;
+        }
+
+        tag_token tok;
+        size_t tag_end = parse_tag(html, len, p - html, tok);
+        if (!tag_end)
+        {
+            p++;
+            continue;
+        }
+
+        if (tok.tag == tag_a && !tok.b_closing &&
+            has_class(tok.cls, tok.cls_len, "quotelink"))
+        {
+            int num = get_quote_num(tok.href, tok.href_len);
+            if (num == -1)
+            {
+                cross_links++;
+            }
+            else if (std::find(quotes.begin(), quotes.end(), num) == quotes.end())
+            {
+                quotes.push_back(num);
+            }
+        }
+
+        p = html + tag_end;
+    }
+}
+
+
+void parse_comment(const char* html, size_t len, comment_text& out)
+{
+    out.text.clear();
+    out.runs.clear();
+    out.b_markup = false;
+    out.text.reserve(len);
+
+    vector<open_tag> open_tags;
+    uint32_t style = ts_plain;
+    int quote_num = -1;
+    // a quote link starts a run even if it follows another one
+    bool b_new_run = true;
+
+    auto run_for = [&]() -> text_run& {
+        if (b_new_run ||
+            out.runs.back().style != style ||
+            out.runs.back().quote_num != quote_num)
+        {
+            out.runs.emplace_back(out.text.length(), style, quote_num);
+            b_new_run = false;
+        }
+
+        return out.runs.back();
+    };
+
+    auto put = [&](uint32_t cp) {
+        text_run& run = run_for();
+        size_t before = out.text.length();
+        utf8_encode(cp, out.text);
+        run.length += out.text.length() - before;
+    };
+
+    auto restyle = [&]() {
+        style = ts_plain;
+        quote_num = -1;
+        for (const auto& t : open_tags)
+        {
+            style |= t.style;
+            if (t.quote_num != -1)
+            {
+                quote_num = t.quote_num;
+            }
+        }
+    };
+
+    size_t i = 0;
+    while (i < len)
+    {
+        char c = html[i];
+
+        if (c == '<')
+        {
+            tag_token tok;
+            size_t end = parse_tag(html, len, i, tok);
+            if (end)
+            {
+                out.b_markup = true;
+                i = end;
+
+                if (tok.b_closing)
+                {
+                    // innermost open tag of the kind,
+                    // badly nested ones are left open
+                    for (size_t t = open_tags.size(); t > 0; --t)
+                    {
+                        if (open_tags[t - 1].tag == tok.tag)
+                        {
+                            open_tags.erase(open_tags.begin() + (t - 1));
+                            break;
+                        }
+                    }
+
+                    restyle();
+                    if (tok.tag == tag_a)
+                    {
+                        b_new_run = true;
+                    }
+                }
+                else if (tok.tag == tag_br)
+                {
+                    put('\n');
+                }
+                else if (tok.tag != tag_wbr && tok.tag != tag_void &&
+                         !tok.b_self_closing)
+                {
+                    open_tag t { tok.tag, ts_plain, -1 };
+                    switch (tok.tag)
+                    {
+                        case tag_a:
+                            if (has_class(tok.cls, tok.cls_len, "quotelink"))
+                            {
+                                t.style = ts_quotelink;
+                                t.quote_num = get_quote_num(tok.href, tok.href_len);
+                            }
+                            b_new_run = true;
+                            break;
+
+                        case tag_span:
+                            if (has_class(tok.cls, tok.cls_len, "quote"))
+                                t.style = ts_quote;
+                            else if (has_class(tok.cls, tok.cls_len, "deadlink"))
+                                t.style = ts_deadlink;
+                            break;
+
+                        case tag_s      : t.style = ts_spoiler;
+                                          break;
+                        case tag_b      : t.style = ts_bold;
+                                          break;
+                        case tag_i      : t.style = ts_italic;
+                                          break;
+                        case tag_code   : t.style = ts_code;
+                                          break;
+                        default         : break;
+                    }
+
+                    open_tags.push_back(t);
+                    restyle();
+                }
+
+                continue;
+            }
+        }
+        else if (c == '&')
+        {
+            uint32_t cp;
+            size_t n = decode_entity(html + i, len - i, cp);
+            if (n)
+            {
+                put(cp);
+                i += n;
+                continue;
+            }
+        }
+        // line breaks only come from <br>
+        else if (c == '\n' || c == '\r' || c == '\t' ||
+                 c == '\v' || c == '\f')
+        {
+            ++i;
+            continue;
+        }
+
+        // copy the text up to the next tag or entity as it is
+        size_t end = i + 1;
+        while (end < len && html[end] != '<' && html[end] != '&' &&
+               (unsigned char)html[end] >= 0x20)
+        {
+            end++;
+        }
+
+        run_for().length += end - i;
+        out.text.append(html + i, end - i);
+        i = end;
+    }
+}
+
+
+string comment_to_text(const char* html, size_t len)
+{
+    comment_text out;
+    parse_comment(html, len, out);
+    return std::move(out.text);
+}
+
+};
@@ -7,6 +7,8 @@
  *  Licensed under the GPL v2.0 only.
  */
 #pragma once
+#include <cstdint>
+#include <vector>
 #include "stringutils.h"
 
 
@@ -37,6 +39,69 @@ namespace HTML_Utils
     };
 
 
+    // styles of the 4chan comment html subset
+    enum e_text_style : uint32_t
+    {
+        ts_plain        = 0,
+        ts_quote        = 1 << 0,   // <span class="quote">, greentext
+        ts_quotelink    = 1 << 1,   // <a class="quotelink">
+        ts_deadlink     = 1 << 2,   // <span class="deadlink">
+        ts_spoiler      = 1 << 3,   // <s>
+        ts_bold         = 1 << 4,   // <b>, <strong>
+        ts_italic       = 1 << 5,   // <i>, <em>
+        ts_code         = 1 << 6,   // <code>, <pre>
+    };
+
+    // a stretch of comment text in the same style.
+    // each quote link is a run of its own.
+    struct text_run
+    {
+        text_run(size_t _start = 0, uint32_t _style = ts_plain, int _quote_num = -1)
+        : start(_start)
+        , length(0)
+        , style(_style)
+        , quote_num(_quote_num)
+        {}
+
+        size_t start;
+        size_t length;
+        uint32_t style;
+        // post in the same thread a quote link points to, or -1
+        int quote_num;
+    };
+
+    // a comment with its tags taken out and its entities decoded.
+    // <br> becomes '\n', and the runs cover all of the text.
+    struct comment_text
+    {
+        comment_text()
+        : b_markup(false)
+        {}
+
+        string text;
+        vector<text_run> runs;
+        // there was a tag in the comment
+        bool b_markup;
+    };
+
+    // tokenizes the comment html (utf-8) in one pass.
+    // run starts and lengths are in bytes.
+    void parse_comment(const char* html, size_t len, comment_text& out);
+    // the text of the html alone, e.g. of a subject
+    string comment_to_text(const char* html, size_t len);
+
+    // appends the posts of the same thread that the quote links in
+    // the comment html point to, once each, to quotes, and counts
+    // the quote links to other threads and boards in cross_links
+    void find_quote_links(const char* html, size_t len, vector<int>& quotes, int& cross_links);
+
+    // decodes the named (e.g. "&amp;") or numeric (e.g. "&#039;",
+    // "&#x27;") entity at the start of s into code point cp. returns
+    // the number of chars it takes up, or 0 if s doesn't start with
+    // an entity.
+    size_t decode_entity(const char* s, size_t len, uint32_t& cp);
+
+
     struct url_parser
     {
         url_parser()
@@ -76,8 +76,13 @@ void ImgMan::shutdown()
 }
 
 
-void ImgMan::request_image(std::string url, vector2d size, std::string widget_id, std::string thread_num_str, int post_num)
+void ImgMan::request_image(std::string url, vector2d size, std::string widget_id, std::string thread_num_str, int post_num, std::string job_pool_id)
 {
+    if (job_pool_id.empty())
+    {
+        job_pool_id = widget_id;
+    }
+
     http_image_req req(
         url,
         size,
@@ -96,12 +101,12 @@ void ImgMan::request_image(std::string url, vector2d size, std::string widget_id
             req.parser,
             req.get_file_path());
 
-        IMG_MAN.load_img_from_disk(pac, widget_id /* job_pool_id */);
+        IMG_MAN.load_img_from_disk(pac, job_pool_id);
     }
     // create multithreaded http get request
     else
     {
-        NetOps::http_get__image(req, widget_id /* job_pool_id */);
+        NetOps::http_get__image(req, job_pool_id);
     }
 }
 
@@ -252,6 +257,15 @@ void ImgMan::threaded_load_img_from_disk(img_packet pac)
 }
 
 
+void ImgMan::fail_image(img_packet pac, bool b_retry)
+{
+    pac.b_failed = true;
+    pac.b_retry = b_retry;
+
+    queue__image_packet.push(pac);
+}
+
+
 void ImgMan::load_img_from_disk(img_packet pac, std::string job_pool_id)
 {
     if (!DISPLAY_IMAGES) return;
@@ -517,6 +531,20 @@ vector2d ImgMan::draw_img_pixel_coord(
     // write image to display buffer
     if (image_data.valid_pixmap())
     {
+        // still on screen from the last frame
+        for (auto& sd : sixel_draw_buffer)
+        {
+            if (sd.image_data == &image_data &&
+                sd.pixmap == image_data.get_pixmap() &&
+                sd.offset == vector2d(offset_x, offset_y) &&
+                sd.size == vector2d(width, height) &&
+                sd.coord == vector2d(coord_x, coord_y))
+            {
+                sd.b_current = true;
+                return vector2d(width, height);
+            }
+        }
+
         show_image(
             image_data,
             offset_x, offset_y,
@@ -592,6 +620,51 @@ bool ImgMan::show_image(img_data& img, int sx, int sy, int sw, int sh, int x, in
 }
 
 
+void ImgMan::begin_frame()
+{
+    for (auto& sd : sixel_draw_buffer)
+    {
+        sd.b_current = false;
+    }
+}
+
+
+void ImgMan::begin_frame(const std::vector<uint8_t>& rows)
+{
+    vector2d char_size = get_term_char_size();
+    if (char_size.y < 1)
+    {
+        begin_frame();
+        return;
+    }
+
+    for (auto& sd : sixel_draw_buffer)
+    {
+        int top = std::max(sd.coord.y / char_size.y, 0);
+        int bottom = std::min((sd.coord.y + sd.size.y + char_size.y - 1) / char_size.y, (int)rows.size());
+        for (int y = top; y < bottom; ++y)
+        {
+            if (rows[y])
+            {
+                sd.b_current = false;
+                break;
+            }
+        }
+    }
+}
+
+
+void ImgMan::end_frame()
+{
+    sixel_draw_buffer.erase(
+        std::remove_if(
+            sixel_draw_buffer.begin(),
+            sixel_draw_buffer.end(),
+            [](const sixel_draw& sd) { return !sd.b_current; }),
+        sixel_draw_buffer.end());
+}
+
+
 void ImgMan::redraw_buffer(bool b_sync)
 {
     for (auto& sd : sixel_draw_buffer)
@@ -184,6 +184,8 @@ struct img_packet
     , post_key(-1)
     , parser(HTML_Utils::url_parser())
     , image_key("")
+    , b_failed(false)
+    , b_retry(false)
     {}
 
     img_packet(
@@ -199,6 +201,8 @@ struct img_packet
     , parser(_parser)
     , file_path(_file_path)
     , image_key("")
+    , b_failed(false)
+    , b_retry(false)
     {}
 
 
@@ -219,6 +223,10 @@ struct img_packet
     // when this pointer is destroyed
     // (if it's the last shared_ptr for this token)
     std::shared_ptr<checkout_token> img_token;
+    // the image couldn't be downloaded, there is nothing to show
+    bool b_failed;
+    // and it may come another time, e.g. the network was down
+    bool b_retry;
 
 
     bool is_video() const
@@ -307,6 +315,8 @@ public:
         , offset(vector2d())
         , size(vector2d())
         , coord(vector2d())
+        , pixmap(0)
+        , b_current(true)
         {}
 
         sixel_draw(
@@ -319,6 +329,8 @@ public:
         , offset(_offset)
         , size(_size)
         , coord(_coord)
+        , pixmap(_image_data ? _image_data->get_pixmap() : 0)
+        , b_current(true)
         {}
 
 
@@ -326,6 +338,11 @@ public:
         vector2d offset;
         vector2d size;
         vector2d coord;
+        // of image_data when it was drawn, so that an image loaded
+        // again in the same place isn't taken for the one drawn
+        Pixmap pixmap;
+        // drawn since begin_frame()
+        bool b_current;
     };
 
 
@@ -350,7 +367,8 @@ public:
     // x11 info
     x11_info xi;
 
-    void request_image(std::string url, vector2d size, std::string widget_id, std::string thread_num_str = "", int post_num = -1);
+    // job_pool_id defaults to widget_id
+    void request_image(std::string url, vector2d size, std::string widget_id, std::string thread_num_str = "", int post_num = -1, std::string job_pool_id = "");
 
     void free_pixmap(Pixmap pixmap);
     /*
@@ -377,6 +395,8 @@ public:
     // pass to ThreadMan
     // widget_id is the widget the image is to be directed to
     static void threaded_load_img_from_disk(img_packet pac);
+    // tells the widget waiting for the image that it isn't coming
+    void fail_image(img_packet pac, bool b_retry);
     void load_img_from_disk(img_packet pac, std::string job_pool_id = DEFAULT_JOB_POOL_ID);
     // img_packet queue
     threadsafe_queue<img_packet> queue__image_packet;
@@ -414,6 +434,14 @@ public:
     void sync();
     void redraw_buffer(bool b_sync = true);
     void clear_buffer() { sixel_draw_buffer.clear(); };
+    // images drawn between these that are already in the buffer
+    // at the same place and size aren't copied to the window again,
+    // and the ones that aren't drawn are taken out of the buffer.
+    // given a flag for each term row, only the images on the rows
+    // that are set have to be drawn again to stay in the buffer
+    void begin_frame();
+    void begin_frame(const std::vector<uint8_t>& rows);
+    void end_frame();
 
     // actual size is the actual image size
     // image width or height of 0 = use actual image size
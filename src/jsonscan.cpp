@@ -0,0 +1,792 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#include "jsonscan.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define JSON_SCAN_X86
+#include <immintrin.h>
+#endif
+
+// same as gason's
+#define JSON_STACK_SIZE 32
+
+
+namespace JSON_Scan
+{
+
+  /////////////
+ // stage 1 //
+/////////////
+
+// one bit per byte of a 64 byte block
+struct block_masks
+{
+    uint64_t quote;
+    uint64_t backslash;
+    // { } [ ] : ,
+    uint64_t op;
+    uint64_t whitespace;
+    // control characters and DEL, which gason doesn't allow in strings
+    uint64_t ctrl;
+};
+
+
+static void classify_scalar(const uint8_t* p, block_masks& m)
+{
+    m = block_masks();
+
+    for (int i = 0; i < 64; ++i)
+    {
+        uint64_t bit = 1ULL << i;
+        uint8_t c = p[i];
+
+        switch (c)
+        {
+            case '"'    : m.quote |= bit;
+                          break;
+            case '\\'   : m.backslash |= bit;
+                          break;
+            case '{'    :
+            case '}'    :
+            case '['    :
+            case ']'    :
+            case ':'    :
+            case ','    : m.op |= bit;
+                          break;
+            case ' '    :
+            case '\t'   :
+            case '\n'   :
+            case '\r'   : m.whitespace |= bit;
+                          break;
+        }
+
+        if (c < 0x20 || c == 0x7F)
+        {
+            m.ctrl |= bit;
+        }
+    }
+}
+
+
+#ifdef JSON_SCAN_X86
+
+static inline void classify_sse2(const uint8_t* p, block_masks& m)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i ctrl_max = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
+
+    m = block_masks();
+
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+
+        __m128i op = _mm_or_si128(
+            _mm_or_si128(
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('{')),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('}'))),
+                _mm_or_si128(
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8('[')),
+                    _mm_cmpeq_epi8(v, _mm_set1_epi8(']')))),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+
+        // unsigned v <= 0x1F
+        __m128i ctrl = _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl_max), v),
+            _mm_cmpeq_epi8(v, del));
+
+        int shift = i * 16;
+        m.quote |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+        m.backslash |= uint64_t(uint16_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+        m.op |= uint64_t(uint16_t(_mm_movemask_epi8(op))) << shift;
+        m.whitespace |= uint64_t(uint16_t(_mm_movemask_epi8(ws))) << shift;
+        m.ctrl |= uint64_t(uint16_t(_mm_movemask_epi8(ctrl))) << shift;
+    }
+}
+
+
+__attribute__((target("avx2")))
+static inline __attribute__((always_inline))
+void classify_avx2(const uint8_t* p, block_masks& m)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl_max = _mm256_set1_epi8(0x1F);
+    const __m256i del = _mm256_set1_epi8(0x7F);
+
+    m = block_masks();
+
+    for (int i = 0; i < 2; ++i)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 32));
+
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')),
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8('[')),
+                    _mm256_cmpeq_epi8(v, _mm256_set1_epi8(']')))),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+
+        // unsigned v <= 0x1F
+        __m256i ctrl = _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl_max), v),
+            _mm256_cmpeq_epi8(v, del));
+
+        int shift = i * 32;
+        m.quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << shift;
+        m.backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << shift;
+        m.op |= uint64_t(uint32_t(_mm256_movemask_epi8(op))) << shift;
+        m.whitespace |= uint64_t(uint32_t(_mm256_movemask_epi8(ws))) << shift;
+        m.ctrl |= uint64_t(uint32_t(_mm256_movemask_epi8(ctrl))) << shift;
+    }
+}
+
+#endif
+
+
+e_simd_level get_simd_level()
+{
+#ifdef JSON_SCAN_X86
+    static const e_simd_level level =
+        __builtin_cpu_supports("avx2") ? simd_avx2 : simd_sse2;
+    return level;
+#else
+    return simd_scalar;
+#endif
+}
+
+
+// returns the bits of characters escaped by an odd-length run of
+// backslashes. prev_odd carries a run that ends a block over into
+// the next block (the technique is from simdjson)
+static inline uint64_t find_escaped(uint64_t backslash, uint64_t& prev_odd)
+{
+    const uint64_t even_bits = 0x5555555555555555ULL;
+    const uint64_t odd_bits = ~even_bits;
+
+    uint64_t start_edges = backslash & ~(backslash << 1);
+    uint64_t even_start_mask = even_bits ^ prev_odd;
+    uint64_t even_starts = start_edges & even_start_mask;
+    uint64_t odd_starts = start_edges & ~even_start_mask;
+    uint64_t even_carries = backslash + even_starts;
+
+    uint64_t odd_carries;
+    bool b_ends_odd = __builtin_add_overflow(backslash, odd_starts, &odd_carries);
+    odd_carries |= prev_odd;
+    prev_odd = b_ends_odd ? 1ULL : 0ULL;
+
+    uint64_t even_carry_ends = even_carries & ~backslash;
+    uint64_t odd_carry_ends = odd_carries & ~backslash;
+
+    return (even_carry_ends & odd_bits) | (odd_carry_ends & even_bits);
+}
+
+
+// each bit becomes the xor of itself and all bits below it,
+// i.e. set from an opening quote up to its closing quote
+static inline uint64_t prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+
+    return bits;
+}
+
+
+// writes the positions of index_bits to index
+static inline void flatten(std::vector<uint32_t>& index, size_t& count, uint32_t base, uint64_t index_bits)
+{
+    if (count + 64 > index.size())
+    {
+        index.resize(std::max(index.size() * 2, count + 64));
+    }
+
+    uint32_t* out = index.data() + count;
+    while (index_bits)
+    {
+        *out++ = base + __builtin_ctzll(index_bits);
+        index_bits &= index_bits - 1;
+    }
+
+    count = out - index.data();
+}
+
+
+// classifies n blocks at a time, so the call through the
+// simd level's function is paid once per batch, not per block
+typedef void (*classify_blocks_func)(const uint8_t*, size_t, block_masks*);
+
+static void classify_blocks_scalar(const uint8_t* p, size_t n, block_masks* m)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        classify_scalar(p + i * 64, m[i]);
+    }
+}
+
+
+#ifdef JSON_SCAN_X86
+
+static void classify_blocks_sse2(const uint8_t* p, size_t n, block_masks* m)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        classify_sse2(p + i * 64, m[i]);
+    }
+}
+
+
+__attribute__((target("avx2")))
+static void classify_blocks_avx2(const uint8_t* p, size_t n, block_masks* m)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        classify_avx2(p + i * 64, m[i]);
+    }
+}
+
+#endif
+
+
+// fills index with the positions of the structural characters, both
+// quotes of every string, and the first character of every number or
+// literal. returns a JsonErrno.
+static int find_structurals(const uint8_t* json, size_t len, e_simd_level simd_level, std::vector<uint32_t>& index, size_t& count)
+{
+    classify_blocks_func classify_blocks = classify_blocks_scalar;
+#ifdef JSON_SCAN_X86
+    if (simd_level == simd_avx2) classify_blocks = classify_blocks_avx2;
+    if (simd_level == simd_sse2) classify_blocks = classify_blocks_sse2;
+#endif
+
+    const size_t batch_size = 16;
+    block_masks masks[batch_size];
+    uint8_t tail[64];
+
+    uint64_t prev_odd = 0;
+    uint64_t prev_in_string = 0;
+    uint64_t prev_scalar = 0;
+    uint64_t bad_ctrl = 0;
+
+    count = 0;
+    // about one in seven bytes of 4chan's json is indexed
+    if (index.size() < len / 4 + 64)
+    {
+        index.resize(len / 4 + 64);
+    }
+
+    size_t i = 0;
+    while (i < len)
+    {
+        size_t n = std::min(batch_size, (len - i) / 64);
+
+        if (n > 0)
+        {
+            classify_blocks(json + i, n, masks);
+        }
+        // pad the last block with whitespace
+        else
+        {
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, json + i, len - i);
+            classify_blocks(tail, 1, masks);
+            n = 1;
+        }
+
+        for (size_t b = 0; b < n; ++b)
+        {
+            block_masks& m = masks[b];
+
+            uint64_t quote = m.quote & ~find_escaped(m.backslash, prev_odd);
+            // includes the opening quote, excludes the closing one
+            uint64_t in_string = prefix_xor(quote) ^ prev_in_string;
+            prev_in_string = uint64_t(int64_t(in_string) >> 63);
+
+            bad_ctrl |= m.ctrl & in_string;
+
+            uint64_t op = m.op & ~in_string;
+            // anything outside of strings that isn't structural
+            // or whitespace, i.e. numbers, true, false and null
+            uint64_t scalar = ~(m.op | m.whitespace | quote) & ~in_string;
+            uint64_t scalar_starts = scalar & ~((scalar << 1) | prev_scalar);
+            prev_scalar = scalar >> 63;
+
+            flatten(index, count, i + b * 64, op | quote | scalar_starts);
+        }
+
+        i += n * 64;
+    }
+
+    // unterminated string, or raw control characters in one
+    if (prev_in_string || bad_ctrl)
+    {
+        return JSON_BAD_STRING;
+    }
+
+    return JSON_OK;
+}
+
+
+  /////////////
+ // stage 2 //
+/////////////
+
+// the helpers below are gason's, which keeps them static
+
+static inline bool is_delim(char c)
+{
+    return c == ',' || c == ':' || c == ']' || c == '}' ||
+        c == ' ' || (c >= '\t' && c <= '\r') || !c;
+}
+
+
+static inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+
+static inline bool is_xdigit(char c)
+{
+    return (c >= '0' && c <= '9') || ((c & ~' ') >= 'A' && (c & ~' ') <= 'F');
+}
+
+
+static inline int char_to_int(char c)
+{
+    if (c <= '9')
+        return c - '0';
+    return (c & ~' ') - 'A' + 10;
+}
+
+
+static double string_to_double(char* s, char** endptr)
+{
+    char ch = *s;
+    if (ch == '-')
+        ++s;
+
+    double result = 0;
+    while (is_digit(*s))
+        result = (result * 10) + (*s++ - '0');
+
+    if (*s == '.')
+    {
+        ++s;
+
+        double fraction = 1;
+        while (is_digit(*s))
+        {
+            fraction *= 0.1;
+            result += (*s++ - '0') * fraction;
+        }
+    }
+
+    if (*s == 'e' || *s == 'E')
+    {
+        ++s;
+
+        double base = 10;
+        if (*s == '+')
+            ++s;
+        else if (*s == '-')
+        {
+            ++s;
+            base = 0.1;
+        }
+
+        unsigned int exponent = 0;
+        while (is_digit(*s))
+            exponent = (exponent * 10) + (*s++ - '0');
+
+        double power = 1;
+        for (; exponent; exponent >>= 1, base *= base)
+            if (exponent & 1)
+                power *= base;
+
+        result *= power;
+    }
+
+    *endptr = s;
+    return ch == '-' ? -result : result;
+}
+
+
+// unescapes the string between s and its closing quote in place
+// and terminates it. returns a JsonErrno.
+// the text between escapes is moved with memchr/memmove rather than
+// a byte at a time, and isn't touched at all until the first escape
+static int unescape(char* s, char* end)
+{
+    char* it = s;
+    while (true)
+    {
+        char* bs = static_cast<char*>(memchr(s, '\\', end - s));
+        if (!bs) bs = end;
+
+        if (it != s)
+        {
+            memmove(it, s, bs - s);
+        }
+        it += bs - s;
+        s = bs;
+
+        if (s == end) break;
+
+        char c = *++s;
+        switch (c)
+        {
+            case '\\'   :
+            case '"'    :
+            case '/'    : *it = c;
+                          break;
+            case 'b'    : *it = '\b';
+                          break;
+            case 'f'    : *it = '\f';
+                          break;
+            case 'n'    : *it = '\n';
+                          break;
+            case 'r'    : *it = '\r';
+                          break;
+            case 't'    : *it = '\t';
+                          break;
+            case 'u'    :
+            {
+                int u = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    if (s + 1 < end && is_xdigit(*++s))
+                    {
+                        u = u * 16 + char_to_int(*s);
+                    }
+                    else
+                    {
+                        return JSON_BAD_STRING;
+                    }
+                }
+
+                if (u < 0x80)
+                {
+                    *it = u;
+                }
+                else if (u < 0x800)
+                {
+                    *it++ = 0xC0 | (u >> 6);
+                    *it = 0x80 | (u & 0x3F);
+                }
+                else
+                {
+                    *it++ = 0xE0 | (u >> 12);
+                    *it++ = 0x80 | ((u >> 6) & 0x3F);
+                    *it = 0x80 | (u & 0x3F);
+                }
+                break;
+            }
+            default     : return JSON_BAD_STRING;
+        }
+
+        ++it;
+        ++s;
+    }
+
+    *it = 0;
+    return JSON_OK;
+}
+
+
+static inline JsonNode* insert_after(JsonNode* tail, JsonNode* node)
+{
+    if (!tail)
+        return node->next = node;
+    node->next = tail->next;
+    tail->next = node;
+    return node;
+}
+
+
+static inline JsonValue list_to_value(JsonTag tag, JsonNode* tail)
+{
+    if (tail)
+    {
+        auto head = tail->next;
+        tail->next = nullptr;
+        return JsonValue(tag, head);
+    }
+    return JsonValue(tag, nullptr);
+}
+
+
+// hands out nodes from larger blocks of allocator, sparing a call
+// into gason for every value
+struct node_pool
+{
+    node_pool(JsonAllocator& _allocator)
+    : allocator(_allocator)
+    , next(nullptr)
+    , end(nullptr)
+    {}
+
+
+    JsonAllocator& allocator;
+    char* next;
+    char* end;
+
+
+    JsonNode* allocate(size_t size)
+    {
+        if (next + size > end)
+        {
+            // fits in one of gason's zones with its header
+            const size_t block_size = 4096 - 64;
+            next = static_cast<char*>(allocator.allocate(block_size));
+            if (!next) return nullptr;
+            end = next + block_size;
+        }
+
+        JsonNode* node = reinterpret_cast<JsonNode*>(next);
+        next += (size + 7) & ~7;
+
+        return node;
+    }
+};
+
+
+// builds gason's DOM from the index, following jsonParse
+static int build_dom(char* json, const uint32_t* index, size_t count, JsonValue* value, JsonAllocator& allocator)
+{
+    JsonNode* tails[JSON_STACK_SIZE];
+    JsonTag tags[JSON_STACK_SIZE];
+    char* keys[JSON_STACK_SIZE];
+    JsonValue o;
+    // o's string, if it is one. saves going through JsonValue's
+    // accessors, whose asserts show up in the profile
+    char* str;
+    int pos = -1;
+    bool separator = true;
+    JsonNode* node;
+    node_pool pool(allocator);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        char* s = json + index[i];
+        str = nullptr;
+
+        switch (*s)
+        {
+            case '"':
+            {
+                // stage 1 indexes the closing quote right after
+                if (i + 1 >= count) return JSON_BAD_STRING;
+                char* end = json + index[++i];
+                str = s + 1;
+
+                int status = unescape(str, end);
+                if (status != JSON_OK) return status;
+
+                if (!is_delim(end[1])) return JSON_BAD_STRING;
+                o = JsonValue(JSON_STRING, str);
+                break;
+            }
+
+            case '-':
+                if (!is_digit(s[1]) && s[1] != '.') return JSON_BAD_NUMBER;
+            case '0':
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':
+            {
+                char* end;
+                o = JsonValue(string_to_double(s, &end));
+                if (!is_delim(*end)) return JSON_BAD_NUMBER;
+                break;
+            }
+
+            case 't':
+                if (!(s[1] == 'r' && s[2] == 'u' && s[3] == 'e' && is_delim(s[4])))
+                    return JSON_BAD_IDENTIFIER;
+                o = JsonValue(JSON_TRUE);
+                break;
+
+            case 'f':
+                if (!(s[1] == 'a' && s[2] == 'l' && s[3] == 's' && s[4] == 'e' && is_delim(s[5])))
+                    return JSON_BAD_IDENTIFIER;
+                o = JsonValue(JSON_FALSE);
+                break;
+
+            case 'n':
+                if (!(s[1] == 'u' && s[2] == 'l' && s[3] == 'l' && is_delim(s[4])))
+                    return JSON_BAD_IDENTIFIER;
+                o = JsonValue(JSON_NULL);
+                break;
+
+            case ']':
+                if (pos == -1)
+                    return JSON_STACK_UNDERFLOW;
+                if (tags[pos] != JSON_ARRAY)
+                    return JSON_MISMATCH_BRACKET;
+                o = list_to_value(JSON_ARRAY, tails[pos--]);
+                break;
+
+            case '}':
+                if (pos == -1)
+                    return JSON_STACK_UNDERFLOW;
+                if (tags[pos] != JSON_OBJECT)
+                    return JSON_MISMATCH_BRACKET;
+                if (keys[pos] != nullptr)
+                    return JSON_UNEXPECTED_CHARACTER;
+                o = list_to_value(JSON_OBJECT, tails[pos--]);
+                break;
+
+            case '[':
+                if (++pos == JSON_STACK_SIZE)
+                    return JSON_STACK_OVERFLOW;
+                tails[pos] = nullptr;
+                tags[pos] = JSON_ARRAY;
+                keys[pos] = nullptr;
+                separator = true;
+                continue;
+
+            case '{':
+                if (++pos == JSON_STACK_SIZE)
+                    return JSON_STACK_OVERFLOW;
+                tails[pos] = nullptr;
+                tags[pos] = JSON_OBJECT;
+                keys[pos] = nullptr;
+                separator = true;
+                continue;
+
+            case ':':
+                if (pos == -1 || separator || keys[pos] == nullptr)
+                    return JSON_UNEXPECTED_CHARACTER;
+                separator = true;
+                continue;
+
+            case ',':
+                if (pos == -1 || separator || keys[pos] != nullptr)
+                    return JSON_UNEXPECTED_CHARACTER;
+                separator = true;
+                continue;
+
+            default:
+                return JSON_UNEXPECTED_CHARACTER;
+        }
+
+        separator = false;
+
+        if (pos == -1)
+        {
+            // only whitespace, which isn't indexed, may follow the root
+            if (i + 1 < count) return JSON_UNEXPECTED_CHARACTER;
+
+            *value = o;
+            return JSON_OK;
+        }
+
+        if (tags[pos] == JSON_OBJECT)
+        {
+            if (!keys[pos])
+            {
+                if (!str)
+                    return JSON_UNQUOTED_KEY;
+                keys[pos] = str;
+                continue;
+            }
+            if ((node = pool.allocate(sizeof(JsonNode))) == nullptr)
+                return JSON_ALLOCATION_FAILURE;
+            tails[pos] = insert_after(tails[pos], node);
+            tails[pos]->key = keys[pos];
+            keys[pos] = nullptr;
+        }
+        else
+        {
+            if ((node = pool.allocate(sizeof(JsonNode) - sizeof(char*))) == nullptr)
+                return JSON_ALLOCATION_FAILURE;
+            tails[pos] = insert_after(tails[pos], node);
+        }
+        tails[pos]->value = o;
+    }
+
+    return JSON_BREAKING_BAD;
+}
+
+
+int parse(char* json, size_t len, JsonValue* value, JsonAllocator& allocator, bool b_catalog)
+{
+    e_simd_level simd_level = get_simd_level();
+
+    // where the scanner loses to gason (see bench/)
+    if (simd_level == simd_scalar || (simd_level == simd_sse2 && b_catalog))
+    {
+        char* endptr;
+        return jsonParse(json, &endptr, value, allocator);
+    }
+
+    return scan(json, len, value, allocator, simd_level);
+}
+
+
+int scan(char* json, size_t len, JsonValue* value, JsonAllocator& allocator, e_simd_level simd_level)
+{
+    if (!json) return JSON_BREAKING_BAD;
+    // beyond the 32 bit positions of the index
+    if (len >= UINT32_MAX) return JSON_ALLOCATION_FAILURE;
+    if (simd_level > get_simd_level()) simd_level = get_simd_level();
+
+    // kept per worker thread, so its memory is reused between parses
+    thread_local std::vector<uint32_t> index;
+    size_t count = 0;
+
+    int status = find_structurals(
+        reinterpret_cast<const uint8_t*>(json), len, simd_level, index, count);
+    if (status != JSON_OK) return status;
+
+    return build_dom(json, index.data(), count, value, allocator);
+}
+
+};
@@ -0,0 +1,55 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#pragma once
+#include <cstddef>
+#include "../gason/src/gason.h"
+
+
+/*
+ *  A drop-in replacement for gason's jsonParse, built for the
+ *  multi-megabyte catalogs and threads that are re-parsed on every
+ *  refresh.
+ *
+ *  Stage 1 classifies the json 64 bytes at a time (AVX2 or SSE2,
+ *  picked at runtime, with a scalar fallback) into bitmasks of
+ *  quotes, backslashes, structural characters and whitespace, and
+ *  turns them into an index of every structural character, string
+ *  quote and start of a number or literal, skipping over string
+ *  contents without looking at them byte by byte.
+ *
+ *  Stage 2 walks the index and builds the same DOM gason does, with
+ *  strings unescaped in place and nodes taken from a JsonAllocator,
+ *  so the rest of the code can't tell the two apart.
+ *
+ *  bench/ has the fixtures and benchmark comparing it with gason.
+ */
+
+namespace JSON_Scan
+{
+    enum e_simd_level
+    {
+        simd_scalar,
+        simd_sse2,
+        simd_avx2,
+    };
+
+    // the instruction set stage 1 runs with on this cpu
+    e_simd_level get_simd_level();
+
+    // parses json, which has len bytes and must be followed by a '\0'
+    // (as std::string's buffer is), in place. returns a JsonErrno.
+    // falls back to gason's jsonParse where the scanner is slower:
+    // without SIMD, and with only SSE2 on catalogs (b_catalog).
+    int parse(char* json, size_t len, JsonValue* value, JsonAllocator& allocator, bool b_catalog = false);
+    // parse() that always uses the scanner. simd_level can be
+    // lowered, e.g. to compare the code paths (see bench/).
+    // unlike jsonParse, anything but whitespace after the root
+    // value is an error.
+    int scan(char* json, size_t len, JsonValue* value, JsonAllocator& allocator, e_simd_level simd_level);
+};
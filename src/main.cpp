@@ -12,11 +12,19 @@
 #include "netops.h"
 #include "widgetman.h"
 #include "imgman.h"
+#include "archiver.h"
+#include "daemon.h"
+#include "searchindex.h"
+#include <unistd.h>
 #include "../getoptpp/getopt_pp.h"
 
 using namespace std;
 
 int MAX_THREADS = -1;
+// board or thread to archive headlessly
+std::string ARCHIVE_TARGET = "";
+// run as a background daemon that UIs attach to
+bool RUN_DAEMON = false;
 
 // ------ defined extern in comfy.h:
 std::string DATA_DIR = ".comfy/";
@@ -25,6 +33,8 @@ std::string TEMP_DIR = DATA_DIR + "tmp/";
 std::string FLAGS_DIR = DATA_DIR + "4chan/flags/";
 Colors::color_scheme COLO = Colors::COMFYBLUE;
 bool DISPLAY_IMAGES = true;
+int IMG_PREFETCH_ROWS = 100;
+int MAX_FPS = 60;
 // ------
 
 
@@ -60,8 +70,15 @@ void parse_opts(int argc, char* argv[])
     if (ops >> GetOpt::OptionPresent('h', "help"))
     {
         string help =   "Arguments:\n";
+        help +=         "    -a x  or  --archive x            Save board or thread x to disk without the UI and exit,\n";
+        help +=         "                                     where x is a board (e.g. g) or a thread url\n";
         help +=         "    -d    or  --disable-images       Disable images\n";
+        help +=         "          --daemon                   Run in the background, sharing downloads and the cache\n";
+        help +=         "                                     with every UI started while it runs\n";
+        help +=         "          --stop-daemon              Stop a running daemon and exit\n";
         help +=         "    -m n  or  --max-threads n        Set max number of concurrent threads, where n is max number\n";
+        help +=         "    -p n  or  --prefetch-rows n      Load thread images within n rows of the screen (default 100)\n";
+        help +=         "    -f n  or  --fps n                Redraw the screen at most n times a second (default 60)\n";
         help +=         "    -v    or  --version              Print version and exit\n";
         help +=         "    -h    or  --help                 Print help (this message) and exit\n";
         help +=         "\n";
@@ -72,6 +89,8 @@ void parse_opts(int argc, char* argv[])
         help +=         "    CTRL+R                           Reload the focused page from the network\n";
         help +=         "    CTRL+A                           Enable/disable auto-reload\n";
         help +=         "    CTRL+S                           Save currently focused thread\n";
+        help +=         "    CTRL+T                           Show only the selected post's reply chain\n";
+        help +=         "    CTRL+F                           Search the posts of cached and opened threads\n";
         help +=         "    F5                               Do a hard refresh of the screen\n";
         help +=         "    Tab                              Switch between currently opened pages\n";
         help +=         "    Space/Enter                      Choose selection in list\n";
@@ -99,11 +118,44 @@ void parse_opts(int argc, char* argv[])
     // disable images
     DISPLAY_IMAGES = !(ops >> GetOpt::OptionPresent('d', "disable-images"));
 
+    // background daemon
+    RUN_DAEMON = ops >> GetOpt::OptionPresent("daemon");
+
+    if (ops >> GetOpt::OptionPresent("stop-daemon"))
+    {
+        if (!DaemonClient::stop_daemon())
+        {
+            std::cout << "No comfy daemon is running." << std::endl;
+            exit(1);
+        }
+        exit(0);
+    }
+
+    // headless archiving
+    if (ops >> GetOpt::OptionPresent('a', "archive"))
+    {
+        if (ops >> GetOpt::Option('a', "archive", ARCHIVE_TARGET));
+    }
+
     // maximum concurrent threads
     if (ops >> GetOpt::OptionPresent('m', "max-threads"))
     {
         if (ops >> GetOpt::Option('m', "max-threads", MAX_THREADS));
     }
+
+    // how far ahead of the screen thread images are loaded
+    if (ops >> GetOpt::OptionPresent('p', "prefetch-rows"))
+    {
+        if (ops >> GetOpt::Option('p', "prefetch-rows", IMG_PREFETCH_ROWS));
+        if (IMG_PREFETCH_ROWS < 0) IMG_PREFETCH_ROWS = 0;
+    }
+
+    // how often the screen may be redrawn
+    if (ops >> GetOpt::OptionPresent('f', "fps"))
+    {
+        if (ops >> GetOpt::Option('f', "fps", MAX_FPS));
+        if (MAX_FPS < 1) MAX_FPS = 1;
+    }
 }
 
 
@@ -132,10 +184,75 @@ int main(int argc, char* argv[])
     // init
     init_files();
     parse_opts(argc, argv);
+
+    // archive and exit, skipping termbox and X11
+    if (!ARCHIVE_TARGET.empty())
+    {
+        DISPLAY_IMAGES = false;
+        NetOps::init();
+        // downloads mostly wait on the network, so
+        // default to more threads than there are cores
+        THREAD_MAN.init(MAX_THREADS > 0 ? MAX_THREADS : 8);
+
+        int ret = Archiver::run(ARCHIVE_TARGET);
+
+        THREAD_MAN.shutdown();
+        NetOps::shutdown();
+
+        return ret;
+    }
+
+    // fetch in the background, detached from the terminal
+    if (RUN_DAEMON)
+    {
+        if (Daemon::is_running())
+        {
+            std::cout << "A comfy daemon is already running." << std::endl;
+            return 1;
+        }
+
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            std::cout << "Could not start the comfy daemon." << std::endl;
+            return 1;
+        }
+        if (pid > 0)
+        {
+            std::cout << "Comfy daemon started." << std::endl;
+            return 0;
+        }
+
+        setsid();
+        freopen("/dev/null", "r", stdin);
+        freopen("/dev/null", "w", stdout);
+        std::string log_file = DATA_DIR + "daemon_log.txt";
+        freopen(log_file.c_str(), "w", stderr);
+
+        // images are decoded by the UIs
+        DISPLAY_IMAGES = false;
+        NetOps::init();
+        THREAD_MAN.init(MAX_THREADS > 0 ? MAX_THREADS : 8);
+
+        int ret = Daemon::run();
+
+        THREAD_MAN.shutdown();
+        NetOps::shutdown();
+        clean_up_files();
+
+        return ret;
+    }
+
     if (DISPLAY_IMAGES) IMG_MAN.init();
     NetOps::init();
     THREAD_MAN.init(MAX_THREADS);
 
+    // hand requests to a running daemon, if there is one
+    bool b_daemon_cache = DaemonClient::connect();
+
+    // make the threads in the cache searchable
+    SEARCH_INDEX.index_cached_threads();
+
     // load urls from args
     load_urls(argc, argv);
 
@@ -143,10 +260,13 @@ int main(int argc, char* argv[])
     WIDGET_MAN.run();
 
     // shutdown
+    DaemonClient::disconnect();
+    SEARCH_INDEX.shutdown();
     THREAD_MAN.shutdown();
     NetOps::shutdown();
     if (DISPLAY_IMAGES)IMG_MAN.shutdown();
-    clean_up_files();
+    // the cache belongs to the daemon
+    if (!b_daemon_cache) clean_up_files();
 
     return 0;
 }
@@ -10,11 +10,15 @@
 #include "fileops.h"
 #include "widgetman.h"
 #include "imgman.h"
+#include "daemon.h"
 
 
 // thread safe queues
 threadsafe_queue<data_4chan> NetOps::queue__4chan_json;
 
+// how often a page that is still coming in is handed to its widget
+static const int PARTIAL_PUSH_INTERVAL_MS = 150;
+
 
 void NetOps::init()
 {
@@ -34,6 +38,13 @@ void NetOps::shutdown()
 
 void NetOps::http_get__4chan_json(std::string url, std::string wgt_id, bool b_steal_focus, long last_fetch_time, std::string job_pool_id, bool b_push_to_front)
 {
+    // a running daemon fetches it for us
+    if (DaemonClient::attached())
+    {
+        DaemonClient::request_json(url, wgt_id, b_steal_focus, last_fetch_time);
+        return;
+    }
+
     THREAD_MAN.enqueue_job(
         std::bind(curl__get_4chan_json, url, wgt_id, last_fetch_time, b_steal_focus),
         job_pool_id,
@@ -45,6 +56,12 @@ void NetOps::http_get__image(http_image_req& req, std::string job_pool_id, bool
 {
     if (DISPLAY_IMAGES && req.is_valid())
     {
+        if (DaemonClient::attached() &&
+            DaemonClient::request_image(req, job_pool_id))
+        {
+            return;
+        }
+
         THREAD_MAN.enqueue_job(
             std::bind(curl__get_image, req),
             job_pool_id,
@@ -53,6 +70,26 @@ void NetOps::http_get__image(http_image_req& req, std::string job_pool_id, bool
 }
 
 
+void NetOps::http_prefetch__4chan_thread(std::string url, int num_images, std::shared_ptr<cancel_token> token, std::string job_pool_id, bool b_push_to_front)
+{
+    if (!token) return;
+
+    THREAD_MAN.enqueue_job(
+        std::bind(curl__prefetch_4chan_thread, url, num_images, token, job_pool_id),
+        job_pool_id,
+        b_push_to_front);
+}
+
+
+void NetOps::cache_get__4chan_json(std::string url, std::string wgt_id, long fetch_time, std::string job_pool_id)
+{
+    THREAD_MAN.enqueue_job(
+        std::bind(file__get_4chan_json, url, wgt_id, fetch_time, job_pool_id),
+        job_pool_id,
+        true /* b_push_to_front */);
+}
+
+
   ////////////////////
  // curl launching //
 ////////////////////
@@ -60,6 +97,7 @@ void NetOps::http_get__image(http_image_req& req, std::string job_pool_id, bool
 void NetOps::curl__get_4chan_json(std::string url, std::string wgt_id, long last_fetch_time, bool b_steal_focus)
 {
     data_4chan chan_data(url, wgt_id);
+    chan_data.b_steal_focus = b_steal_focus;
     // error: invalid url
     if (!chan_data.url_is_valid())
     {
@@ -69,7 +107,13 @@ void NetOps::curl__get_4chan_json(std::string url, std::string wgt_id, long last
         return;
     }
 
-    std::stringstream out_buf;
+    // a page that is being opened is shown as its posts come in,
+    // reloads of a page that is already shown wait for all of it
+    bool b_stream_posts = b_steal_focus &&
+        (chan_data.parser.pagetype == pt_thread ||
+         chan_data.parser.pagetype == pt_board_catalog);
+
+    json_stream out_buf(chan_data, b_stream_posts);
 
     auto handle = curl_easy_init(); 
     curl_easy_setopt(handle, CURLOPT_URL, chan_data.parser.url.c_str());
@@ -80,7 +124,7 @@ void NetOps::curl__get_4chan_json(std::string url, std::string wgt_id, long last
     curl_easy_setopt(handle, CURLOPT_TIMEVALUE, last_fetch_time);
     curl_easy_setopt(handle, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
 
-    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_data);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_4chan_json);
     // set pointer that is passed to curl write function as fourth param
     curl_easy_setopt(handle, CURLOPT_WRITEDATA, static_cast<void*>(&out_buf)); 
     auto success = curl_easy_perform(handle);
@@ -105,7 +149,22 @@ void NetOps::curl__get_4chan_json(std::string url, std::string wgt_id, long last
         // all is well, parse json
         else
         {
-            if (!chan_data.parse_json(out_buf.str().c_str()))
+            const std::string& json = out_buf.stream.received;
+            bool b_parsed = false;
+
+            // all posts but the last few were parsed as they came in
+            if (b_stream_posts && out_buf.stream.done() &&
+                out_buf.stream.take_posts(*out_buf.page_data))
+            {
+                chan_data.page_data = out_buf.page_data;
+                b_parsed = true;
+            }
+            else
+            {
+                b_parsed = chan_data.parse_json(json);
+            }
+
+            if (!b_parsed)
             {
                 // json parse error
                 chan_data.error_type = et_json_parse;
@@ -113,32 +172,12 @@ void NetOps::curl__get_4chan_json(std::string url, std::string wgt_id, long last
             else
             {
                 std::string f_path = chan_data.file_path;
-                std::string f_name =
-                    std::to_string(time_now_ms().count()) + ".json";
-
                 // save json file to disk
-                switch (chan_data.parser.pagetype)
-                {
-                    case pt_boards_list         :
-                        f_name = "boards_list.json";
-                        break;
-                    case pt_board_page          :
-                        break;
-                    case pt_board_catalog       :
-                        f_name = "catalog.json";
-                        break;
-                    case pt_board_threads       :
-                        break;
-                    case pt_board_archive       :
-                        break;
-                    case pt_thread              :
-                        f_name = "thread.json";
-                        break;
-                }
+                std::string f_name = chan_data.get_file_name();
 
                 if (!f_path.empty() && !f_name.empty())
                 {
-                    FileOps::write_file(f_path, f_name, out_buf.str().c_str(), out_buf.str().length());
+                    FileOps::write_file(f_path, f_name, json.c_str(), json.length());
                 }
             }
 
@@ -148,22 +187,50 @@ void NetOps::curl__get_4chan_json(std::string url, std::string wgt_id, long last
 
     curl_easy_cleanup(handle);
     chan_data.curl_result = success;
-    chan_data.b_steal_focus = b_steal_focus;
 
     // queue data
     queue__4chan_json.push(chan_data);
 }
 
 
+void NetOps::file__get_4chan_json(std::string url, std::string wgt_id, long fetch_time, std::string job_pool_id)
+{
+    data_4chan chan_data(url, wgt_id);
+    std::string path = chan_data.file_path + chan_data.get_file_name();
+    if (!chan_data.url_is_valid() || !FileOps::file_exists(path))
+    {
+        http_get__4chan_json(url, wgt_id, false, 0, job_pool_id);
+        return;
+    }
+
+    std::stringstream buf;
+    FileOps::read_file(buf, path);
+    if (!chan_data.parse_json(buf.str()))
+    {
+        chan_data.error_type = et_json_parse;
+    }
+
+    chan_data.fetch_time = fetch_time;
+    queue__4chan_json.push(chan_data);
+}
+
+
 void NetOps::curl__get_image(http_image_req req)
 {
     if (!DISPLAY_IMAGES) return;
 
+    img_packet pac(
+        req.size,
+        req.thread_key,
+        req.post_key,
+        req.parser,
+        req.get_file_path());
+
     // error: invalid url
     if (!req.url_is_valid())
     {
         req.error_type = e_error_type::et_invalid_url;
-        // TODO: send error message to WIDGET_MAN
+        IMG_MAN.fail_image(pac, false /* retry */);
 
         return;
     }
@@ -187,25 +254,171 @@ void NetOps::curl__get_image(http_image_req req)
         req.error_type = et_http_404;
     }
 
+    curl_easy_cleanup(handle);
+    req.curl_result = success;
+
     if (success == CURLE_OK)
     {
         FileOps::write_file(req.get_file_path(), req.get_file_name(), out_buf.str().c_str(), out_buf.str().length());
 
         // load image and dispatch img_packet to dest widget
-        img_packet pac(
-            req.size,
-            req.thread_key,
-            req.post_key,
-            req.parser,
-            req.get_file_path());
-
         IMG_MAN.threaded_load_img_from_disk(pac);
     }
+    else
+    {
+        IMG_MAN.fail_image(pac, !req.failed_for_good());
+    }
+}
+
 
-    // TODO: send http_image_req back to widget_man for error processing
+void NetOps::curl__prefetch_4chan_thread(std::string url, int num_images, std::shared_ptr<cancel_token> token, std::string job_pool_id)
+{
+    if (!token || token->cancelled()) return;
+
+    data_4chan chan_data(url);
+    if (!chan_data.url_is_valid() ||
+        chan_data.parser.pagetype != e_page_type::pt_thread)
+    {
+        return;
+    }
+
+    std::string f_name = "thread.json";
+    long last_mod = FileOps::last_modified(chan_data.file_path + f_name);
+    std::stringstream out_buf;
+
+    // the json was fetched a moment ago (e.g. the mouse went
+    // back and forth over the same thread), don't get it again
+    if (last_mod != 0 && time_now_s().count() - last_mod < 10)
+    {
+        if (num_images < 1) return;
+        FileOps::read_file(out_buf, chan_data.file_path + f_name);
+    }
+    else
+    {
+        long code;
+        bool b_unmet = false;
+        CURLcode success = curl__get(
+            chan_data.parser.url,
+            out_buf,
+            last_mod,
+            code,
+            b_unmet,
+            token.get());
+
+        if (success != CURLE_OK || token->cancelled()) return;
+
+        // cached json is still current
+        if (b_unmet)
+        {
+            if (num_images < 1) return;
+            FileOps::read_file(out_buf, chan_data.file_path + f_name);
+        }
+        else
+        {
+            // the open thread may read it while it's being written
+            FileOps::write_file_atomic(chan_data.file_path, f_name, out_buf.str().c_str(), out_buf.str().length());
+        }
+    }
+
+    if (num_images < 1 || !chan_data.parse_json(out_buf.str()))
+    {
+        return;
+    }
+
+    // the same images a Post4chanWidget requests
+    int count = 0;
+    for (auto& p : chan_data.page_data->posts)
+    {
+        if (count >= num_images || token->cancelled()) break;
+        if (p.img_time == 0) continue;
+
+        std::string img_url = "https://i.4cdn.org/";
+        img_url += chan_data.parser.board;
+        img_url += "/" + std::to_string(p.img_time);
+        img_url += p.img_ext;
+
+        http_image_req req(
+            img_url,
+            vector2d(-1, POST_IMG_H),
+            chan_data.parser.url,
+            chan_data.parser.thread_num_str,
+            p.num);
+
+        count++;
+
+        if (req.is_video() ||
+            FileOps::file_exists(req.get_file_path() + req.get_file_name()))
+        {
+            continue;
+        }
+
+        THREAD_MAN.enqueue_job(
+            std::bind(curl__prefetch_image, req, token),
+            job_pool_id,
+            false /* b_push_to_front */);
+    }
+}
+
+
+void NetOps::curl__prefetch_image(http_image_req req, std::shared_ptr<cancel_token> token)
+{
+    if (!token || token->cancelled() || !req.url_is_valid()) return;
+
+    std::stringstream out_buf;
+    long code;
+    bool b_unmet = false;
+    CURLcode success = curl__get(
+        req.parser.url, out_buf, 0, code, b_unmet, token.get());
+
+    // only written to the cache, the image is decoded
+    // when the thread is opened and requests it
+    if (success == CURLE_OK && !token->cancelled())
+    {
+        FileOps::write_file_atomic(req.get_file_path(), req.get_file_name(), out_buf.str().c_str(), out_buf.str().length());
+    }
+}
+
+
+CURLcode NetOps::curl__get(const std::string& url, std::stringstream& out_buf, long last_fetch_time, long& http_response, bool& b_unmet, cancel_token* token)
+{
+    auto handle = curl_easy_init(); 
+    curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+    // fail if e.g. http error 404
+    curl_easy_setopt(handle, CURLOPT_FAILONERROR, true);
+
+    // if modified since
+    if (last_fetch_time != 0)
+    {
+        curl_easy_setopt(handle, CURLOPT_TIMEVALUE, last_fetch_time);
+        curl_easy_setopt(handle, CURLOPT_TIMECONDITION, CURL_TIMECOND_IFMODSINCE);
+    }
+
+    // abort the transfer when cancelled
+    if (token)
+    {
+        curl_easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, curl_cancel_progress);
+        curl_easy_setopt(handle, CURLOPT_XFERINFODATA, static_cast<void*>(token));
+        curl_easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
+    }
+
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_data);
+    // set pointer that is passed to curl write function as fourth param
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, static_cast<void*>(&out_buf)); 
+    CURLcode success = curl_easy_perform(handle);
+
+    http_response = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &http_response);
+
+    long unmet = 0;
+    if (success == CURLE_OK)
+    {
+        curl_easy_getinfo(handle, CURLINFO_CONDITION_UNMET, &unmet);
+    }
+    b_unmet = (unmet == 1);
 
     curl_easy_cleanup(handle);
-    req.curl_result = success;
+
+    return success;
 }
 
 
@@ -229,3 +442,50 @@ size_t NetOps::curl_write_data(char* buffer, size_t size, size_t nmemb, void* ou
     return real_size;
 }
 
+
+size_t NetOps::curl_write_4chan_json(char* buffer, size_t size, size_t nmemb, void* out)
+{
+    size_t real_size = size * nmemb;
+
+    json_stream* js = static_cast<json_stream*>(out);
+    js->stream.feed(buffer, real_size);
+
+    // once the page is complete it is handed over as a whole
+    if (!js->b_push_partial || !js->stream.has_posts() || js->stream.done())
+    {
+        return real_size;
+    }
+
+    // the first posts are shown straight away, after that the
+    // widget is rebuilt at most every PARTIAL_PUSH_INTERVAL_MS
+    auto now = time_now_ms();
+    if (js->last_push.count() != 0 &&
+        (now - js->last_push).count() < PARTIAL_PUSH_INTERVAL_MS)
+    {
+        return real_size;
+    }
+
+    if (!js->stream.take_posts(*js->page_data))
+    {
+        // the whole json is parsed again when it is in
+        js->b_push_partial = false;
+        return real_size;
+    }
+    js->last_push = now;
+
+    // the widget gets its own copy, as more posts are added to page_data
+    data_4chan part = js->chan_data;
+    part.page_data = std::make_shared<imageboard::page_data>(*js->page_data);
+    part.b_partial = true;
+    queue__4chan_json.push(part);
+
+    return real_size;
+}
+
+
+int NetOps::curl_cancel_progress(void* token, curl_off_t /* dltotal */, curl_off_t /* dlnow */, curl_off_t /* ultotal */, curl_off_t /* ulnow */)
+{
+    // non-zero return value aborts the transfer
+    cancel_token* t = static_cast<cancel_token*>(token);
+    return (t && t->cancelled()) ? 1 : 0;
+}
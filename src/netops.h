@@ -34,6 +34,7 @@ struct http_request
     , http_response(-1)
     , error_type(e_error_type::et_NONE)
     , file_path("")
+    , thread_num_str("")
     , fetch_time(0)
     {
     }
@@ -44,12 +45,15 @@ struct http_request
     int http_response;
     e_error_type error_type;
     std::string file_path;
+    // thread the file is saved with, if any
+    std::string thread_num_str;
     long fetch_time; // seconds, time file was fetched
 
 
-    void set_url(std::string url, std::string thread_num_str = "")
+    void set_url(std::string url, std::string _thread_num_str = "")
     {
         parser = url_parser(url);
+        thread_num_str = _thread_num_str;
         file_path = get_file_save_dir(parser, thread_num_str);
     }
 
@@ -62,6 +66,16 @@ struct http_request
     {
         return url_is_valid() && error_type == e_error_type::et_NONE;
     }
+
+    // the request failed in a way that asking again won't change,
+    // e.g. 404. timeouts and rate limits are worth another try
+    bool failed_for_good() const
+    {
+        return error_type == e_error_type::et_invalid_url ||
+               error_type == e_error_type::et_http_404 ||
+               (http_response >= 400 && http_response < 500 &&
+                http_response != 408 && http_response != 429);
+    }
 };
 
 
@@ -146,6 +160,8 @@ struct data_4chan : http_request
     : http_request()
     , wgt_id("")
     , b_steal_focus(false)
+    , b_partial(false)
+    , goto_post(-1)
     {
         page_data = std::make_shared<imageboard::page_data>();
     }
@@ -154,6 +170,8 @@ struct data_4chan : http_request
     : http_request()
     , wgt_id(_wgt_id)
     , b_steal_focus(false)
+    , b_partial(false)
+    , goto_post(-1)
     {
         set_url(_url);
         // widget id defaults to url
@@ -170,10 +188,16 @@ struct data_4chan : http_request
     std::string wgt_id;
     std::shared_ptr<imageboard::page_data> page_data;
     bool b_steal_focus;
+    // page_data only holds part of the page (e.g. a thread's
+    // OP taken from the catalog), the rest is still on its way
+    bool b_partial;
+    // post a thread is scrolled to once it's shown, -1 for none
+    int goto_post;
 
 
-    // returns true if there are no parse errors
-    bool parse_json(const char* json)
+    // returns true if there are no parse errors.
+    // page_data keeps the json, as its posts point into it
+    bool parse_json(std::string json)
     {
         if (!page_data) return false;
 
@@ -181,20 +205,33 @@ struct data_4chan : http_request
         {
             case pt_thread          :
                 return JSON_Utils::parse_4chan_thread(
-                    json, *page_data.get());
+                    std::move(json), *page_data.get());
 
             case pt_boards_list     :
                 return JSON_Utils::parse_4chan_boards_list(
-                    json, *page_data.get());
+                    std::move(json), *page_data.get());
 
             case pt_board_catalog   :
                 return JSON_Utils::parse_4chan_catalog(
-                    json, *page_data.get());
+                    std::move(json), *page_data.get());
         }
 
         return false;
     }
 
+    // name the json is saved as in file_path
+    std::string get_file_name() const
+    {
+        switch (parser.pagetype)
+        {
+            case pt_boards_list     : return "boards_list.json";
+            case pt_board_catalog   : return "catalog.json";
+            case pt_thread          : return "thread.json";
+        }
+
+        return std::to_string(time_now_ms().count()) + ".json";
+    }
+
     virtual bool url_is_valid() const override
     {
         return parser.is_valid() && parser.pagetype != e_page_type::pt_UNKNOWN;
@@ -208,6 +245,30 @@ struct data_4chan : http_request
 };
 
 
+// a thread or catalog json that is being received by
+// curl__get_4chan_json, which hands its posts to the
+// widget as they come in if b_push_partial
+struct json_stream
+{
+    json_stream(data_4chan& _chan_data, bool _b_push_partial)
+    : chan_data(_chan_data)
+    , stream(_chan_data.parser.pagetype == pt_board_catalog ? 4 : 3)
+    , b_push_partial(_b_push_partial)
+    , last_push(0)
+    {
+        page_data = std::make_shared<imageboard::page_data>(*_chan_data.page_data);
+    }
+
+
+    data_4chan& chan_data;
+    JSON_Utils::post_stream stream;
+    // the posts that have been received so far
+    std::shared_ptr<imageboard::page_data> page_data;
+    bool b_push_partial;
+    std::chrono::milliseconds last_push;
+};
+
+
 class NetOps
 {
 
@@ -222,13 +283,32 @@ public:
     // get requests
     static void http_get__4chan_json(std::string url, std::string wgt_id = "", bool b_steal_focus = false, long last_fetch_time = 0, std::string job_pool_id = DEFAULT_JOB_POOL_ID, bool b_push_to_front = true);
     static void http_get__image(http_image_req& req, std::string job_pool_id = DEFAULT_JOB_POOL_ID, bool b_push_to_front = true);
+    // downloads a thread's json, and the images of its first
+    // num_images posts, into the cache without handing anything
+    // to a widget. the jobs give up once the token is cancelled.
+    static void http_prefetch__4chan_thread(std::string url, int num_images, std::shared_ptr<cancel_token> token, std::string job_pool_id = DEFAULT_JOB_POOL_ID, bool b_push_to_front = false);
+    // parses the page again from the json saved with it, e.g. so
+    // that changed filters apply. fetch_time is kept as the page's,
+    // so reloads still only get it if it has changed. falls back on
+    // downloading the page if nothing was saved.
+    static void cache_get__4chan_json(std::string url, std::string wgt_id, long fetch_time, std::string job_pool_id = DEFAULT_JOB_POOL_ID);
 
     // curl launching
     static void curl__get_4chan_json(std::string url, std::string wgt_id, long last_fetch_time, bool b_steal_focus);
     static void curl__get_image(http_image_req req);
+    static void curl__prefetch_4chan_thread(std::string url, int num_images, std::shared_ptr<cancel_token> token, std::string job_pool_id);
+    static void curl__prefetch_image(http_image_req req, std::shared_ptr<cancel_token> token);
+    static void file__get_4chan_json(std::string url, std::string wgt_id, long fetch_time, std::string job_pool_id);
+    // blocking get request of url into out_buf. b_unmet is set if
+    // the file hasn't been modified since last_fetch_time.
+    // the transfer is aborted if token is cancelled.
+    static CURLcode curl__get(const std::string& url, std::stringstream& out_buf, long last_fetch_time, long& http_response, bool& b_unmet, cancel_token* token = nullptr);
 
     // curl data processing
     static size_t curl_write_data(char* buffer, size_t size, size_t nmemb, void* out); 
+    // out is a json_stream
+    static size_t curl_write_4chan_json(char* buffer, size_t size, size_t nmemb, void* out);
+    static int curl_cancel_progress(void* token, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
 
 };
 
@@ -0,0 +1,368 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#include "postfilter.h"
+#include "fileops.h"
+#include <queue>
+
+// how often the filters file is checked for changes
+static const std::chrono::milliseconds FILTERS_CHECK_RATE(1000);
+
+
+std::shared_ptr<const PostFilterSet> get_post_filters()
+{
+    return POST_FILTER.get_filters();
+}
+
+
+bool post_is_filtered(const PostFilterSet& filters, const imageboard::post& p, std::string_view board)
+{
+    return filters.matches(p, board);
+}
+
+
+static std::string to_lower(std::string s)
+{
+    for (char& c : s)
+    {
+        if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+    }
+
+    return s;
+}
+
+
+void AhoCorasick::add(const std::string& pattern, uint32_t id)
+{
+    if (!pattern.empty())
+    {
+        patterns.emplace_back(pattern, id);
+    }
+}
+
+
+void AhoCorasick::compile()
+{
+    next.clear();
+    out.clear();
+    if (patterns.empty()) return;
+
+    std::fill(byte_class, byte_class + 256, 0);
+    num_classes = 1;
+    for (auto& p : patterns)
+    {
+        for (char c : p.first)
+        {
+            uint8_t& cls = byte_class[(unsigned char)c];
+            if (cls == 0 && num_classes < 256)
+            {
+                cls = num_classes++;
+            }
+        }
+    }
+
+    // trie, -1 for no child yet
+    next.assign(num_classes, -1);
+    out.emplace_back();
+    for (auto& p : patterns)
+    {
+        int node = 0;
+        for (char c : p.first)
+        {
+            int& child = next[node * num_classes + byte_class[(unsigned char)c]];
+            if (child == -1)
+            {
+                child = out.size();
+                out.emplace_back();
+                next.resize(next.size() + num_classes, -1);
+            }
+            // next may have been resized, so index it again
+            node = next[node * num_classes + byte_class[(unsigned char)c]];
+        }
+        out[node].push_back(p.second);
+    }
+
+    // fill in the missing transitions breadth first with those of
+    // the longest suffix that is in the trie, so scanning is one
+    // table lookup a byte
+    std::vector<int> fail(out.size(), 0);
+    std::queue<int> open;
+    for (int cls = 0; cls < num_classes; ++cls)
+    {
+        int& child = next[cls];
+        if (child == -1)
+        {
+            child = 0;
+        }
+        else
+        {
+            open.push(child);
+        }
+    }
+
+    while (!open.empty())
+    {
+        int node = open.front();
+        open.pop();
+
+        // the patterns that end at its suffix end here too
+        int f = fail[node];
+        out[node].insert(out[node].end(), out[f].begin(), out[f].end());
+
+        for (int cls = 0; cls < num_classes; ++cls)
+        {
+            int& child = next[node * num_classes + cls];
+            int via_fail = next[fail[node] * num_classes + cls];
+            if (child == -1)
+            {
+                child = via_fail;
+            }
+            else
+            {
+                fail[child] = via_fail;
+                open.push(child);
+            }
+        }
+    }
+}
+
+
+bool filter_rule::applies_to(std::string_view board) const
+{
+    return boards.empty() ||
+           std::find(boards.begin(), boards.end(), board) != boards.end();
+}
+
+
+PostFilterSet::PostFilterSet(std::vector<filter_rule> _rules)
+: rules(std::move(_rules))
+, b_needs_text(false)
+{
+    for (uint32_t i = 0; i < rules.size(); ++i)
+    {
+        const filter_rule& r = rules[i];
+        switch (r.field)
+        {
+            case filter_rule::f_text:
+                b_needs_text = true;
+                words.add(to_lower(r.value), i);
+                break;
+
+            case filter_rule::f_name:
+            case filter_rule::f_filename:
+                words.add(to_lower(r.value), i);
+                break;
+
+            case filter_rule::f_trip:
+            case filter_rule::f_id:
+            case filter_rule::f_md5:
+                exact[r.field - filter_rule::f_trip][r.value].push_back(i);
+                break;
+
+            case filter_rule::f_regex:
+            {
+                // each pattern is a regex of its own, joined into
+                // one the backreferences of all but the first would
+                // point at the wrong groups. a pattern that doesn't
+                // compile is left out.
+                try
+                {
+                    regexes.push_back({
+                        i,
+                        std::regex(
+                            r.value,
+                            std::regex::ECMAScript | std::regex::icase | std::regex::optimize)});
+                }
+                catch (const std::regex_error&)
+                {
+                    break;
+                }
+
+                b_needs_text = true;
+                break;
+            }
+        }
+    }
+
+    words.compile();
+}
+
+
+bool PostFilterSet::matches(const imageboard::post& p, std::string_view board) const
+{
+    // tripcodes, ids and md5s
+    std::string_view exact_fields[3] = {p.trip, p.id, p.img_md5};
+    for (int i = 0; i < 3; ++i)
+    {
+        if (exact[i].empty() || exact_fields[i].empty()) continue;
+
+        auto it = exact[i].find(std::string(exact_fields[i]));
+        if (it == exact[i].end()) continue;
+
+        for (uint32_t r : it->second)
+        {
+            if (rules[r].applies_to(board)) return true;
+        }
+    }
+
+    HTML_Utils::comment_text comment;
+    if (b_needs_text)
+    {
+        HTML_Utils::parse_comment(p.text.data(), p.text.length(), comment);
+    }
+
+    auto scan = [&](std::string_view s, filter_rule::e_field field) {
+        return words.scan(s, [&](uint32_t r) {
+            return rules[r].field == field && rules[r].applies_to(board);
+        });
+    };
+
+    if (!words.empty() &&
+        (scan(p.subject, filter_rule::f_text) ||
+         scan(comment.text, filter_rule::f_text) ||
+         scan(p.name, filter_rule::f_name) ||
+         scan(p.img_filename, filter_rule::f_filename)))
+    {
+        return true;
+    }
+
+    for (auto& g : regexes)
+    {
+        if (!rules[g.rule].applies_to(board)) continue;
+
+        // a pattern can run out of stack or hit the complexity
+        // limit on a long comment, it doesn't match it then
+        try
+        {
+            if (std::regex_search(p.subject.begin(), p.subject.end(), g.re) ||
+                std::regex_search(comment.text, g.re))
+            {
+                return true;
+            }
+        }
+        catch (const std::regex_error&)
+        {
+        }
+    }
+
+    return false;
+}
+
+
+std::shared_ptr<const PostFilterSet> PostFilter::get_filters()
+{
+    std::chrono::milliseconds now = time_now_ms();
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        if (now - last_check < FILTERS_CHECK_RATE)
+        {
+            return filters;
+        }
+        last_check = now;
+    }
+
+    reload();
+
+    std::lock_guard<std::mutex> lck(mtx);
+    return filters;
+}
+
+
+void PostFilter::reload()
+{
+    // one reload at a time, other parsers keep using
+    // the rules in effect until the new ones are in
+    std::unique_lock<std::mutex> reload_lck(reload_mtx, std::try_to_lock);
+    if (!reload_lck.owns_lock()) return;
+
+    std::string path = DATA_DIR + FILTERS_FILE;
+    long time = FileOps::last_modified(path);
+    long size = FileOps::file_size(path);
+    if (time == file_time && size == file_size) return;
+
+    // the first load is what every page is parsed with,
+    // nothing has been shown with other rules yet
+    bool b_changed = file_time != -1;
+    file_time = time;
+    file_size = size;
+
+    std::vector<filter_rule> rules;
+    if (time != 0)
+    {
+        rules = parse_rules(FileOps::get_lines_in_file(path));
+    }
+
+    // compiled before taking mtx, the regexes can take a while
+    std::shared_ptr<const PostFilterSet> new_filters;
+    if (!rules.empty())
+    {
+        new_filters = std::make_shared<const PostFilterSet>(std::move(rules));
+    }
+
+    std::lock_guard<std::mutex> lck(mtx);
+    filters = std::move(new_filters);
+    if (b_changed) generation++;
+}
+
+
+std::vector<filter_rule> PostFilter::parse_rules(const std::vector<std::string>& lines)
+{
+    static const std::vector<std::pair<std::string, filter_rule::e_field>> field_names = {
+        {"text:",       filter_rule::f_text},
+        {"name:",       filter_rule::f_name},
+        {"filename:",   filter_rule::f_filename},
+        {"trip:",       filter_rule::f_trip},
+        {"id:",         filter_rule::f_id},
+        {"md5:",        filter_rule::f_md5},
+        {"regex:",      filter_rule::f_regex}
+    };
+
+    std::vector<filter_rule> rules;
+    for (auto& line : lines)
+    {
+        size_t pos = line.find_first_not_of(" \t");
+        if (pos == std::string::npos || line[pos] == '#') continue;
+
+        filter_rule rule;
+
+        // boards, e.g. /g/ /v/
+        while (pos < line.length() && line[pos] == '/')
+        {
+            size_t end = line.find('/', pos + 1);
+            if (end == std::string::npos) break;
+
+            rule.boards.push_back(line.substr(pos + 1, end - pos - 1));
+            pos = line.find_first_not_of(" \t", end + 1);
+        }
+
+        if (pos == std::string::npos) continue;
+
+        bool b_valid = false;
+        for (auto& f : field_names)
+        {
+            if (line.compare(pos, f.first.length(), f.first) == 0)
+            {
+                rule.field = f.second;
+                rule.value = line.substr(pos + f.first.length());
+                b_valid = true;
+                break;
+            }
+        }
+
+        // trailing whitespace (and \r) is rarely meant to be part of the value
+        size_t last = rule.value.find_last_not_of(" \t\r");
+        rule.value.resize(last == std::string::npos ? 0 : last + 1);
+
+        if (b_valid && !rule.value.empty())
+        {
+            rules.push_back(std::move(rule));
+        }
+    }
+
+    return rules;
+}
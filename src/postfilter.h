@@ -0,0 +1,192 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#pragma once
+#include "comfy.h"
+#include <regex>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+
+// finds every one of a set of strings in a text in one pass.
+// texts are matched lowercased (ascii only), so the patterns
+// should be added lowercase.
+class AhoCorasick
+{
+
+public:
+
+    AhoCorasick() : num_classes(1) {};
+
+    // id is what scan() passes on when pattern is found
+    void add(const std::string& pattern, uint32_t id);
+    // builds the automaton, after which patterns can't be added
+    void compile();
+    bool empty() const { return patterns.empty(); };
+
+    // calls fn(id) for each pattern found in text, until fn returns true.
+    // returns true if it did
+    template <typename F>
+    bool scan(std::string_view text, F fn) const
+    {
+        if (next.empty()) return false;
+
+        int node = 0;
+        for (char c : text)
+        {
+            unsigned char u = (unsigned char)c;
+            if (u >= 'A' && u <= 'Z') u += 'a' - 'A';
+            node = next[node * num_classes + byte_class[u]];
+
+            for (uint32_t id : out[node])
+            {
+                if (fn(id)) return true;
+            }
+        }
+
+        return false;
+    }
+
+
+protected:
+
+    std::vector<std::pair<std::string, uint32_t>> patterns;
+
+    // bytes that are in no pattern share class 0, so
+    // the table only needs a column for the rest
+    uint8_t byte_class[256];
+    int num_classes;
+    // node * num_classes + class -> node
+    std::vector<int> next;
+    // ids of the patterns that end at each node
+    std::vector<std::vector<uint32_t>> out;
+
+};
+
+
+// one line of the filters file
+struct filter_rule
+{
+    enum e_field
+    {
+        f_text,         // subject and comment
+        f_name,
+        f_filename,
+        f_trip,
+        f_id,
+        f_md5,
+        f_regex         // subject and comment
+    };
+
+    e_field field;
+    std::string value;
+    // boards it applies to, all if empty
+    std::vector<std::string> boards;
+
+    bool applies_to(std::string_view board) const;
+};
+
+
+// the rules of the filters file, compiled so that a post is checked
+// against all of them with one pass over each of its fields: the
+// words go into one Aho-Corasick automaton and the tripcodes, ids
+// and md5s into hash tables. patterns are compiled one by one.
+class PostFilterSet
+{
+
+public:
+
+    PostFilterSet(std::vector<filter_rule> _rules);
+
+    bool empty() const { return rules.empty(); };
+    bool matches(const imageboard::post& p, std::string_view board) const;
+
+
+protected:
+
+    std::vector<filter_rule> rules;
+
+    AhoCorasick words;
+    // value -> rules
+    std::unordered_map<std::string, std::vector<uint32_t>> exact[3];
+
+    struct regex_rule
+    {
+        uint32_t rule;
+        std::regex re;
+    };
+    std::vector<regex_rule> regexes;
+
+    // subject and comment have to be taken out of their html
+    bool b_needs_text;
+
+};
+
+
+// the filters file (FILTERS_FILE in DATA_DIR), one rule a line:
+//
+//     [/board/ ...] field:value
+//
+// field is text, name, filename, trip, id, md5 or regex. text, name
+// and filename match when the value is anywhere in the field, trip,
+// id and md5 only when it's all of it, and regex is an ECMAScript
+// pattern searched for in the subject and comment. all but trip, id
+// and md5 ignore case. lines starting with # are comments.
+//
+// posts that match are dropped from a page while it is parsed,
+// except the op of a thread. the filters are fetched once per page.
+// the file is checked for changes at most once a second. pages
+// parsed after a change use the new rules, and open pages are
+// parsed again when they see the generation change.
+class PostFilter
+{
+
+public:
+// leave the constructor empty so that nothing is executed when the static instance is fetched
+    PostFilter() {};
+
+    // delete these functions for use as singleton
+    PostFilter(PostFilter const&)     = delete;
+    void operator=(PostFilter const&)  = delete;
+
+    static PostFilter& get_instance()
+    {
+        static PostFilter post_filter;
+        return post_filter;
+    }
+
+
+    // the rules in effect, nullptr if there are none
+    std::shared_ptr<const PostFilterSet> get_filters();
+    // goes up each time the rules change
+    uint32_t get_generation() const { return generation; };
+
+    static std::vector<filter_rule> parse_rules(const std::vector<std::string>& lines);
+
+
+protected:
+
+    // guards filters and last_check only, so fetching the
+    // filters never waits on a reload
+    std::mutex mtx;
+    std::shared_ptr<const PostFilterSet> filters;
+    std::chrono::milliseconds last_check{0};
+
+    // held while reloading, and guards the file's
+    // time and size when it was last loaded
+    std::mutex reload_mtx;
+    long file_time = -1;
+    long file_size = -1;
+
+    std::atomic<uint32_t> generation{0};
+
+    // checks the file and swaps in the rules compiled from it
+    void reload();
+
+};
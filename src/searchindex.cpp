@@ -0,0 +1,399 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#include "searchindex.h"
+#include "threadman.h"
+#include "fileops.h"
+#include "netops.h"
+#include <cmath>
+
+static const std::string SEARCH_JOB_POOL_ID = "SEARCH_INDEX";
+// bytes of a post kept to show in the results
+static const size_t EXCERPT_LEN = 160;
+// words a prefix can stand for, so that a query of a letter
+// or two doesn't have to go through most of the index
+static const size_t MAX_PREFIX_WORDS = 256;
+// bm25 parameters
+static const float BM25_K1 = 1.2f;
+static const float BM25_B = 0.75f;
+
+
+void SearchIndex::index_thread(std::shared_ptr<const imageboard::page_data> data)
+{
+    if (!data || data->posts.empty()) return;
+
+    THREAD_MAN.enqueue_job(
+        [data]() { SEARCH_INDEX.add_thread(*data); },
+        SEARCH_JOB_POOL_ID,
+        false /* b_push_to_front */);
+}
+
+
+void SearchIndex::index_cached_threads()
+{
+    if (cache_indexer.joinable()) return;
+
+    b_stop_cache_indexer = false;
+
+    // a thread of its own, rather than a job per thread.json on the
+    // workers, so that a big cache doesn't hold up the images and
+    // pages being loaded for the ui
+    cache_indexer = std::thread([this]() {
+        std::string chan_dir = IMAGEBOARDS_DIR + "4chan/";
+        if (!FileOps::valid_dir(chan_dir)) return;
+
+        for (auto& board_dir : FileOps::get_dir_contents(chan_dir))
+        {
+            std::string threads_dir = board_dir + "/threads/";
+            if (!FileOps::valid_dir(threads_dir)) continue;
+
+            std::string board = board_dir.substr(board_dir.find_last_of('/') + 1);
+
+            for (auto& thread_dir : FileOps::get_dir_contents(threads_dir))
+            {
+                if (b_stop_cache_indexer) return;
+
+                std::string json_path = thread_dir + "/thread.json";
+                if (!FileOps::file_exists(json_path)) continue;
+
+                std::string thread_num = thread_dir.substr(thread_dir.find_last_of('/') + 1);
+                data_4chan chan_data("a.4cdn.org/" + board + "/thread/" + thread_num + ".json");
+                std::stringstream buf;
+                FileOps::read_file(buf, json_path);
+                if (chan_data.parse_json(buf.str()))
+                {
+                    add_thread(*chan_data.page_data);
+                }
+            }
+        }
+    });
+}
+
+
+void SearchIndex::shutdown()
+{
+    b_stop_cache_indexer = true;
+
+    if (cache_indexer.joinable())
+    {
+        cache_indexer.join();
+    }
+}
+
+
+void SearchIndex::split_post(const imageboard::post& p, doc_words& out)
+{
+    out.post_num = p.num;
+    out.length = 0;
+
+    HTML_Utils::comment_text comment;
+    HTML_Utils::parse_comment(p.text.data(), p.text.length(), comment);
+
+    auto count = [&out](const std::string& word) {
+        uint16_t& c = out.counts[word];
+        if (c < UINT16_MAX) c++;
+        out.length++;
+    };
+
+    for_each_search_word(comment.text, count);
+    for_each_search_word(p.subject, count);
+    for_each_search_word(p.name, count);
+    for_each_search_word(p.trip, count);
+    for_each_search_word(p.id, count);
+    for_each_search_word(p.img_filename, count);
+
+    if (!p.subject.empty())
+    {
+        out.excerpt = HTML_Utils::comment_to_text(p.subject.data(), p.subject.length()) + " | ";
+    }
+    out.excerpt += comment.text;
+
+    for (char& c : out.excerpt)
+    {
+        if (c == '\n' || c == '\t') c = ' ';
+    }
+
+    // cut at a character boundary
+    if (out.excerpt.length() > EXCERPT_LEN)
+    {
+        size_t len = EXCERPT_LEN;
+        while (len > 0 && ((unsigned char)out.excerpt[len] & 0xC0) == 0x80)
+        {
+            len--;
+        }
+        out.excerpt.resize(len);
+    }
+}
+
+
+void SearchIndex::add_thread(const imageboard::page_data& data)
+{
+    int thread_num = 0;
+    for (auto& p : data.posts)
+    {
+        if (p.b_op)
+        {
+            thread_num = p.num;
+            break;
+        }
+    }
+
+    // posts that have been indexed before are skipped
+    std::set<int> known;
+    {
+        std::shared_lock<std::shared_mutex> lck(mtx);
+
+        auto it = thread_ids.find(data.url);
+        if (it != thread_ids.end())
+        {
+            for (auto& post : threads[it->second].posts)
+            {
+                known.insert(post.first);
+            }
+        }
+    }
+
+    std::vector<doc_words> new_docs;
+    for (auto& p : data.posts)
+    {
+        if (known.count(p.num) == 0)
+        {
+            new_docs.emplace_back();
+            split_post(p, new_docs.back());
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lck(mtx);
+
+    uint32_t thread_id;
+    auto it = thread_ids.find(data.url);
+    if (it != thread_ids.end())
+    {
+        thread_id = it->second;
+    }
+    else
+    {
+        thread_id = threads.size();
+        thread_ids[data.url] = thread_id;
+        threads.emplace_back();
+        threads.back().url = data.url;
+        threads.back().board = data.board;
+        threads.back().num = thread_num;
+    }
+
+    thread_entry& thread = threads[thread_id];
+
+    // the posts that have been deleted since
+    if (!known.empty())
+    {
+        std::set<int> nums;
+        for (auto& p : data.posts)
+        {
+            nums.insert(p.num);
+        }
+
+        for (auto& post : thread.posts)
+        {
+            if (nums.count(post.first) == 0)
+            {
+                docs[post.second].b_deleted = true;
+            }
+        }
+    }
+
+    for (auto& dw : new_docs)
+    {
+        // indexed by another worker in the meantime
+        if (thread.posts.count(dw.post_num)) continue;
+
+        uint32_t doc_id = docs.size();
+        docs.push_back({thread_id, dw.post_num, dw.length, false, std::move(dw.excerpt)});
+        thread.posts[dw.post_num] = doc_id;
+        total_length += dw.length;
+
+        for (auto& wc : dw.counts)
+        {
+            words[wc.first].push_back({doc_id, wc.second});
+        }
+    }
+
+    generation++;
+}
+
+
+void SearchIndex::score_word(const std::string& word, bool b_prefix, std::vector<std::pair<uint32_t, float>>& out)
+{
+    out.clear();
+
+    float num_docs = docs.size();
+    float avg_length = num_docs > 0 ? (float)total_length / num_docs : 1;
+    if (avg_length <= 0) avg_length = 1;
+
+    auto add = [&](const std::vector<posting>& postings) {
+        // rarer words count for more
+        float df = postings.size();
+        float idf = std::log(1.0f + (num_docs - df + 0.5f) / (df + 0.5f));
+
+        for (auto& p : postings)
+        {
+            const doc& d = docs[p.doc];
+            if (d.b_deleted) continue;
+
+            float tf = p.count;
+            float norm = BM25_K1 * (1.0f - BM25_B + BM25_B * d.length / avg_length);
+            out.emplace_back(p.doc, idf * tf * (BM25_K1 + 1.0f) / (tf + norm));
+        }
+    };
+
+    if (!b_prefix)
+    {
+        auto it = words.find(word);
+        if (it != words.end())
+        {
+            add(it->second);
+        }
+
+        return;
+    }
+
+    size_t num_words = 0;
+    for (auto it = words.lower_bound(word);
+         it != words.end() && num_words < MAX_PREFIX_WORDS &&
+         it->first.compare(0, word.length(), word) == 0;
+         ++it, ++num_words)
+    {
+        add(it->second);
+    }
+
+    if (num_words < 2) return;
+
+    // a post with several of the words is one hit
+    std::sort(out.begin(), out.end());
+    size_t n = 0;
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        if (n > 0 && out[n - 1].first == out[i].first)
+        {
+            out[n - 1].second += out[i].second;
+        }
+        else
+        {
+            out[n++] = out[i];
+        }
+    }
+    out.resize(n);
+}
+
+
+std::vector<search_hit> SearchIndex::search(const std::string& query, size_t max_hits)
+{
+    std::vector<std::string> query_words;
+    for_each_search_word(query, [&query_words](const std::string& word) {
+        if (std::find(query_words.begin(), query_words.end(), word) == query_words.end())
+        {
+            query_words.push_back(word);
+        }
+    });
+
+    std::vector<search_hit> hits;
+    if (query_words.empty()) return hits;
+
+    // the last word is still being typed
+    unsigned char last = query.back();
+    bool b_prefix = last >= 0x80 || std::isalnum(last);
+
+    std::shared_lock<std::shared_mutex> lck(mtx);
+
+    std::vector<std::vector<std::pair<uint32_t, float>>> scored(query_words.size());
+    for (size_t i = 0; i < query_words.size(); ++i)
+    {
+        bool b_last = i + 1 == query_words.size();
+        score_word(query_words[i], b_last && b_prefix, scored[i]);
+
+        // no post has all of the words
+        if (scored[i].empty()) return hits;
+    }
+
+    // intersect, starting with the fewest posts
+    std::sort(
+        scored.begin(),
+        scored.end(),
+        [](const std::vector<std::pair<uint32_t, float>>& a,
+           const std::vector<std::pair<uint32_t, float>>& b) {
+            return a.size() < b.size();
+        });
+
+    std::vector<std::pair<uint32_t, float>> result = std::move(scored[0]);
+    for (size_t i = 1; i < scored.size() && !result.empty(); ++i)
+    {
+        const std::vector<std::pair<uint32_t, float>>& other = scored[i];
+        size_t n = 0;
+        size_t j = 0;
+        for (size_t k = 0; k < result.size(); ++k)
+        {
+            // the other list is usually much longer
+            j = std::lower_bound(
+                other.begin() + j,
+                other.end(),
+                result[k].first,
+                [](const std::pair<uint32_t, float>& p, uint32_t doc) {
+                    return p.first < doc;
+                }) - other.begin();
+
+            if (j == other.size()) break;
+
+            if (other[j].first == result[k].first)
+            {
+                result[n].first = result[k].first;
+                result[n].second = result[k].second + other[j].second;
+                n++;
+            }
+        }
+        result.resize(n);
+    }
+
+    // best first, then newest first
+    auto better = [](const std::pair<uint32_t, float>& a, const std::pair<uint32_t, float>& b) {
+        if (a.second != b.second) return a.second > b.second;
+        return a.first > b.first;
+    };
+
+    if (result.size() > max_hits)
+    {
+        std::partial_sort(result.begin(), result.begin() + max_hits, result.end(), better);
+        result.resize(max_hits);
+    }
+    else
+    {
+        std::sort(result.begin(), result.end(), better);
+    }
+
+    for (auto& r : result)
+    {
+        const doc& d = docs[r.first];
+        const thread_entry& t = threads[d.thread];
+
+        hits.emplace_back();
+        search_hit& hit = hits.back();
+        hit.thread_url = t.url;
+        hit.board = t.board;
+        hit.thread_num = t.num;
+        hit.post_num = d.post_num;
+        hit.score = r.second;
+        hit.excerpt = d.excerpt;
+    }
+
+    return hits;
+}
+
+
+size_t SearchIndex::num_posts()
+{
+    std::shared_lock<std::shared_mutex> lck(mtx);
+    return docs.size();
+}
@@ -0,0 +1,192 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#pragma once
+#include "comfy.h"
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
+
+
+// a post found by SearchIndex::search
+struct search_hit
+{
+    search_hit()
+    : thread_num(0)
+    , post_num(0)
+    , score(0)
+    {}
+
+    std::string thread_url;
+    std::string board;
+    int thread_num;
+    int post_num;
+    float score;
+    // the start of the post's subject and text
+    std::string excerpt;
+};
+
+
+// full-text index of the posts of every thread that has been shown,
+// and of the threads in the disk cache (IMAGEBOARDS_DIR) when comfy
+// starts.
+//
+// post text (with the html taken out), subject, name, tripcode,
+// poster id and file name are split into lowercase words, and each
+// word maps to the posts it is in, in the order the posts were
+// indexed. a thread that is shown again only has its new posts
+// indexed. the words are found and counted on THREAD_MAN's workers,
+// so only merging them into the index holds the lock.
+//
+// searches return the posts that have all of the words of the query,
+// ranked by bm25, and are a few sorted list intersections, so they
+// stay well under a frame for tens of thousands of posts.
+class SearchIndex
+{
+
+public:
+// leave the constructor empty so that nothing is executed when the static instance is fetched
+    SearchIndex() {};
+
+    // delete these functions for use as singleton
+    SearchIndex(SearchIndex const&)     = delete;
+    void operator=(SearchIndex const&)  = delete;
+
+    static SearchIndex& get_instance()
+    {
+        static SearchIndex search_index;
+        return search_index;
+    }
+
+
+    // indexes the posts of a thread that haven't been, on a worker
+    void index_thread(std::shared_ptr<const imageboard::page_data> data);
+    // indexes every thread.json in the disk cache, one at a
+    // time on a thread of its own
+    void index_cached_threads();
+    // stops indexing the disk cache
+    void shutdown();
+
+    // posts with all of the words in query, best first. unless the
+    // query ends with a space its last word also matches longer
+    // words it's the start of, so results can follow typing.
+    std::vector<search_hit> search(const std::string& query, size_t max_hits = 200);
+
+    size_t num_posts();
+    // goes up each time posts are added, e.g. so that
+    // a search can be run again as the index fills in
+    uint32_t get_generation() const { return generation; };
+
+
+protected:
+
+    struct posting
+    {
+        uint32_t doc;
+        // times the word is in the post
+        uint16_t count;
+    };
+
+    struct doc
+    {
+        uint32_t thread;
+        int post_num;
+        // in words
+        uint32_t length;
+        bool b_deleted;
+        std::string excerpt;
+    };
+
+    struct thread_entry
+    {
+        std::string url;
+        std::string board;
+        int num;
+        // post num -> doc
+        std::map<int, uint32_t> posts;
+    };
+
+    // a post split into words, before it is added
+    struct doc_words
+    {
+        int post_num;
+        std::string excerpt;
+        std::map<std::string, uint16_t> counts;
+        uint32_t length;
+    };
+
+    std::shared_mutex mtx;
+    std::vector<doc> docs;
+    std::vector<thread_entry> threads;
+    // thread url -> threads index
+    std::map<std::string, uint32_t> thread_ids;
+    // sorted, so that the words starting with a
+    // prefix are next to each other
+    std::map<std::string, std::vector<posting>> words;
+    uint64_t total_length = 0;
+    std::atomic<uint32_t> generation{0};
+
+    std::thread cache_indexer;
+    std::atomic<bool> b_stop_cache_indexer{false};
+
+    void add_thread(const imageboard::page_data& data);
+    static void split_post(const imageboard::post& p, doc_words& out);
+
+    // the docs with word (or, if b_prefix, any word starting with
+    // it) and their score for it, sorted by doc
+    void score_word(const std::string& word, bool b_prefix, std::vector<std::pair<uint32_t, float>>& out);
+
+};
+
+
+// splits text into lowercase words, calling fn(word) for each.
+// words are runs of ascii letters and digits and of non-ascii
+// characters (so e.g. japanese text is kept whole between
+// punctuation). single ascii characters are skipped.
+template <typename F>
+static void for_each_search_word(std::string_view text, F fn)
+{
+    // longer words are cut off, which rarely merges two
+    static const size_t max_word_len = 48;
+
+    std::string word;
+    // the word has been cut off, at the start of a character
+    bool b_cut = false;
+    auto flush = [&]() {
+        if (word.length() > 1 || (!word.empty() && (unsigned char)word[0] >= 0x80))
+        {
+            fn(word);
+        }
+        word.clear();
+        b_cut = false;
+    };
+
+    for (char c : text)
+    {
+        unsigned char u = (unsigned char)c;
+        if (u >= 0x80 || std::isalnum(u))
+        {
+            // the rest of a character that was started is kept
+            if ((u & 0xC0) != 0x80 && word.length() >= max_word_len)
+            {
+                b_cut = true;
+            }
+
+            if (!b_cut)
+            {
+                word.push_back(u < 0x80 ? (char)std::tolower(u) : c);
+            }
+        }
+        else
+        {
+            flush();
+        }
+    }
+
+    flush();
+}
@@ -8,6 +8,9 @@
  */
 #pragma once
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
 
 
 static void str_to_lower(std::string& str)
@@ -17,63 +20,175 @@ static void str_to_lower(std::string& str)
 }
 
 
-static std::wstring str_to_wstring(const char* utf8Bytes)
-{
-    //setup converter
-    using convert_type = std::codecvt_utf8<typename std::wstring::value_type>;
-    std::wstring_convert<convert_type, typename std::wstring::value_type> converter;
+/*
+ *  UTF-8
+ *
+ *  Text stays UTF-8 from the json to the widgets, and is only
+ *  decoded into code points where it goes into tb_cells.
+ */
 
-    //use converter (.to_bytes: wstr->str, .from_bytes: str->wstr)
-    return converter.from_bytes(utf8Bytes);
+// appends code point cp to out
+static void utf8_encode(uint32_t cp, std::string& out)
+{
+    if (cp < 0x80)
+    {
+        out.push_back((char)cp);
+    }
+    else if (cp < 0x800)
+    {
+        out.push_back((char)(0xC0 | (cp >> 6)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000)
+    {
+        out.push_back((char)(0xE0 | (cp >> 12)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+    else
+    {
+        out.push_back((char)(0xF0 | (cp >> 18)));
+        out.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back((char)(0x80 | (cp & 0x3F)));
+    }
 }
 
 
-static std::wstring str_to_wstring(const std::string& str)
+// decodes the code point at s[i] and moves i past it. malformed
+// sequences (overlong, surrogates, above U+10FFFF or cut off) are
+// decoded as U+FFFD, one byte at a time.
+static inline uint32_t utf8_decode(const char* s, size_t len, size_t& i)
 {
-    return str_to_wstring(str.c_str());
-}
+    const unsigned char* u = (const unsigned char*)s;
+    uint32_t c = u[i];
 
+    if (c < 0x80)
+    {
+        i++;
+        return c;
+    }
 
-//std::wstring s2ws(const std::string& str)
-//{
-//    using convert_typeX = std::codecvt_utf8<wchar_t>;
-//    std::wstring_convert<convert_typeX, wchar_t> converterX;
-//
-//    return converterX.from_bytes(str);
-//}
+    size_t n = 0;
+    uint32_t min = 0;
+    if ((c & 0xE0) == 0xC0)
+    {
+        n = 1;
+        min = 0x80;
+        c &= 0x1F;
+    }
+    else if ((c & 0xF0) == 0xE0)
+    {
+        n = 2;
+        min = 0x800;
+        c &= 0x0F;
+    }
+    else if ((c & 0xF8) == 0xF0)
+    {
+        n = 3;
+        min = 0x10000;
+        c &= 0x07;
+    }
+    else
+    {
+        i++;
+        return 0xFFFD;
+    }
+
+    // cut off
+    if (i + n >= len)
+    {
+        i++;
+        return 0xFFFD;
+    }
 
+    for (size_t k = 1; k <= n; ++k)
+    {
+        if ((u[i + k] & 0xC0) != 0x80)
+        {
+            i++;
+            return 0xFFFD;
+        }
 
-static std::string wstr_to_string(const std::wstring& wstr)
-{
-    using convert_type = std::codecvt_utf8<typename std::wstring::value_type>;
-    std::wstring_convert<convert_type, typename std::wstring::value_type> converter;
+        c = (c << 6) | (u[i + k] & 0x3F);
+    }
 
-    return converter.to_bytes(wstr);
+    if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF))
+    {
+        i++;
+        return 0xFFFD;
+    }
+
+    i += n + 1;
+    return c;
 }
 
 
-// str is modified
-static void replace_substr(std::string& str, std::string substr, std::string repl)
+// number of leading bytes of s that are ascii, checked 8 at a time
+static inline size_t utf8_ascii_prefix(const char* s, size_t len)
 {
-    size_t index = 0;
-    for(;;)
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
     {
-        index = str.find(substr, index);
-        if (index == std::string::npos)
+        uint64_t chunk;
+        std::memcpy(&chunk, s + i, 8);
+        if (chunk & 0x8080808080808080ULL)
         {
             break;
         }
+    }
 
-        str.replace(index, substr.length(), repl);
+    while (i < len && !(s[i] & 0x80))
+    {
+        i++;
+    }
+
+    return i;
+}
+
+
+// columns cp takes up on the terminal: 0 for combining marks and
+// other zero width chars, 2 for east asian wide and fullwidth
+// chars, 1 for the rest (see stringutils.cpp)
+int char_width(uint32_t cp);
+
+
+// columns str takes up on the terminal
+static int utf8_width(std::string_view str)
+{
+    size_t len = str.length();
+    size_t i = utf8_ascii_prefix(str.data(), len);
+    int width = i;
+
+    while (i < len)
+    {
+        width += char_width(utf8_decode(str.data(), len, i));
+
+        size_t ascii = utf8_ascii_prefix(str.data() + i, len - i);
+        width += ascii;
+        i += ascii;
+    }
+
+    return width;
+}
+
+
+static std::string wstr_to_string(const std::wstring& wstr)
+{
+    std::string out;
+    out.reserve(wstr.length());
+    for (wchar_t ch : wstr)
+    {
+        utf8_encode((uint32_t)ch, out);
     }
+
+    return out;
 }
 
 
 // str is modified
-static void replace_substr(std::wstring& str, char* _substr, char* _repl)
+static void replace_substr(std::string& str, std::string substr, std::string repl)
 {
-    std::wstring substr = str_to_wstring(_substr);
-    std::wstring repl = str_to_wstring(_repl);
     size_t index = 0;
     for(;;)
     {
@@ -95,6 +95,54 @@ void ThreadMan::enqueue_job(std::function<void()> job, const std::string& job_po
 }
 
 
+void ThreadMan::parallel_for(size_t count, std::function<void(size_t)> fn, const std::string& job_pool_id)
+{
+    if (count == 0) return;
+
+    // shared with the jobs, which may only get to run after
+    // parallel_for has returned and find nothing left to do
+    struct work
+    {
+        std::function<void(size_t)> fn;
+        size_t count;
+        std::atomic<size_t> next;
+        std::atomic<size_t> done;
+    };
+
+    std::shared_ptr<work> w = std::make_shared<work>();
+    w->fn = fn;
+    w->count = count;
+    w->next = 0;
+    w->done = 0;
+
+    auto run = [w]() {
+        size_t i;
+        while ((i = w->next.fetch_add(1)) < w->count)
+        {
+            w->fn(i);
+            w->done.fetch_add(1);
+        }
+    };
+
+    int helpers = std::min<size_t>(MAX_THREADS, count - 1);
+    for (int i = 0; i < helpers; ++i)
+    {
+        enqueue_job(run, job_pool_id, true /* b_push_to_front */);
+    }
+
+    run();
+
+    // wait for the items other threads are still working on
+    while (w->done.load() < count)
+    {
+        std::this_thread::yield();
+    }
+
+    // jobs that haven't started yet
+    kill_jobs(job_pool_id);
+}
+
+
 void ThreadMan::kill_jobs(const std::string& job_pool_id)
 {
     job_pool_list.remove(job_pool_id);
@@ -15,6 +15,7 @@
 #include <shared_mutex>
 #include <functional>
 #include <thread>
+#include <atomic>
 
 template <typename T>
 struct threadsafe_queue;
@@ -55,6 +56,31 @@ struct checkout_token
 };
 
 
+// handed to jobs so that the code that queued them can call
+// them off, even after they have left their job pool
+struct cancel_token
+{
+    cancel_token()
+    : b_cancelled(false)
+    {}
+
+
+    std::atomic<bool> b_cancelled;
+
+
+    void cancel()
+    {
+        b_cancelled = true;
+    }
+
+    bool cancelled() const
+    {
+        return b_cancelled;
+    }
+
+};
+
+
 // isn't actually fully threadsafe with regards
 // to the get() returning a non-const value
 template <typename K, typename V>
@@ -701,6 +727,11 @@ public:
     void move_jobs_to_front(const std::string& job_pool_id);
     void move_jobs_to_back(const std::string& job_pool_id);
     void enqueue_job(std::function<void()> job, const std::string& job_pool_id = DEFAULT_JOB_POOL_ID, bool b_push_to_front = false);
+    // calls fn(0) to fn(count - 1) on free threads and the calling
+    // thread, and returns once all of them have returned. the calling
+    // thread takes part, so the work is done even if all threads are
+    // busy with downloads.
+    void parallel_for(size_t count, std::function<void(size_t)> fn, const std::string& job_pool_id);
     static void start_thread(); // consumes jobs
     static void run_jobs();
     static void end_thread();
@@ -11,6 +11,7 @@
 #include "fileops.h"
 #include "netops.h"
 #include "imgman.h"
+#include "searchindex.h"
 #include "widgets/widgets.h"
 //#include <thread>
 
@@ -26,6 +27,14 @@ void WidgetMan::init()
         tb_clear();
         tb_present();
 
+        // termbox only reports mouse motion while a button is held,
+        // also report plain motion so catalogs can tell which thread
+        // is under the mouse. must come after termbox's own mouse
+        // sequences have been flushed by tb_present(), as it
+        // replaces the tracking mode they set.
+        fputs("\x1b[?1003h", stdout);
+        fflush(stdout);
+
         term_size_cache = vector2d(tb_width(), tb_height());
         // dependent on term_size_cache
         clear_termbox_frame(true /* b_resize */);
@@ -33,6 +42,12 @@ void WidgetMan::init()
         set_draw_img_buffer(true);
         draw_controller = nullptr;
 
+        b_frame_pending = false;
+        b_frame_clear_cells = false;
+        b_frame_clear_images = false;
+        last_frame_time = std::chrono::milliseconds(0);
+        paint_pass = e_paint_pass::pp_none;
+
         homescreen = std::make_shared<HomescreenWidget>();
         homescreen->rebuild();
         add_widget(homescreen, true);
@@ -50,18 +65,41 @@ void WidgetMan::switch_to_homescreen()
 }
 
 
-void WidgetMan::open_thread(std::string url, bool b_steal_focus)
+void WidgetMan::open_thread(std::string url, bool b_steal_focus, const imageboard::post* op, std::shared_ptr<imageboard::page_data> op_page, int post_num)
 {
     data_4chan chan_data(url);
     chan_data.b_steal_focus = b_steal_focus;
+    chan_data.goto_post = post_num;
+
+    // show the thread from the op straight away, the full
+    // thread updates the widget when it has been loaded
+    if (op && op_page && b_steal_focus &&
+        chan_data.url_is_valid() &&
+        chan_data.parser.pagetype == e_page_type::pt_thread &&
+        !WIDGET_MAN.get_widget(chan_data.wgt_id))
+    {
+        data_4chan op_data(url);
+        op_data.b_partial = true;
+        op_data.page_data->thread_num_str = op_data.parser.thread_num_str;
+        // shares the catalog's json, which the op's strings point into
+        op_data.page_data->add_post(*op, *op_page);
+
+        std::shared_ptr<Thread4chanWidget> chan_wgt =
+            std::make_shared<Thread4chanWidget>(op_data);
+        WIDGET_MAN.add_widget(chan_wgt, true /* b_focus */);
+    }
     std::stringstream buf;
     FileOps::read_file(
         buf,
         chan_data.file_path + "thread.json");
-    bool b_parsed = chan_data.parse_json(buf.str().c_str());
+    bool b_parsed = chan_data.parse_json(buf.str());
     // json exists in cache, load from disk
     if (b_parsed)
     {
+        // lets reloads ask only for changes since the json was
+        // cached (e.g. when it was prefetched from the catalog)
+        chan_data.fetch_time =
+            FileOps::last_modified(chan_data.file_path + "thread.json");
         NetOps::queue__4chan_json.push(chan_data);
     }
     // try load url
@@ -104,6 +142,9 @@ void WidgetMan::focus_widget(std::shared_ptr<TermWidget> widget)
         return;
     }
 
+    // the pending frame was asked of the widget losing focus
+    present_frame(true /* b_force */);
+
     // relinquish draw privileges so newly focused widget can draw to term
     draw_controller = nullptr;
     // take draw control privileges
@@ -149,44 +190,15 @@ void WidgetMan::run()
         tick_widgets();
 
         int e_type = tb_peek_event(&input_event, 10 /* timeout in ms */);
-        // key input
-        if (e_type == TB_EVENT_KEY || e_type == TB_EVENT_MOUSE)
+        // handle all the input that has queued up since the last
+        // frame (e.g. while a scroll key is held or the mouse wheel
+        // spun) before drawing, so it's drawn once for all of it
+        while (e_type > 0 && b_run)
         {
-            if (input_event.key == TB_KEY_MOUSE_LEFT)
-            {
-                if (focused_widget)
-                {
-                    TermWidget* clicked_child =
-                        focused_widget->get_topmost_child_at(
-                            vector2d(input_event.x, input_event.y));
-
-                    if (clicked_child)
-                    {
-                        clicked_child->receive_left_click(
-                            vector2d(input_event.x, input_event.y),
-                            clicked_child);
-                    }
-                }
-            }
-            else
-            {
-                if (focused_widget)
-                {
-                    if (!focused_widget->handle_key_input(input_event))
-                    {
-                        handle_key_input(input_event);
-                    }
-                }
-                else
-                {
-                    handle_key_input(input_event);
-                }
-            }
-        }
-        // terminal resize event
-        else if (e_type == TB_EVENT_RESIZE)
-        {
-            handle_term_resize_event(input_event);
+            handle_event(e_type, input_event);
+
+            if (frame_due()) break;
+            e_type = tb_peek_event(&input_event, 0 /* timeout in ms */);
         }
 
         // load chan data received from worker threads
@@ -203,12 +215,58 @@ void WidgetMan::run()
                 IMG_MAN.redraw_buffer(true);
             }
         }
+
+        present_frame();
     }
 
     shutdown();
 }
 
 
+void WidgetMan::handle_event(int e_type, const tb_event& input_event)
+{
+    // key input
+    if (e_type == TB_EVENT_KEY || e_type == TB_EVENT_MOUSE)
+    {
+        if (input_event.key == TB_KEY_MOUSE_LEFT)
+        {
+            if (focused_widget)
+            {
+                TermWidget* clicked_child =
+                    focused_widget->get_topmost_child_at(
+                        vector2d(input_event.x, input_event.y));
+
+                if (clicked_child)
+                {
+                    clicked_child->receive_left_click(
+                        vector2d(input_event.x, input_event.y),
+                        clicked_child);
+                }
+            }
+        }
+        else
+        {
+            if (focused_widget)
+            {
+                if (!focused_widget->handle_key_input(input_event))
+                {
+                    handle_key_input(input_event);
+                }
+            }
+            else
+            {
+                handle_key_input(input_event);
+            }
+        }
+    }
+    // terminal resize event
+    else if (e_type == TB_EVENT_RESIZE)
+    {
+        handle_term_resize_event(input_event);
+    }
+}
+
+
 void WidgetMan::tick_widgets()
 {
     // TODO: tick other widgets
@@ -232,6 +290,13 @@ void WidgetMan::load_chan_data()
 
 void WidgetMan::load_4chan_data(data_4chan& chan_data)
 {
+    // whether it's from the network, the disk cache or the daemon
+    if (chan_data.parser.pagetype == e_page_type::pt_thread &&
+        chan_data.is_valid() && !chan_data.b_partial)
+    {
+        SEARCH_INDEX.index_thread(chan_data.page_data);
+    }
+
     std::shared_ptr<TermWidget> wgt = get_widget(chan_data.wgt_id);
     // widget exists, update it
     if (wgt)
@@ -246,6 +311,12 @@ void WidgetMan::load_4chan_data(data_4chan& chan_data)
                 move_to_front(wgt, true);
             }
 
+            Thread4chanWidget* thread = dynamic_cast<Thread4chanWidget*>(wgt.get());
+            if (thread && chan_data.goto_post != -1)
+            {
+                thread->go_to_post(chan_data.goto_post);
+            }
+
             // redraw if changed and widget is focused
             if (b_changed &&
                 (wgt == focused_widget ||
@@ -265,6 +336,11 @@ void WidgetMan::load_4chan_data(data_4chan& chan_data)
             std::shared_ptr<Thread4chanWidget> chan_wgt =
                 std::make_shared<Thread4chanWidget>(chan_data);
             add_widget(chan_wgt, true /* b_focus */);
+
+            if (chan_data.goto_post != -1)
+            {
+                chan_wgt->go_to_post(chan_data.goto_post);
+            }
         }
         else if (chan_data.parser.pagetype == e_page_type::pt_boards_list)
         {
@@ -306,7 +382,6 @@ void WidgetMan::load_image_data()
 {
     if (!DISPLAY_IMAGES) return;
 
-    bool b_redraw = false;
     std::set<TermWidget*> wgts;
 
     // loaded from disk
@@ -318,14 +393,11 @@ void WidgetMan::load_image_data()
         std::shared_ptr<TermWidget> wgt = get_widget(pac.widget_id);
         if (wgt)
         {
+            // the image widgets that were built flag their rows
             b_loaded = wgt->receive_img_packet(pac);
             if (b_loaded)
             {
                 wgts.insert(wgt.get());
-                if (wgt == focused_widget)
-                {
-                    b_redraw = true;
-                }
             }
         }
 
@@ -338,7 +410,8 @@ void WidgetMan::load_image_data()
         //}
     }
 
-    if (b_redraw)
+    // widgets in the background are drawn when they're focused
+    if (focused_widget && focused_widget->needs_paint())
         draw_widgets();
 }
 
@@ -414,6 +487,24 @@ void WidgetMan::open_switch_widget()
 }
 
 
+void WidgetMan::open_search_widget()
+{
+    auto search = get_widget("SEARCH");
+    if (search)
+    {
+        move_to_front(search, true);
+    }
+    else
+    {
+        search = std::make_shared<SearchWidget>();
+        search->rebuild(true);
+        add_widget(search, true /* b_focus */);
+    }
+
+    draw_widgets();
+}
+
+
 void WidgetMan::handle_key_input(const tb_event& input_event)
 {
     if (input_event.key == TB_KEY_CTRL_Q)
@@ -428,6 +519,10 @@ void WidgetMan::handle_key_input(const tb_event& input_event)
     {
         open_switch_widget();
     }
+    else if (input_event.key == TB_KEY_CTRL_F)
+    {
+        open_search_widget();
+    }
     else if (input_event.key == TB_KEY_BACKSPACE ||
              input_event.key == TB_KEY_BACKSPACE2 ||
              input_event.key == TB_KEY_CTRL_8 ||
@@ -457,23 +552,81 @@ void WidgetMan::handle_term_resize_event(const tb_event& resize_event)
 }
 
 
-void WidgetMan::add_cell_to_frame(term_cell& cell)
+void WidgetMan::blit_to_frame(int x, int y, const tb_cell* cells, int count)
 {
-    int index = cell.coord.x + (cell.coord.y * term_size_cache.x);
-    if (index >= 0 && index < termbox_frame.size())
+    if (y < 0 || y >= frame_size.y) return;
+
+    if (x < 0)
+    {
+        cells -= x;
+        count += x;
+        x = 0;
+    }
+
+    if (x + count > frame_size.x)
     {
-        termbox_frame[index] = cell;
+        count = frame_size.x - x;
     }
+
+    if (count <= 0) return;
+
+    int index = x + y * frame_size.x;
+    std::memcpy(&frame[index], cells, count * sizeof(tb_cell));
+
+    uint8_t* mask = &frame_mask[index];
+    for (int i = 0; i < count; ++i)
+    {
+        mask[i] = cells[i].ch != TB_NULL_CHAR;
+    }
+
+    vector2d& span = frame_damage[y];
+    if (span.x >= span.y)
+    {
+        span = vector2d(x, x + count);
+    }
+    else
+    {
+        if (x < span.x) span.x = x;
+        if (x + count > span.y) span.y = x + count;
+    }
+
+    if (y < damage_top) damage_top = y;
+    if (y >= damage_bottom) damage_bottom = y + 1;
 }
 
 
 void WidgetMan::put_termbox_frame(bool b_clear)
 {
-    for (auto& cell : termbox_frame)
+    // termbox's buffer is only resized by tb_clear() and
+    // tb_present(), so it can lag behind a resize event
+    tb_cell* back = tb_cell_buffer();
+    int back_w = tb_width();
+    int back_h = tb_height();
+
+    if (back && back_w > 0)
     {
-        if (!cell.is_null())
+        int bottom = std::min(damage_bottom, back_h);
+        for (int y = damage_top; y < bottom; ++y)
         {
-            tb_put_cell(cell.coord.x, cell.coord.y, &cell.tb_data);
+            const vector2d& span = frame_damage[y];
+            const uint8_t* mask = &frame_mask[y * frame_size.x];
+            const tb_cell* row = &frame[y * frame_size.x];
+            tb_cell* back_row = back + y * back_w;
+
+            // copy each run of cells that have been drawn to
+            int end = std::min(span.y, back_w);
+            int x = span.x;
+            while (x < end)
+            {
+                while (x < end && !mask[x]) ++x;
+                int start = x;
+                while (x < end && mask[x]) ++x;
+
+                if (x > start)
+                {
+                    std::memcpy(back_row + start, row + start, (x - start) * sizeof(tb_cell));
+                }
+            }
         }
     }
 
@@ -483,23 +636,40 @@ void WidgetMan::put_termbox_frame(bool b_clear)
 
 void WidgetMan::clear_termbox_frame(bool b_resize)
 {
-    termbox_frame.clear();
+    int w = term_size_cache.x;
+    int h = term_size_cache.y;
 
-    if (b_resize)
+    if (b_resize || frame_size != vector2d(w, h))
+    {
+        tb_cell blank;
+        blank.ch = TB_NULL_CHAR;
+        blank.bg = 0;
+        blank.fg = 0;
+
+        frame_size = vector2d(w, h);
+        frame.assign(w * h, blank);
+        frame_mask.assign(w * h, 0);
+        frame_damage.assign(h, vector2d());
+        damaged_rows.assign(h, 0);
+        damage_all();
+    }
+    else
     {
-        blank_termbox_frame.clear();
-        for (int y = 0; y < term_size_cache.y; ++y)
+        // cells are only read where the mask is set,
+        // so only the mask needs clearing
+        for (int y = damage_top; y < damage_bottom; ++y)
         {
-            for (int x = 0; x < term_size_cache.x; ++x)
+            vector2d& span = frame_damage[y];
+            if (span.y > span.x)
             {
-                // this constructor initializes
-                // with tb_cell.ch == TB_NULL_CHAR
-                blank_termbox_frame.emplace_back(vector2d(x, y));
+                std::memset(&frame_mask[span.x + y * w], 0, span.y - span.x);
             }
+            span = vector2d();
         }
     }
 
-    termbox_frame = blank_termbox_frame;
+    damage_top = h;
+    damage_bottom = 0;
 }
 
 
@@ -509,7 +679,100 @@ void WidgetMan::remove_image_artifact(vector2d coord)
 }
 
 
+void WidgetMan::damage_rows(int top, int bottom)
+{
+    top = std::max(top, 0);
+    bottom = std::min(bottom, (int)damaged_rows.size());
+    if (bottom <= top) return;
+
+    std::memset(&damaged_rows[top], 1, bottom - top);
+    b_any_damage = true;
+}
+
+
+void WidgetMan::damage_all()
+{
+    damage_rows(0, damaged_rows.size());
+}
+
+
+bool WidgetMan::row_damaged(int y) const
+{
+    if (paint_pass != e_paint_pass::pp_damage) return true;
+
+    return y >= 0 && y < (int)damaged_rows.size() && damaged_rows[y];
+}
+
+
+bool WidgetMan::is_damaged(int top, int bottom) const
+{
+    top = std::max(top, 0);
+    bottom = std::min(bottom, (int)damaged_rows.size());
+    for (int y = top; y < bottom; ++y)
+    {
+        if (damaged_rows[y]) return true;
+    }
+
+    return false;
+}
+
+
 void WidgetMan::draw_widgets(TermWidget* draw_widget, bool b_clear_cells, bool b_clear_images)
+{
+    // the focused widget is drawn once a frame, with whatever was
+    // asked for since the last one. a single widget in it (e.g. a
+    // footer) is drawn with the frame, as the rows it's on
+    if (!draw_widget ||
+        (focused_widget && draw_widget->is_child_of(focused_widget.get())))
+    {
+        if (draw_widget)
+        {
+            draw_widget->invalidate_paint();
+        }
+
+        b_frame_pending = true;
+        b_frame_clear_cells = b_frame_clear_cells || b_clear_cells;
+        b_frame_clear_images = b_frame_clear_images || b_clear_images;
+        return;
+    }
+
+    // a widget outside of it is drawn right away, over
+    // the pending frame, so that goes first
+    present_frame(true /* b_force */);
+    draw_frame(draw_widget, b_clear_cells, b_clear_images);
+}
+
+
+bool WidgetMan::frame_due() const
+{
+    return b_frame_pending &&
+           time_now_ms() - last_frame_time >= std::chrono::milliseconds(1000 / MAX_FPS);
+}
+
+
+void WidgetMan::present_frame(bool b_force)
+{
+    if (!b_frame_pending || (!b_force && !frame_due()))
+    {
+        return;
+    }
+
+    b_frame_pending = false;
+    last_frame_time = time_now_ms();
+
+    bool b_clear_cells = b_frame_clear_cells;
+    bool b_clear_images = b_frame_clear_images;
+    b_frame_clear_cells = false;
+    b_frame_clear_images = false;
+
+    // the widget it was asked of has been removed
+    if (!focused_widget) return;
+
+    draw_frame(nullptr, b_clear_cells, b_clear_images);
+}
+
+
+void WidgetMan::draw_frame(TermWidget* draw_widget, bool b_clear_cells, bool b_clear_images)
 {
     // a widget can take control of drawing widgets, preventing
     // other widgets from calling draw_widgets()
@@ -532,18 +795,61 @@ void WidgetMan::draw_widgets(TermWidget* draw_widget, bool b_clear_cells, bool b
         }
     }
 
-    // wipe terminal screen, including images
-    if (b_clear_cells)
+    // lay out what has changed since the last draw
+    if (focused_widget)
     {
-        termbox_clear();
+        focused_widget->update_layout();
     }
 
-    if (DISPLAY_IMAGES)
+    if (!draw_widget && !focused_widget)
     {
-        // clear images
-        if (b_clear_images)
+        termbox_draw();
+        return;
+    }
+
+    if (draw_widget)
+    {
+        // everything under the widget is drawn. the rows it's on
+        // aren't cleared, as other widgets may share them
+        paint_pass = e_paint_pass::pp_all;
+
+        if (b_clear_cells)
         {
-            IMG_MAN.clear_buffer();
+            termbox_clear(0, true /* b_keep_images */);
+        }
+
+        if (DISPLAY_IMAGES && b_clear_images)
+        {
+            IMG_MAN.begin_frame();
+        }
+    }
+    else
+    {
+        // the rows of the widgets that changed, moved or went
+        // away since the last frame. the rest of the terminal
+        // is left as it is
+        focused_widget->collect_damage();
+
+        if (!b_any_damage)
+        {
+            focused_widget->paint_done();
+            return;
+        }
+
+        paint_pass = e_paint_pass::pp_damage;
+
+        // wipe the damaged rows. the cells are drawn again before
+        // they are presented, so images that stay put are kept
+        if (b_clear_cells)
+        {
+            clear_damaged_rows();
+        }
+
+        // images on the damaged rows that are where they were
+        // last frame aren't drawn again
+        if (DISPLAY_IMAGES && b_clear_images)
+        {
+            IMG_MAN.begin_frame(damaged_rows);
         }
     }
 
@@ -552,37 +858,32 @@ void WidgetMan::draw_widgets(TermWidget* draw_widget, bool b_clear_cells, bool b
     {
         draw_widget->draw();
     }
-    else if (focused_widget)
-    {
-        focused_widget->draw();
-    }
-    // nothing to draw
     else
     {
-        termbox_draw();
-        return;
+        focused_widget->draw();
     }
 
+    paint_pass = e_paint_pass::pp_none;
+
     // remove image artifacts
     if (artifact_remove.size() > 0)
     {
-        std::vector<term_cell> frame_buf = termbox_frame;
+        // present the frame with the artifacts covered, then put
+        // the frame again so the cells that were drawn get back
+        // what was drawn to them
+        put_termbox_frame(false /* clear */);
+
+        tb_cell cel;
+        tb_utf8_char_to_unicode(&cel.ch, " ");
+        cel.bg = COLO.img_artifact_remove;
+        cel.fg = COLO.img_artifact_remove;
         for (auto coord : artifact_remove)
         {
-            term_cell cel;
-            uint32_t ch;
-            tb_utf8_char_to_unicode(&ch, " ");
-            cel.tb_data.ch = ch;
-            cel.tb_data.bg = COLO.img_artifact_remove;
-            cel.tb_data.fg = COLO.img_artifact_remove;
-            cel.coord = coord;
-            add_cell_to_frame(cel);
+            tb_put_cell(coord.x, coord.y, &cel);
         }
 
-        put_termbox_frame();
         apply_null_cells(false /* clear array */);
         termbox_draw();
-        termbox_frame = frame_buf;
         artifact_remove.clear();
         //std::this_thread::sleep_for(std::chrono::seconds(3));
     }
@@ -590,10 +891,23 @@ void WidgetMan::draw_widgets(TermWidget* draw_widget, bool b_clear_cells, bool b
     put_termbox_frame();
     apply_null_cells();
 
+    if (draw_widget)
+    {
+        draw_widget->paint_done();
+    }
+    else
+    {
+        focused_widget->paint_done();
+
+        std::fill(damaged_rows.begin(), damaged_rows.end(), 0);
+        b_any_damage = false;
+    }
+
     if (DISPLAY_IMAGES)
     {
         if (b_clear_images)
         {
+            IMG_MAN.end_frame();
             IMG_MAN.sync();
         }
         else if (b_draw_img_buffer)
@@ -606,10 +920,42 @@ void WidgetMan::draw_widgets(TermWidget* draw_widget, bool b_clear_cells, bool b
 }
 
 
-void WidgetMan::termbox_clear(uint32_t color)
+void WidgetMan::clear_damaged_rows()
+{
+    // termbox's buffer is only resized by tb_clear() and
+    // tb_present(), so it can lag behind a resize event
+    tb_cell* back = tb_cell_buffer();
+    int back_w = tb_width();
+    int back_h = tb_height();
+    if (!back || back_w < 1) return;
+
+    tb_cell blank;
+    tb_utf8_char_to_unicode(&blank.ch, " ");
+    blank.bg = 0;
+    blank.fg = 0;
+
+    int bottom = std::min((int)damaged_rows.size(), back_h);
+    for (int y = 0; y < bottom; ++y)
+    {
+        if (damaged_rows[y])
+        {
+            std::fill(back + y * back_w, back + (y + 1) * back_w, blank);
+        }
+    }
+}
+
+
+void WidgetMan::termbox_clear(uint32_t color, bool b_keep_images)
 {
     tb_set_clear_attributes(color, color);
     tb_clear();
+    // everything is drawn again on the next frame
+    damage_all();
+
+    if (DISPLAY_IMAGES && !b_keep_images)
+    {
+        IMG_MAN.clear_buffer();
+    }
 }
 
 
@@ -638,6 +984,8 @@ void WidgetMan::apply_null_cells(bool b_clear)
 {
     tb_cell nul;
     nul.ch = TB_NULL_CHAR;
+    nul.bg = 0;
+    nul.fg = 0;
     for (auto& cell : null_cells)
     {
         tb_put_cell(cell.x, cell.y, &nul);
@@ -713,6 +1061,8 @@ void WidgetMan::shutdown()
         homescreen = nullptr;
         draw_controller = nullptr;
 
+        fputs("\x1b[?1003l", stdout);
+        fflush(stdout);
         tb_shutdown();
     }
 }
@@ -17,6 +17,15 @@ class HomescreenWidget;
 struct data_4chan;
 
 
+// what the draw() calls being made are for
+enum e_paint_pass
+{
+    pp_none,        // outside of a frame, everything is drawn
+    pp_all,         // a single widget drawn right away, all of it
+    pp_damage       // a frame, only the damaged rows are drawn
+};
+
+
 class WidgetMan
 {
 
@@ -74,6 +83,7 @@ protected:
     vector2d term_size_cache;
 
     void tick_widgets();
+    void handle_event(int e_type, const tb_event& input_event);
 
     std::chrono::microseconds last_tick_time;
 
@@ -87,14 +97,49 @@ protected:
     // null_cells vector if b_clear is true
     void apply_null_cells(bool b_clear = true);
 
-    // cells to be drawn using termbox in order from
-    // 0 to end of vector, comprising one draw frame
-    std::vector<term_cell> termbox_frame;
-    std::vector<term_cell> blank_termbox_frame;
+    // one draw frame: a cell for each cell of the terminal, row by
+    // row. frame_mask is 1 where a cell has been drawn to (and isn't
+    // TB_NULL_CHAR), and only those cells are put to termbox.
+    std::vector<tb_cell> frame;
+    std::vector<uint8_t> frame_mask;
+    vector2d frame_size;
+    // the columns of each row of the frame that have been drawn
+    // to since it was last put to termbox, as x start and x end.
+    // only these are put and cleared, so drawing e.g. a footer
+    // costs as much as the footer instead of the whole terminal.
+    std::vector<vector2d> frame_damage;
+    // rows that have damage are between these
+    int damage_top;
+    int damage_bottom;
+
+    // rows of the terminal that have to be drawn again on the next
+    // frame, as something on them changed, moved or went away. a
+    // frame clears these rows and draws only them, the widgets that
+    // are still on the terminal as they'd be drawn are skipped
+    std::vector<uint8_t> damaged_rows;
+    bool b_any_damage;
+    e_paint_pass paint_pass;
 
     // coordinates in this vector get force cleared in draw()
     std::vector<vector2d> artifact_remove;
 
+    // draw_widgets() for the focused widget only asks for a frame,
+    // which run() draws once 1 / MAX_FPS seconds have passed since
+    // the last one. clearing cells or images is done if any of the
+    // calls since then asked for it
+    bool b_frame_pending;
+    bool b_frame_clear_cells;
+    bool b_frame_clear_images;
+    std::chrono::milliseconds last_frame_time;
+
+    bool frame_due() const;
+    // draws the pending frame if it's due, or right away if b_force
+    void present_frame(bool b_force = false);
+    // draws draw_widget, or the damaged rows of the focused widget
+    void draw_frame(TermWidget* draw_widget, bool b_clear_cells, bool b_clear_images);
+    // blanks the damaged rows in termbox's back buffer
+    void clear_damaged_rows();
+
     // if false, IMG_MAN redraw_buffer() is not called in tick
     // and draw_widgets()
     bool b_draw_img_buffer;
@@ -106,13 +151,20 @@ public:
 
     void switch_to_homescreen();
     void open_switch_widget();
+    // focuses the search page, opening it if it isn't
+    void open_search_widget();
 
     std::shared_ptr<SelectionWidget> switch_widget_select;
 
     // if b_steal_focus is true, when the data packed is received
     // from ThreadManager, the widget that receives the packet
     // will be focused
-    static void open_thread(std::string url, bool b_steal_focus = false);
+    // if op is given and the thread isn't open yet, the thread
+    // is shown right away with only the op while the rest loads.
+    // op points into op_page, whose json is shared with the thread.
+    // if the thread is in the disk cache, it's scrolled to post_num
+    // (unless -1) when it's shown
+    static void open_thread(std::string url, bool b_steal_focus = false, const imageboard::post* op = nullptr, std::shared_ptr<imageboard::page_data> op_page = nullptr, int post_num = -1);
 
     vector2d get_term_size() { return term_size_cache; };
 
@@ -127,16 +179,32 @@ public:
     void focus_widget(std::shared_ptr<TermWidget> widget);
 
     void clear_termbox_frame(bool b_resize = false);
-    void add_cell_to_frame(term_cell& cell);
-    // if b_clear is true the termbox_frame vector is cleared
+    // copies a row of count cells drawn by a widget to the frame at x, y
+    void blit_to_frame(int x, int y, const tb_cell* cells, int count);
+    // copies the frame into termbox's back buffer.
+    // if b_clear is true the frame is cleared
     void put_termbox_frame(bool b_clear = true);
+    // rows top to bottom (exclusive) are drawn again on the next frame
+    void damage_rows(int top, int bottom);
+    void damage_all();
+    bool row_damaged(int y) const;
+    // true if any of the rows top to bottom (exclusive) is damaged
+    bool is_damaged(int top, int bottom) const;
+    e_paint_pass get_paint_pass() const { return paint_pass; };
     void add_null_cell(vector2d cell);
     void remove_image_artifact(vector2d coord);
     // if no widget is supplied for draw_widget,
-    // then focused_widget is drawn by default
+    // then focused_widget is drawn by default on the next frame,
+    // which only draws the rows of the widgets that need painting
+    // (see TermWidget::invalidate_paint()). a draw_widget is drawn
+    // right away, all of it
     void draw_widgets(TermWidget* draw_widget = nullptr, bool b_clear_cells = true, bool b_clear_images = true);
     void termbox_draw();
-    void termbox_clear(uint32_t color = 0);
+    // the images are drawn again on the next draw_widgets(),
+    // as presenting the cleared cells wipes them, unless
+    // b_keep_images (e.g. the cells are drawn before presenting).
+    // damages every row
+    void termbox_clear(uint32_t color = 0, bool b_keep_images = false);
     // wipe all image artifacts and term cells
     void hard_refresh();
 
@@ -18,6 +18,8 @@ BoxDividerWidget::BoxDividerWidget(bool _b_horizontal, uint32_t _bg_color = 0, u
 
 void BoxDividerWidget::rebuild(bool b_rebuild_children)
 {
+    invalidate_paint();
+
     cells.clear();
 
     if (!parent_widget)
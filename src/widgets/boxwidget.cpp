@@ -21,6 +21,8 @@ BoxWidget::BoxWidget(vector2d _offset, vector4d _padding, vector2d _size, uint32
 
 void BoxWidget::rebuild(bool b_rebuild_children)
 {
+    invalidate_paint();
+
     if (child_widget)
     {
         if (b_rebuild_children)
@@ -21,6 +21,13 @@ Catalog4chanWidget::Catalog4chanWidget(data_4chan& chan_data, bool b_update)
     auto_refresh_interval = std::chrono::milliseconds(auto_ref_s * 1000);
     selected_thread = nullptr;
     b_can_save = false;
+    hovered_post_num = -1;
+    prefetched_post_num = -1;
+    prefetch_num_images = 3;
+    prefetch_dwell = std::chrono::milliseconds(300);
+    hover_time = std::chrono::milliseconds(0);
+    prefetch_token = nullptr;
+    mouse_coord = vector2d(-1, -1);
 
     title = "/" + board + "/ - Catalog";
 
@@ -34,43 +41,208 @@ Catalog4chanWidget::Catalog4chanWidget(data_4chan& chan_data, bool b_update)
 }
 
 
-bool Catalog4chanWidget::on_received_update(data_4chan& chan_data)
+bool Catalog4chanWidget::on_received_update(data_4chan& /* chan_data */)
 {
     b_reloading = false;
     auto_refresh_counter = std::chrono::milliseconds(0);
 
-    bool b_redraw = false;
-    for (auto& thread : chan_data.page_data->posts)
+    // reply and image counts are updated with the
+    // rest of the threads in update_threads()
+    return false;
+}
+
+
+void Catalog4chanWidget::apply_page_data(std::shared_ptr<imageboard::page_data> new_data)
+{
+    // keeps the posts the threads were built from
+    // alive until they have been compared
+    std::shared_ptr<imageboard::page_data> old_data = page_data;
+    page_data = new_data;
+
+    if (!page_data)
+    {
+        return;
+    }
+
+    // not built yet
+    if (!old_data || !main_vbox || !threads_grid || !scroll_panel ||
+        !header || !footer)
     {
+        rebuild();
+        return;
+    }
+
+    update_threads();
+
+    // the terminal was resized while the catalog was in the background
+    if (term_size_cache != vector2d(term_w(), term_h()))
+    {
+        update_size(false);
+        rebuild();
+    }
+}
+
+
+void Catalog4chanWidget::update_threads()
+{
+    // grid slot each thread was in before the update
+    std::map<TermWidget*, size_t> old_slots;
+    const std::vector<std::shared_ptr<TermWidget>>& grid_children =
+        threads_grid->get_children();
+    for (size_t i = 0; i < grid_children.size(); ++i)
+    {
+        old_slots[grid_children[i].get()] = i;
+    }
+
+    std::vector<std::shared_ptr<CatalogThread4chanWidget>> thread_vec;
+    std::vector<std::shared_ptr<CatalogThread4chanWidget>> new_threads;
+    std::set<int> nums;
+
+    for (auto& thread : page_data->posts)
+    {
+        if (!nums.insert(thread.num).second)
+        {
+            continue;
+        }
+
         std::shared_ptr<CatalogThread4chanWidget> cat_thread =
             get_thread(thread.num);
-        if (cat_thread)
+
+        // op was edited, e.g. its image was deleted
+        if (cat_thread && cat_thread->get_post_data() &&
+            !Post4chanWidget::shows_same(*cat_thread->get_post_data(), thread))
         {
-            bool b_changed = cat_thread->update_reply_and_image_count(thread);
-            if (b_changed)
+            blast_out_image_artifacts(cat_thread.get());
+            threads_grid->remove_child_widget(cat_thread.get(), false);
+            if (selected_thread == cat_thread.get())
             {
-                b_redraw = true;
+                selected_thread = nullptr;
             }
+
+            cat_thread = nullptr;
+        }
+
+        if (!cat_thread)
+        {
+            cat_thread =
+                std::make_shared<CatalogThread4chanWidget>(
+                    this,
+                    thread);
+            thread_map[thread.num] = cat_thread;
+            new_threads.push_back(cat_thread);
+        }
+        else
+        {
+            cat_thread->update_reply_and_image_count(thread);
+        }
+
+        thread_vec.push_back(cat_thread);
+    }
+
+    // pruned threads
+    for (auto it = thread_map.begin(); it != thread_map.end();)
+    {
+        if (nums.find(it->first) == nums.end())
+        {
+            blast_out_image_artifacts(it->second.get());
+            threads_grid->remove_child_widget(it->second.get(), false);
+            if (selected_thread == it->second.get())
+            {
+                selected_thread = nullptr;
+            }
+
+            it = thread_map.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    // bumped threads, and the ones pushed along by them, change
+    // slots. thumbnails that stay where they are aren't touched.
+    for (size_t i = 0; i < thread_vec.size(); ++i)
+    {
+        auto it = old_slots.find(thread_vec[i].get());
+        if (it != old_slots.end() && it->second != i)
+        {
+            blast_out_image_artifacts(thread_vec[i].get());
         }
     }
 
-    return b_redraw;
+    // put the grid in bump order
+    for (size_t i = 0; i < thread_vec.size(); ++i)
+    {
+        if (i < grid_children.size() && grid_children[i] == thread_vec[i])
+        {
+            continue;
+        }
+
+        threads_grid->remove_child_widget(thread_vec[i].get(), false);
+        threads_grid->insert_child_widget(i, thread_vec[i], false);
+    }
+
+    for (auto& thread : new_threads)
+    {
+        thread->rebuild(true);
+    }
+
+    set_footer_info();
+    header->rebuild(true);
+    footer->rebuild(true);
+    int shrink = header->get_height_constraint();
+    shrink += footer->get_height_constraint();
+    posts_box->set_size(1, term_h() - shrink);
+
+    // only moves the threads into place
+    threads_grid->rebuild(false);
+    scroll_panel->rebuild(false);
+    posts_box->rebuild(false);
+    main_vbox->rebuild(false);
 }
 
 
-void Catalog4chanWidget::rebuild(bool b_rebuild_children)
+void Catalog4chanWidget::set_footer_info()
 {
-    if (!page_data) return;
+    if (!footer_info) return;
 
-    vector2d cached_scroll_pos;
+    footer_info->clear_text();
+    footer_info->append_text("Threads:");
+    footer_info->append_text(std::to_string(thread_map.size()));
 
-    if (scroll_panel)
+    base_footer_text = footer_info->get_term_words();
+    if (!footer_countdown.empty())
     {
-        cached_scroll_pos = scroll_panel->get_scroll_position();
+        footer_info->append_text(footer_countdown);
     }
+    else
+    {
+        std::string t = "| Reload in " + std::to_string(auto_ref_s) + "s";
+        footer_info->append_text(t);
+        b_auto_update = true;
+    }
+}
 
+
+void Catalog4chanWidget::blast_out_image_artifacts(CatalogThread4chanWidget* thread)
+{
+    if (!thread) return;
+
+    std::vector<ImageWidget*> imgs = thread->get_image_widgets();
+    for (auto& i : imgs)
+    {
+        if (i)
+        {
+            i->blast_out_image_artifacts_at_last_position();
+        }
+    }
+}
+
+
+void Catalog4chanWidget::build_frame()
+{
     // main vertical box container
-    std::shared_ptr<VerticalBoxWidget> main_vbox = std::make_shared<VerticalBoxWidget>(false /* b_stretch_offscreen */);
+    main_vbox = std::make_shared<VerticalBoxWidget>(false /* b_stretch_offscreen */);
     main_vbox->set_h_sizing(e_widget_sizing::ws_fullscreen);
     main_vbox->set_v_sizing(e_widget_sizing::ws_fullscreen);
 
@@ -91,7 +263,7 @@ void Catalog4chanWidget::rebuild(bool b_rebuild_children)
     posts_box->set_draw_border(false);
 
     // posts grid container
-    std::shared_ptr<WrapGrid> threads_grid =
+    threads_grid =
         std::make_shared<WrapGrid>(
             thread_box_size /* grid slot size */);
     threads_grid->set_h_align(e_widget_align::wa_center);
@@ -166,6 +338,36 @@ void Catalog4chanWidget::rebuild(bool b_rebuild_children)
 
     footer->set_child_widget(footer_info);
 
+    main_vbox->add_child_widget(header, false /* rebuild */);
+    main_vbox->add_child_widget(posts_box, false /* rebuild */);
+    main_vbox->add_child_widget(footer, false /* rebuild */);
+
+    set_child_widget(main_vbox, false /* rebuild */);
+}
+
+
+void Catalog4chanWidget::rebuild(bool b_rebuild_children)
+{
+    if (!page_data) return;
+
+    vector2d cached_scroll_pos;
+
+    if (scroll_panel)
+    {
+        cached_scroll_pos = scroll_panel->get_scroll_position();
+    }
+
+    // the boxes around the threads are kept from one
+    // rebuild to the next, only the threads are put back
+    if (!main_vbox)
+    {
+        build_frame();
+    }
+    else
+    {
+        threads_grid->clear_children();
+    }
+
     // load threads
     std::vector<int> keys;
     std::vector<int> new_keys;
@@ -174,17 +376,7 @@ void Catalog4chanWidget::rebuild(bool b_rebuild_children)
         // collect keys of existing
         keys.push_back(t.first);
         // remove image artifacts of existing
-        if (t.second)
-        {
-            std::vector<ImageWidget*> imgs = t.second->get_image_widgets();
-            for (auto& i : imgs)
-            {
-                if (i)
-                {
-                    i->blast_out_image_artifacts_at_last_position();
-                }
-            }
-        }
+        blast_out_image_artifacts(t.second.get());
     }
 
     for (auto& thread : page_data->posts)
@@ -199,6 +391,10 @@ void Catalog4chanWidget::rebuild(bool b_rebuild_children)
                     thread);
             thread_map[cat_thread->get_post_num()] = cat_thread;
         }
+        else
+        {
+            cat_thread->update_reply_and_image_count(thread);
+        }
 
         new_keys.push_back(cat_thread->get_post_num());
         threads_grid->add_child_widget(cat_thread, false);
@@ -210,28 +406,16 @@ void Catalog4chanWidget::rebuild(bool b_rebuild_children)
         auto it = std::find(new_keys.begin(), new_keys.end(), k);
         if (it == new_keys.end())
         {
+            if (selected_thread == thread_map[k].get())
+            {
+                selected_thread = nullptr;
+            }
+
             thread_map.erase(k);
         }
     }
 
-    footer_info->append_text("Threads:");
-    footer_info->append_text(std::to_string(thread_map.size()));
-
-    base_footer_text = footer_info->get_term_words();
-    if (!footer_countdown.empty())
-    {
-        footer_info->append_text(footer_countdown);
-    }
-    else
-    {
-        std::string t = "| Reload in " + std::to_string(auto_ref_s) + "s";
-        footer_info->append_text(t);
-        b_auto_update = true;
-    }
-
-    main_vbox->add_child_widget(header, false /* rebuild */);
-    main_vbox->add_child_widget(posts_box, false /* rebuild */);
-    main_vbox->add_child_widget(footer, false /* rebuild */);
+    set_footer_info();
 
     // shrink posts_box to fit header and footer
     header->rebuild(true);
@@ -240,7 +424,6 @@ void Catalog4chanWidget::rebuild(bool b_rebuild_children)
     shrink += footer->get_height_constraint();
     posts_box->set_size(1, term_h() - shrink);
 
-    set_child_widget(main_vbox, false /* rebuild */);
     main_vbox->rebuild(true /* recursive */);
 
     // restore thread scroll position
@@ -256,17 +439,10 @@ void Catalog4chanWidget::rebuild(bool b_rebuild_children)
 
 std::shared_ptr<CatalogThread4chanWidget> Catalog4chanWidget::get_thread(int post_num)
 {
-    try
+    auto it = thread_map.find(post_num);
+    if (it != thread_map.end())
     {
-        std::shared_ptr<CatalogThread4chanWidget> wgt = thread_map.at(post_num);
-        if (wgt)
-        {
-            return wgt;
-        }
-    }
-    catch (const std::out_of_range& oor)
-    {
-        return nullptr;
+        return it->second;
     }
 
     return nullptr;
@@ -294,6 +470,7 @@ void Catalog4chanWidget::select_thread(CatalogThread4chanWidget* thread)
         if (selected_thread) selected_thread->unselect();
         thread->select();
         selected_thread = thread;
+        prefetch_thread(thread->get_post_num());
     }
     else
     {
@@ -304,19 +481,126 @@ void Catalog4chanWidget::select_thread(CatalogThread4chanWidget* thread)
 
 
 // TODO:    enable navigation of threads using key input
-//
-//bool Catalog4chanWidget::handle_key_input(const tb_event& input_event)
-//{
-//    bool b_handled = Thread4chanWidget::handle_key_input(input_event);
-//    if (!b_handled)
-//    {
-//        if (input_event.key == TB_KEY_...)
-//        {
-//        }
-//    }
-//
-//    return b_handled;
-//}
+bool Catalog4chanWidget::handle_key_input(const tb_event& input_event, bool b_bubble_up)
+{
+    // close catalog
+    if (input_event.key == TB_KEY_CTRL_X)
+    {
+        cancel_prefetch();
+    }
+
+    bool b_handled = Thread4chanWidget::handle_key_input(input_event, b_bubble_up);
+
+    // mouse moved, or the wheel scrolled a different
+    // thread under it
+    if (input_event.type == TB_EVENT_MOUSE &&
+        input_event.key != TB_KEY_CTRL_X)
+    {
+        mouse_coord = vector2d(input_event.x, input_event.y);
+        update_hovered_thread(mouse_coord);
+    }
+
+    return b_handled;
+}
+
+
+void Catalog4chanWidget::arrange()
+{
+    // the thread under the mouse is looked for again
+    // once the wheel's scrolling has been done
+    if (apply_pending_scroll() && mouse_coord.x > -1)
+    {
+        update_hovered_thread(mouse_coord);
+    }
+}
+
+
+void Catalog4chanWidget::update_hovered_thread(vector2d coord)
+{
+    int post_num = -1;
+
+    TermWidget* wgt = get_topmost_child_at(coord);
+    while (wgt && wgt != this)
+    {
+        CatalogThread4chanWidget* thread =
+            dynamic_cast<CatalogThread4chanWidget*>(wgt);
+        if (thread)
+        {
+            post_num = thread->get_post_num();
+            break;
+        }
+
+        wgt = wgt->get_parent_widget();
+    }
+
+    if (post_num == hovered_post_num)
+    {
+        return;
+    }
+
+    hovered_post_num = post_num;
+    hover_time = std::chrono::milliseconds(0);
+
+    // mouse left the thread being prefetched
+    // (a selected thread keeps its prefetch)
+    if (!selected_thread ||
+        selected_thread->get_post_num() != prefetched_post_num)
+    {
+        cancel_prefetch();
+    }
+}
+
+
+void Catalog4chanWidget::tick_event(std::chrono::milliseconds delta)
+{
+    Thread4chanWidget::tick_event(delta);
+
+    if (hovered_post_num == -1 || hovered_post_num == prefetched_post_num)
+    {
+        return;
+    }
+
+    hover_time += delta;
+    if (hover_time >= prefetch_dwell)
+    {
+        prefetch_thread(hovered_post_num);
+    }
+}
+
+
+void Catalog4chanWidget::prefetch_thread(int post_num)
+{
+    if (post_num == prefetched_post_num) return;
+
+    std::shared_ptr<CatalogThread4chanWidget> thread = get_thread(post_num);
+    if (!thread) return;
+
+    cancel_prefetch();
+
+    prefetched_post_num = post_num;
+    prefetch_token = std::make_shared<cancel_token>();
+
+    // queued behind everything else, it's only a guess
+    NetOps::http_prefetch__4chan_thread(
+        thread->get_thread_url(),
+        DISPLAY_IMAGES ? prefetch_num_images : 0,
+        prefetch_token,
+        get_prefetch_job_pool_id(),
+        false /* b_push_to_front */);
+}
+
+
+void Catalog4chanWidget::cancel_prefetch()
+{
+    if (prefetch_token)
+    {
+        prefetch_token->cancel();
+        prefetch_token = nullptr;
+    }
+
+    THREAD_MAN.kill_jobs(get_prefetch_job_pool_id());
+    prefetched_post_num = -1;
+}
 
 
 void Catalog4chanWidget::receive_left_click(vector2d coord, TermWidget* clicked, TermWidget* source)
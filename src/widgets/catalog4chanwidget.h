@@ -10,11 +10,13 @@
 #include "thread4chanwidget.h"
 
 struct data_4chan;
+struct cancel_token;
 class CatalogThread4chanWidget;
 class ColorBlockWidget;
 class ScrollPanelWidget;
 class BoxWidget;
 class TextWidget;
+class WrapGrid;
 
 
 class Catalog4chanWidget : public Thread4chanWidget
@@ -30,8 +32,38 @@ protected:
     std::string board_url;
     std::map<int, std::shared_ptr<CatalogThread4chanWidget>> thread_map;
     CatalogThread4chanWidget* selected_thread;
+    std::shared_ptr<WrapGrid> threads_grid;
     vector2d thread_box_size;
 
+    // moves bumped threads, adds new ones and takes out pruned
+    // ones, leaving the rest of the grid as it is
+    virtual void apply_page_data(std::shared_ptr<imageboard::page_data> new_data) override;
+    void update_threads();
+    void set_footer_info();
+    // makes the boxes, header and footer the threads are shown in
+    void build_frame();
+    // clears the thumbnail of a thread that is moved or removed
+    void blast_out_image_artifacts(CatalogThread4chanWidget* thread);
+
+    // threads that are selected, or that the mouse rests on for
+    // prefetch_dwell, have their json and first few images
+    // fetched into the cache ahead of being opened
+    int hovered_post_num;
+    int prefetched_post_num;
+    int prefetch_num_images;
+    std::chrono::milliseconds prefetch_dwell;
+    std::chrono::milliseconds hover_time;
+    std::shared_ptr<cancel_token> prefetch_token;
+
+    // where the mouse was last seen, -1 if it hasn't been
+    vector2d mouse_coord;
+    void update_hovered_thread(vector2d coord);
+    void prefetch_thread(int post_num);
+    void cancel_prefetch();
+    std::string get_prefetch_job_pool_id() const { return get_id() + "#prefetch"; };
+
+    virtual void tick_event(std::chrono::milliseconds delta) override;
+
 
 public:
 
@@ -41,9 +73,12 @@ public:
     std::shared_ptr<CatalogThread4chanWidget> get_thread(int post_num);
 
     virtual void rebuild(bool b_rebuild_children = true) override;
+    // scrolls by the input since the last frame. the boxes
+    // are arranged by then, and rebuild() would start over
+    virtual void arrange() override;
     virtual bool receive_img_packet(img_packet& pac) override;
 
-    //virtual bool handle_key_input(const tb_event& input_event) override;
+    virtual bool handle_key_input(const tb_event& input_event, bool b_bubble_up = true) override;
 
     virtual void receive_left_click(vector2d coord, TermWidget* clicked = nullptr, TermWidget* source = nullptr) override;
 };
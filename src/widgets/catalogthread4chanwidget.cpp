@@ -32,9 +32,9 @@ void CatalogThread4chanWidget::rebuild(bool b_rebuild_children)
 
     if (!child_widget)
     {
-        std::string sub = post_data->subject;
-        std::string com = post_data->text;
-        std::string ext = post_data->img_ext;
+        std::string sub(post_data->subject);
+        std::string com(post_data->text);
+        std::string ext(post_data->img_ext);
         int64_t tim = post_data->img_time;
         int no = post_data->num;
         reply_count = post_data->replies;
@@ -61,6 +61,7 @@ void CatalogThread4chanWidget::rebuild(bool b_rebuild_children)
                 COLO.thread_bg, COLO.thread_title);
             post_title->set_h_sizing(e_widget_sizing::ws_fill);
             post_title->set_v_sizing(e_widget_sizing::ws_dynamic);
+            post_title->set_parse_html(true);
             post_title->append_text(
                 sub,
                 false,  // rebuild
@@ -74,6 +75,7 @@ void CatalogThread4chanWidget::rebuild(bool b_rebuild_children)
         post_text->set_h_sizing(e_widget_sizing::ws_fill);
         post_text->set_v_sizing(e_widget_sizing::ws_fill);
         post_text->set_parse_4chan(true);
+        post_text->set_parse_html(true);
         post_text->append_text(com, false /* rebuild */);
 
         main_box =
@@ -139,6 +141,10 @@ void CatalogThread4chanWidget::rebuild(bool b_rebuild_children)
 
 bool CatalogThread4chanWidget::update_reply_and_image_count(imageboard::post& _post_data)
 {
+    // the old page_data, and the strings of its posts, go
+    // away once the catalog has taken the new one
+    post_data = &_post_data;
+
     if (_post_data.replies == reply_count &&
         _post_data.images == image_count)
     {
@@ -169,19 +175,27 @@ void CatalogThread4chanWidget::rebuild_vbox()
 {
     if (!main_box) return;
 
-    vbox = std::make_shared<VerticalBoxWidget>();
+    if (!vbox)
+    {
+        vbox = std::make_shared<VerticalBoxWidget>();
+        main_box->set_child_widget(vbox, false /* rebuild */);
+    }
+    else
+    {
+        vbox->clear_children();
+    }
+
     vbox->add_child_widget(image_box, false);
     vbox->add_child_widget(post_info, false);
     vbox->add_child_widget(post_title, false);
     vbox->add_child_widget(post_text, false);
-
-    main_box->set_child_widget(vbox, false /* rebuild */);
 }
 
 
 bool CatalogThread4chanWidget::add_image(img_packet& pac, bool b_refresh_parent)
 {
-    if (!DISPLAY_IMAGES || !catalog ||
+    // a missing thumbnail leaves the box empty
+    if (pac.b_failed || !DISPLAY_IMAGES || !catalog ||
         !main_box || pac.is_video())
         return false;
 
@@ -270,8 +284,21 @@ void CatalogThread4chanWidget::receive_left_click(vector2d coord, TermWidget* cl
 
     if (!catalog) return;
 
+    // op is shown right away while the thread loads
+    WIDGET_MAN.open_thread(
+        get_thread_url(),
+        true, // b_steal_focus
+        post_data,
+        catalog->get_page_data());
+}
+
+
+std::string CatalogThread4chanWidget::get_thread_url() const
+{
+    if (!catalog) return "";
+
     std::string url = "a.4cdn.org/" + catalog->get_board() + "/thread/";
     url += std::to_string(post_num) + ".json";
-    WIDGET_MAN.open_thread(url, true /* b_steal_focus */);
+    return url;
 }
 
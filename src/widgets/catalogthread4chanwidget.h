@@ -38,6 +38,9 @@ protected:
 
 public:
 
+    // json url of the thread
+    std::string get_thread_url() const;
+
     // returns true if there was any change to the counts
     bool update_reply_and_image_count(imageboard::post& _post_data);
 
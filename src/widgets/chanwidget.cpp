@@ -14,12 +14,20 @@ ChanWidget::ChanWidget(vector2d _offset, vector4d _padding, vector4d _child_padd
 {
     page_data = nullptr;
     last_update_time = 0;
+    b_partial = false;
 }
 
 
 // returns true if there are changes and redraw is required
 bool ChanWidget::update(data_4chan& chan_data)
 {
+    // the whole page is already shown (e.g. it was opened
+    // again), don't go back to the part that has come in
+    if (chan_data.b_partial && page_data && !b_partial)
+    {
+        return false;
+    }
+
     bool b_redraw = on_received_update(chan_data);
     last_update_time = chan_data.fetch_time;
 
@@ -48,8 +56,8 @@ bool ChanWidget::update(data_4chan& chan_data)
     }
     else
     {
-        page_data = chan_data.page_data;
-        rebuild();
+        b_partial = chan_data.b_partial;
+        apply_page_data(chan_data.page_data);
 
         b_redraw = true;
     }
@@ -57,3 +65,9 @@ bool ChanWidget::update(data_4chan& chan_data)
     return b_redraw;
 }
 
+
+void ChanWidget::apply_page_data(std::shared_ptr<imageboard::page_data> new_data)
+{
+    page_data = new_data;
+    rebuild();
+}
@@ -22,11 +22,20 @@ public:
     // returns true if redraw is required
     virtual bool on_received_update(data_4chan& chan_data) { return false; };
 
+    std::shared_ptr<imageboard::page_data> get_page_data() const { return page_data; };
+    // only part of the page has been received so far
+    bool is_partial() const { return b_partial; };
+
 
 protected:
 
     std::shared_ptr<imageboard::page_data> page_data;
     long last_update_time;
 
+    // takes the page_data of an update and rebuilds. widgets that
+    // can apply only what has changed since the last one override it.
+    virtual void apply_page_data(std::shared_ptr<imageboard::page_data> new_data);
+    bool b_partial;
+
 };
 
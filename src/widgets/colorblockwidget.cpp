@@ -30,6 +30,8 @@ ColorBlockWidget::ColorBlockWidget(uint16_t _color, bool _b_fullscreen, vector2d
 
 void ColorBlockWidget::rebuild(bool b_rebuild_children)
 {
+    invalidate_paint();
+
     cells.clear();
 
     update_size();
@@ -200,7 +200,7 @@ void HomescreenWidget::show_saved_threads(HomescreenWidget* hs)
                 item += " - [empty subject]";
             }
 
-            wg->add_selection(item, std::bind(WIDGET_MAN.open_thread, lines[0], true));
+            wg->add_selection(item, std::bind(WIDGET_MAN.open_thread, lines[0], true, nullptr, nullptr, -1));
         }
     }
 
@@ -264,6 +264,8 @@ void HomescreenWidget::show_help(HomescreenWidget* hs)
     help += "CTRL+R                   Reload the focused page from the network\n";
     help += "CTRL+A                   Enable/disable auto-reload\n";
     help += "CTRL+S                   Save currently focused thread\n";
+    help += "CTRL+T                   Show only the selected post's reply chain\n";
+    help += "CTRL+F                   Search the posts of cached and opened threads\n";
     help += "F5                       Do a hard refresh of the screen\n";
     help += "Tab                      Switch between currently opened pages\n";
     help += "Space/Enter              Choose selection in list\n";
@@ -336,18 +338,18 @@ void HomescreenWidget::rebuild(bool b_rebuild_children)
         logo_text->set_h_align(e_widget_align::wa_center);
         logo_text->append_raw_text(logo, true);
 
-        std::wstring motd = L" Live the /comfy/ posting experience ";
-        std::wstring und;
+        std::string motd = " Live the /comfy/ posting experience ";
+        std::string und;
         for (int i = 0; i < 3; ++i)
         {
-            und += L"\u2500";
+            und += u8"\u2500";
         }
         und += motd;
-        for (int i = 0; i < logo_text->get_size().x - 1 - motd.length() - 3; ++i)
+        for (int i = 0; i < logo_text->get_size().x - 1 - utf8_width(motd) - 3; ++i)
         {
-            und += L"\u2500";
+            und += u8"\u2500";
         }
-        und += L" ";    // match trailing space on logo text lines
+        und += " ";    // match trailing space on logo text lines
 
         und_text = std::make_shared<TextWidget>(
             vector2d(),
@@ -369,6 +371,8 @@ void HomescreenWidget::rebuild(bool b_rebuild_children)
             "Browse 4chan", std::bind(show_4chan_boards_list, this));
         main_sel->add_selection(
             "Browse Saved Threads", std::bind(show_saved_threads, this));
+        main_sel->add_selection(
+            "Search Threads", []() { WIDGET_MAN.open_search_widget(); });
         main_sel->add_selection(
             "About", std::bind(show_about_info, this));
         main_sel->add_selection(
@@ -46,6 +46,8 @@ void ImageWidget::rebuild(bool b_rebuild_children)
 {
     if (!DISPLAY_IMAGES) return;
 
+    invalidate_paint();
+
     int w = get_width_constraint();
     int h = get_height_constraint();
 
@@ -140,10 +142,15 @@ void ImageWidget::draw(vector4d constraint, bool b_draw_children) const
     // y end
     if (constraint.d == -1) constraint.d = term_h();
 
+    vector2d absolute_offset = get_absolute_offset();
+    if (paint_is_current(absolute_offset, rows_on_screen(absolute_offset, constraint)))
+    {
+        return;
+    }
+
     int w = get_width_constraint();
     int h = get_height_constraint();
 
-    vector2d absolute_offset = get_absolute_offset();
     img_offset_cache = absolute_offset;
 
     // do not draw if off screen
@@ -12,6 +12,7 @@
 
 MultiChildWidget::MultiChildWidget(vector2d _offset, vector4d _padding, vector4d _child_padding, uint32_t _bg_color, uint32_t _fg_color, bool _b_fullscreen)
 : TermWidget(_offset, _padding, _child_padding, _bg_color, _fg_color, _b_fullscreen)
+, child_changes(0)
 {}
 
 
@@ -24,6 +25,7 @@ void MultiChildWidget::add_child_widget(std::shared_ptr<TermWidget> child_widget
 
         children.push_back(child_widget);
         child_widget->set_parent_widget(this);
+        ++child_changes;
         child_widget->update_size();
 
         if (b_rebuild)
@@ -34,6 +36,102 @@ void MultiChildWidget::add_child_widget(std::shared_ptr<TermWidget> child_widget
 }
 
 
+void MultiChildWidget::insert_child_widget(size_t index, std::shared_ptr<TermWidget> child_widget, bool b_rebuild)
+{
+    if (index >= children.size())
+    {
+        add_child_widget(child_widget, b_rebuild);
+        return;
+    }
+
+    // prevent parent widgets from being set as child widget
+    if (child_widget && !is_child_of(child_widget.get()))
+    {
+        set_managed_sizing(child_widget);
+
+        children.insert(children.begin() + index, child_widget);
+        child_widget->set_parent_widget(this);
+        ++child_changes;
+        child_widget->update_size();
+
+        if (b_rebuild)
+        {
+            rebuild();
+        }
+    }
+}
+
+
+void MultiChildWidget::remove_child_widget(TermWidget* child_widget, bool b_rebuild)
+{
+    auto it = std::find_if(
+        children.begin(),
+        children.end(),
+        [child_widget](const std::shared_ptr<TermWidget>& child) {
+            return child.get() == child_widget;
+        });
+
+    if (it != children.end())
+    {
+        if ((*it)->get_parent_widget() == this)
+        {
+            (*it)->set_parent_widget(nullptr);
+        }
+
+        children.erase(it);
+        ++child_changes;
+
+        if (b_rebuild)
+        {
+            rebuild();
+        }
+    }
+}
+
+
+void MultiChildWidget::remove_children_if(const std::function<bool(TermWidget*)>& pred)
+{
+    size_t count = children.size();
+
+    children.erase(
+        std::remove_if(
+            children.begin(),
+            children.end(),
+            [this, &pred](const std::shared_ptr<TermWidget>& child) {
+                if (!child) return true;
+                if (!pred(child.get())) return false;
+
+                if (child->get_parent_widget() == this)
+                {
+                    child->set_parent_widget(nullptr);
+                }
+
+                return true;
+            }),
+        children.end());
+
+    if (children.size() != count)
+    {
+        ++child_changes;
+    }
+}
+
+
+void MultiChildWidget::clear_children()
+{
+    for (auto& child : children)
+    {
+        if (child && child->get_parent_widget() == this)
+        {
+            child->set_parent_widget(nullptr);
+        }
+    }
+
+    children.clear();
+    ++child_changes;
+}
+
+
 TermWidget* MultiChildWidget::get_topmost_child_at(vector2d coord)
 {
     // click within box
@@ -80,6 +178,18 @@ void MultiChildWidget::draw_children(vector4d constraint) const
 }
 
 
+void MultiChildWidget::for_each_child(const std::function<void(TermWidget*)>& fn)
+{
+    for (auto& child : children)
+    {
+        if (child)
+        {
+            fn(child.get());
+        }
+    }
+}
+
+
 void MultiChildWidget::update_child_size(bool b_recursive)
 {
     for (auto& child : children)
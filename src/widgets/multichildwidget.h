@@ -20,12 +20,28 @@ public:
     virtual void child_widget_size_change_event() override;
     virtual void set_managed_sizing(std::shared_ptr<TermWidget> wgt) {};
     void add_child_widget(std::shared_ptr<TermWidget> child_widget, bool b_rebuild);
+    // inserts child_widget before the child at index,
+    // or at the end if index is past the last child
+    void insert_child_widget(size_t index, std::shared_ptr<TermWidget> child_widget, bool b_rebuild);
+    void remove_child_widget(TermWidget* child_widget, bool b_rebuild);
+    // removes the children pred returns true for, without rebuilding
+    void remove_children_if(const std::function<bool(TermWidget*)>& pred);
+    void clear_children();
     virtual void draw_children(vector4d constraint = vector4d(-1)) const override;
     virtual void update_child_size(bool b_recursive = false) override;
     virtual TermWidget* get_topmost_child_at(vector2d coord) override;
+    virtual void for_each_child(const std::function<void(TermWidget*)>& fn) override;
 
     std::vector<std::shared_ptr<TermWidget>> children;
     int num_children() const;
+    // goes up each time children are added or removed, so an index
+    // of the children can tell that it's out of date
+    size_t get_child_changes() const { return child_changes; };
+
+
+protected:
+
+    size_t child_changes;
 
 };
 
@@ -8,6 +8,7 @@
  */
 #include "post4chanwidget.h"
 #include "../netops.h"
+#include "../fileops.h"
 #include "../widgetman.h"
 #include "widgets.h"
 #include <iomanip>
@@ -29,6 +30,16 @@ Post4chanWidget::Post4chanWidget(Thread4chanWidget* _thread, imageboard::post& _
     post_text = nullptr;
     reply_div = nullptr;
     replies_text = nullptr;
+    b_img_requested = false;
+    b_img_loaded = false;
+    b_flag_loaded = false;
+    b_thumb_requested = false;
+    b_img_failed = false;
+    b_flag_failed = false;
+    img_fails = 0;
+    b_needs_reflow = false;
+    b_virtual = false;
+    virtual_h = 0;
     set_h_sizing(e_widget_sizing::ws_fill);
     set_v_sizing(e_widget_sizing::ws_auto);
 }
@@ -63,122 +74,121 @@ void Post4chanWidget::rebuild(bool b_rebuild_children)
         return;
     }
 
+    if (!child_widget && b_virtual)
+    {
+        update_size(false);
+        return;
+    }
+
+    if (!child_widget || b_rebuild_children)
+    {
+        b_needs_reflow = false;
+    }
+
     if (!child_widget)
     {
         b_is_op = post_data->b_op;
 
-        post_info =
-            std::make_shared<TextWidget>(
-                vector2d(),
-                vector4d(1, 0, 1, 0),
-                COLO.post_info_bg,
-                COLO.post_info_fg);
-        post_info->set_h_sizing(e_widget_sizing::ws_fill);
-        post_info->set_v_sizing(e_widget_sizing::ws_dynamic);
-
-        post_info_box =
-            std::make_shared<BoxWidget>(
-                vector2d(),                     // offset
-                vector4d(0, 0, 0, 0),           // padding
-                vector2d(1, 1),                 // size
-                COLO.post_info_bg,              // bg_color
-                COLO.post_info_bg);             // fg_color
-        post_info_box->set_child_padding(vector4d());
-        post_info_box->set_h_sizing(e_widget_sizing::ws_fill);
-        post_info_box->set_v_sizing(e_widget_sizing::ws_auto);
-        post_info_box->set_draw_border(false);
-        post_info_box->set_child_widget(post_info, false);
-
-        // poster name
-        std::string nme = post_data->name;
-        // tripcode
-        if (!post_data->trip.empty())
+        if (!layout)
         {
-            nme += post_data->trip;
+            layout = make_layout(*post_data, 0);
         }
-        post_info->append_text(nme, false);
 
-        // id
-        if (!post_data->id.empty())
+        // widgets of a post released earlier, which are
+        // filled in with this one's data instead of made again
+        std::shared_ptr<post_tree> tree = thread->take_post_tree();
+
+        if (tree)
         {
-            std::string pid = " (ID: ";
-            pid += post_data->id;
-            pid += ")";
-            post_info->append_text(pid, false);
+            main_box = tree->main_box;
+            vbox = tree->vbox;
+            info_hbox = tree->info_hbox;
+            post_info_box = tree->post_info_box;
+            post_info = tree->post_info;
+            post_info->clear_text();
+        }
+        else
+        {
+            post_info =
+                std::make_shared<TextWidget>(
+                    vector2d(),
+                    vector4d(1, 0, 1, 0),
+                    COLO.post_info_bg,
+                    COLO.post_info_fg);
+            post_info->set_h_sizing(e_widget_sizing::ws_fill);
+            post_info->set_v_sizing(e_widget_sizing::ws_dynamic);
+
+            post_info_box =
+                std::make_shared<BoxWidget>(
+                    vector2d(),                     // offset
+                    vector4d(0, 0, 0, 0),           // padding
+                    vector2d(1, 1),                 // size
+                    COLO.post_info_bg,              // bg_color
+                    COLO.post_info_bg);             // fg_color
+            post_info_box->set_child_padding(vector4d());
+            post_info_box->set_h_sizing(e_widget_sizing::ws_fill);
+            post_info_box->set_v_sizing(e_widget_sizing::ws_auto);
+            post_info_box->set_draw_border(false);
+            post_info_box->set_child_widget(post_info, false);
+
+            main_box =
+                std::make_shared<BoxWidget>(
+                    vector2d(),
+                    vector4d(),
+                    vector2d(),
+                    COLO.post_bg,
+                    COLO.post_border);
+            main_box->set_h_sizing(e_widget_sizing::ws_fill);
+            main_box->set_v_sizing(e_widget_sizing::ws_auto);
         }
 
-        // post datetime
-        std::string dte = " ";
-        dte += post_data->datetime;
-        post_info->append_text(dte, false);
-
-        // post number
-        std::string no = " No.";
-        no += std::to_string(post_num);
-        post_info->append_text(no, false);
+        post_info->append_text(layout->info_words);
 
         // image info
-        if (!post_data->img_filename.empty())
+        if (!layout->img_info_words.empty())
         {
-            bool b_kb = true;
-            int bytes = post_data->img_fsize;
-            float size = (float)bytes / 1024;
-            if (size > 1024)
-            {
-                size = size / 1024;
-                b_kb = false;
-            }
-            std::string inf = "File: " + post_data->img_filename;
-            inf += post_data->img_ext;
-            inf += " (";
-
-            std::ostringstream size_str;
-            size_str << std::fixed;
-            size_str << std::setprecision(2);
-            size_str << size;
-            inf += size_str.str();
-            if (b_kb)
+            if (tree && tree->img_info)
             {
-                inf += " KB";
+                img_info = tree->img_info;
+                img_info->clear_text();
             }
             else
             {
-                inf += " MB";
+                img_info = std::make_shared<TextWidget>(
+                    vector2d(),
+                    vector4d(0, 0, 0, 1),
+                    COLO.post_bg, COLO.post_img_info);
+                img_info->set_h_sizing(e_widget_sizing::ws_fill);
+                img_info->set_v_sizing(e_widget_sizing::ws_dynamic);
             }
 
-            inf += ", " + std::to_string(post_data->img_w);
-            inf += "x" + std::to_string(post_data->img_h) + ")";
-            img_info = std::make_shared<TextWidget>(
-                vector2d(),
-                vector4d(0, 0, 0, 1),
-                COLO.post_bg, COLO.post_img_info);
-            img_info->set_h_sizing(e_widget_sizing::ws_fill);
-            img_info->set_v_sizing(e_widget_sizing::ws_dynamic);
-            img_info->append_text(inf, false /* rebuild */);
+            img_info->append_text(layout->img_info_words);
         }
 
         // post text
         if (!post_data->text.empty())
         {
-            post_text = std::make_shared<TextWidget>(
-                vector2d(),
-                vector4d(0, 0, 0, 1),
-                COLO.post_bg, COLO.post_text);
-            post_text->set_h_sizing(e_widget_sizing::ws_fill);
-            post_text->set_v_sizing(e_widget_sizing::ws_dynamic);
-            post_text->set_parse_4chan(true);
-            post_text->append_text(post_data->text, false /* rebuild */);
-        }
+            if (tree && tree->post_text)
+            {
+                post_text = tree->post_text;
+                post_text->clear_override_formatting();
+                post_text->clear_text();
+            }
+            else
+            {
+                post_text = std::make_shared<TextWidget>(
+                    vector2d(),
+                    vector4d(0, 0, 0, 1),
+                    COLO.post_bg, COLO.post_text);
+                post_text->set_h_sizing(e_widget_sizing::ws_fill);
+                post_text->set_v_sizing(e_widget_sizing::ws_dynamic);
+                post_text->set_parse_4chan(true);
+                post_text->set_parse_html(true);
+            }
 
-        main_box =
-            std::make_shared<BoxWidget>(
-                vector2d(),
-                vector4d(),
-                vector2d(),
-                COLO.post_bg,
-                COLO.post_border);
-        main_box->set_h_sizing(e_widget_sizing::ws_fill);
-        main_box->set_v_sizing(e_widget_sizing::ws_auto);
+            post_text->append_text(layout->text_words);
+            post_text->set_layout(layout->text_cells);
+        }
 
         if (DISPLAY_IMAGES)
         {
@@ -187,7 +197,6 @@ void Post4chanWidget::rebuild(bool b_rebuild_children)
                 !post_data->troll_country.empty())
             {
                 std::string file_name;
-                std::string flag_url;
 
                 if (!post_data->country.empty())
                 {
@@ -206,54 +215,70 @@ void Post4chanWidget::rebuild(bool b_rebuild_children)
                     flag_url += file_name;
                 }
 
-                IMG_MAN.request_image(
-                    flag_url,
-                    vector2d(-1, FLAG_IMG_H),
-                    thread->get_id(),
-                    thread->get_thread_num_str(),
-                    post_num);
-
                 // flag box
-                flag_box = std::make_shared<BoxWidget>(
-                    vector2d(), // offset
-                    vector4d(0, 0, 0, 0) // padding
-                );
-                flag_box->set_size(3, FLAG_IMG_H);
-                flag_box->set_h_sizing(e_widget_sizing::ws_fixed);
-                flag_box->set_v_sizing(e_widget_sizing::ws_fixed);
-                flag_box->set_child_padding(vector4d());
-                flag_box->set_draw_border(false);
-                flag_box->set_bg_color(COLO.post_bg);
+                if (tree && tree->flag_box)
+                {
+                    // the other post's flag goes with it
+                    flag_box = tree->flag_box;
+                    flag_box->set_child_widget(nullptr, false /* rebuild */);
+                }
+                else
+                {
+                    flag_box = std::make_shared<BoxWidget>(
+                        vector2d(), // offset
+                        vector4d(0, 0, 0, 0) // padding
+                    );
+                    flag_box->set_size(3, FLAG_IMG_H);
+                    flag_box->set_h_sizing(e_widget_sizing::ws_fixed);
+                    flag_box->set_v_sizing(e_widget_sizing::ws_fixed);
+                    flag_box->set_child_padding(vector4d());
+                    flag_box->set_draw_border(false);
+                }
                 flag_box->set_bg_color(COLO.post_bg);
+                flag_box->set_fg_color(COLO.post_bg);
             }
 
             // post images
             if (post_data->img_time != 0)
             {
                 std::string file_name =
-                    std::to_string(post_data->img_time) +
-                    post_data->img_ext;
-                std::string img_url = "https://i.4cdn.org/";
+                    std::to_string(post_data->img_time);
+                file_name += post_data->img_ext;
+                img_url = "https://i.4cdn.org/";
                 img_url += thread->get_board();
                 img_url += "/" + file_name;
+                thumb_url = "https://i.4cdn.org/";
+                thumb_url += thread->get_board();
+                thumb_url += "/" + std::to_string(post_data->img_time) + "s.jpg";
 
-                IMG_MAN.request_image(
+                // videos can't be displayed, so there is no
+                // image packet to wait for
+                b_img_loaded = http_image_req(
                     img_url,
-                    vector2d(-1, POST_IMG_H),
+                    vector2d(),
                     thread->get_id(),
                     thread->get_thread_num_str(),
-                    post_num);
+                    post_num).is_video();
 
                 // image box
-                image_box = std::make_shared<BoxWidget>(
-                    vector2d(), // offset
-                    vector4d(0, 0, 0, 1) // padding
-                );
+                if (tree && tree->image_box)
+                {
+                    // the other post's image goes with it
+                    image_box = tree->image_box;
+                    image_box->set_child_widget(nullptr, false /* rebuild */);
+                }
+                else
+                {
+                    image_box = std::make_shared<BoxWidget>(
+                        vector2d(), // offset
+                        vector4d(0, 0, 0, 1) // padding
+                    );
+                    image_box->set_h_sizing(e_widget_sizing::ws_auto);
+                    image_box->set_v_sizing(e_widget_sizing::ws_fixed);
+                    image_box->set_child_padding(vector4d());
+                    image_box->set_draw_border(false);
+                }
                 image_box->set_size(1, POST_IMG_H);
-                image_box->set_h_sizing(e_widget_sizing::ws_auto);
-                image_box->set_v_sizing(e_widget_sizing::ws_fixed);
-                image_box->set_child_padding(vector4d());
-                image_box->set_draw_border(false);
                 image_box->set_bg_color(COLO.post_bg);
                 image_box->set_fg_color(COLO.post_bg);
             }
@@ -277,7 +302,6 @@ void Post4chanWidget::rebuild(bool b_rebuild_children)
             {
                 image_box->set_size(image_box->get_child_widget()->get_size());
                 image_box->rebuild(false);
-                rebuild_vbox();
 
                 if (vbox)
                     vbox->rebuild(false);
@@ -292,53 +316,413 @@ void Post4chanWidget::rebuild(bool b_rebuild_children)
 }
 
 
+std::shared_ptr<const post_layout> Post4chanWidget::make_layout(const imageboard::post& p, int text_width)
+{
+    std::shared_ptr<post_layout> layout = std::make_shared<post_layout>();
+
+    auto add_info = [&layout](const std::string& str) {
+        std::vector<term_word> words = TextWidget::make_words(
+            str, true /* html */, false, COLO.post_info_bg, COLO.post_info_fg);
+        layout->info_words.insert(layout->info_words.end(), words.begin(), words.end());
+    };
+
+    // poster name
+    std::string nme(p.name);
+    // tripcode
+    if (!p.trip.empty())
+    {
+        nme += p.trip;
+    }
+    add_info(nme);
+
+    // id
+    if (!p.id.empty())
+    {
+        std::string pid = " (ID: ";
+        pid += p.id;
+        pid += ")";
+        add_info(pid);
+    }
+
+    // post datetime
+    std::string dte = " ";
+    dte += p.datetime;
+    add_info(dte);
+
+    // post number
+    std::string no = " No.";
+    no += std::to_string(p.num);
+    add_info(no);
+
+    // image info
+    if (!p.img_filename.empty())
+    {
+        bool b_kb = true;
+        int bytes = p.img_fsize;
+        float size = (float)bytes / 1024;
+        if (size > 1024)
+        {
+            size = size / 1024;
+            b_kb = false;
+        }
+        std::string inf = "File: ";
+        inf += p.img_filename;
+        inf += p.img_ext;
+        inf += " (";
+
+        std::ostringstream size_str;
+        size_str << std::fixed;
+        size_str << std::setprecision(2);
+        size_str << size;
+        inf += size_str.str();
+        if (b_kb)
+        {
+            inf += " KB";
+        }
+        else
+        {
+            inf += " MB";
+        }
+
+        inf += ", " + std::to_string(p.img_w);
+        inf += "x" + std::to_string(p.img_h) + ")";
+
+        layout->img_info_words = TextWidget::make_words(
+            inf, true /* html */, false, COLO.post_bg, COLO.post_img_info);
+    }
+
+    // post text
+    if (!p.text.empty())
+    {
+        layout->text_words = TextWidget::make_words(
+            p.text, true /* html */, true, COLO.post_bg, COLO.post_text);
+
+        if (text_width > 0)
+        {
+            std::shared_ptr<text_layout> cells = std::make_shared<text_layout>();
+            TextWidget::wrap_words(
+                layout->text_words,
+                text_width,
+                -1, // max height (v sizing is dynamic)
+                std::vector<style_run>(),
+                *cells);
+            layout->text_cells = cells;
+        }
+    }
+
+    return layout;
+}
+
+
+void Post4chanWidget::materialize()
+{
+    b_virtual = false;
+    if (child_widget) return;
+
+    // the post's own widgets are still in the thread's pool,
+    // with its images in them, and only need laying out again
+    std::shared_ptr<post_tree> tree = released_tree.lock();
+    released_tree.reset();
+    if (tree && thread && thread->unpool_post_tree(tree))
+    {
+        main_box = tree->main_box;
+        vbox = tree->vbox;
+        info_hbox = tree->info_hbox;
+        flag_box = tree->flag_box;
+        image_box = tree->image_box;
+        post_info_box = tree->post_info_box;
+        post_info = tree->post_info;
+        img_info = tree->img_info;
+        post_text = tree->post_text;
+        reply_div = tree->reply_div;
+        replies_text = tree->replies_text;
+        b_img_requested = tree->b_img_requested;
+        b_img_loaded = tree->b_img_loaded;
+        b_flag_loaded = tree->b_flag_loaded;
+        b_thumb_requested = tree->b_thumb_requested;
+
+        set_child_widget(main_box, false /* rebuild */);
+
+        // replies may have come in since
+        load_replies();
+        rebuild(true);
+        return;
+    }
+
+    rebuild(true);
+
+    if (main_box && !replies.empty())
+    {
+        load_replies();
+        main_box->rebuild(true);
+        update_size(true /* recursive */);
+    }
+}
+
+
+void Post4chanWidget::release()
+{
+    if (!child_widget) return;
+
+    virtual_h = size.y;
+    b_virtual = true;
+
+    set_child_widget(nullptr, false /* rebuild */);
+
+    if (thread)
+    {
+        std::shared_ptr<post_tree> tree = std::make_shared<post_tree>();
+        tree->main_box = main_box;
+        tree->vbox = vbox;
+        tree->info_hbox = info_hbox;
+        tree->flag_box = flag_box;
+        tree->image_box = image_box;
+        tree->post_info_box = post_info_box;
+        tree->post_info = post_info;
+        tree->img_info = img_info;
+        tree->post_text = post_text;
+        tree->reply_div = reply_div;
+        tree->replies_text = replies_text;
+        tree->b_img_requested = b_img_requested;
+        tree->b_img_loaded = b_img_loaded;
+        tree->b_flag_loaded = b_flag_loaded;
+        tree->b_thumb_requested = b_thumb_requested;
+
+        thread->pool_post_tree(tree);
+        released_tree = tree;
+    }
+
+    main_box = nullptr;
+    vbox = nullptr;
+    info_hbox = nullptr;
+    flag_box = nullptr;
+    image_box = nullptr;
+    post_info_box = nullptr;
+    post_info = nullptr;
+    img_info = nullptr;
+    post_text = nullptr;
+    reply_div = nullptr;
+    replies_text = nullptr;
+
+    // the images went with the widgets, and are requested
+    // again if the post doesn't get them back from the pool
+    b_img_requested = false;
+    b_img_loaded = false;
+    b_flag_loaded = false;
+    b_thumb_requested = false;
+}
+
+
+int Post4chanWidget::estimate_height() const
+{
+    if (virtual_h > 0) return virtual_h;
+    if (!post_data) return 1;
+
+    // columns the text is wrapped at, inside the border.
+    // the post's size may not have been set yet
+    int text_w = std::max(1, get_width_constraint() - 4);
+
+    // border, and post info with the row below it
+    int h = 4;
+
+    if (layout && !layout->img_info_words.empty())
+    {
+        h += 2;
+    }
+
+    if (DISPLAY_IMAGES && post_data->img_time != 0)
+    {
+        h += POST_IMG_H + 1;
+    }
+
+    if (!post_data->text.empty())
+    {
+        if (layout && layout->text_cells)
+        {
+            h += layout->text_cells->cells.size() + 1;
+        }
+        else
+        {
+            // the html makes it longer than the text it shows
+            h += post_data->text.length() / text_w + 2;
+        }
+    }
+
+    if (!replies.empty())
+    {
+        // divider, and about ten columns a >>reply
+        h += 1 + (replies.size() * 10) / text_w + 1;
+    }
+
+    return h;
+}
+
+
+int Post4chanWidget::get_text_wrap_width() const
+{
+    return post_text ? post_text->get_wrap_width() : 0;
+}
+
+
+bool Post4chanWidget::has_unloaded_images() const
+{
+    return (!img_url.empty() && !b_img_loaded && !b_img_failed) ||
+           (!flag_url.empty() && !b_flag_loaded && !b_flag_failed);
+}
+
+
+void Post4chanWidget::request_images(const std::string& job_pool_id)
+{
+    if (!DISPLAY_IMAGES || !thread || b_img_requested)
+        return;
+
+    if (!flag_url.empty() && !b_flag_loaded && !b_flag_failed)
+    {
+        IMG_MAN.request_image(
+            flag_url,
+            vector2d(-1, FLAG_IMG_H),
+            thread->get_id(),
+            thread->get_thread_num_str(),
+            post_num,
+            job_pool_id);
+    }
+
+    if (!img_url.empty() && !b_img_loaded && !b_img_failed)
+    {
+        // load the thumbnail from disk first if the full
+        // image still has to be downloaded
+        if (!b_thumb_requested && !thumb_url.empty())
+        {
+            http_image_req img_req(
+                img_url,
+                vector2d(),
+                thread->get_id(),
+                thread->get_thread_num_str(),
+                post_num);
+            http_image_req thumb_req(
+                thumb_url,
+                vector2d(),
+                thread->get_id(),
+                thread->get_thread_num_str(),
+                post_num);
+
+            if (!FileOps::file_exists(img_req.get_file_path() + img_req.get_file_name()) &&
+                FileOps::file_exists(thumb_req.get_file_path() + thumb_req.get_file_name()))
+            {
+                IMG_MAN.request_image(
+                    thumb_url,
+                    vector2d(-1, POST_IMG_H),
+                    thread->get_id(),
+                    thread->get_thread_num_str(),
+                    post_num,
+                    job_pool_id);
+            }
+
+            b_thumb_requested = true;
+        }
+
+        IMG_MAN.request_image(
+            img_url,
+            vector2d(-1, POST_IMG_H),
+            thread->get_id(),
+            thread->get_thread_num_str(),
+            post_num,
+            job_pool_id);
+    }
+
+    b_img_requested = true;
+}
+
+
 void Post4chanWidget::rebuild_vbox()
 {
     if (!main_box) return;
 
-    info_hbox = std::make_shared<HorizontalBoxWidget>(
-        vector2d(), // offset
-        vector4d(0, 0, 0, 1), // padding
-        vector4d(0, 0, 1, 0) // child padding
-    );
-    info_hbox->set_h_sizing(e_widget_sizing::ws_fill);
-    info_hbox->set_v_sizing(e_widget_sizing::ws_auto);
+    // the boxes are made once per post, after that only their
+    // children change (see load_replies and post_tree)
+    if (!info_hbox)
+    {
+        info_hbox = std::make_shared<HorizontalBoxWidget>(
+            vector2d(), // offset
+            vector4d(0, 0, 0, 1), // padding
+            vector4d(0, 0, 1, 0) // child padding
+        );
+        info_hbox->set_h_sizing(e_widget_sizing::ws_fill);
+        info_hbox->set_v_sizing(e_widget_sizing::ws_auto);
+    }
+    else
+    {
+        info_hbox->clear_children();
+    }
+
     info_hbox->add_child_widget(flag_box, false);
     info_hbox->add_child_widget(post_info_box, false);
 
-    vbox = std::make_shared<VerticalBoxWidget>();
+    if (!vbox)
+    {
+        vbox = std::make_shared<VerticalBoxWidget>();
+        main_box->set_child_widget(vbox, false /* rebuild */);
+    }
+    else
+    {
+        vbox->clear_children();
+    }
+
     vbox->add_child_widget(info_hbox, false);
     vbox->add_child_widget(img_info, false);
     vbox->add_child_widget(image_box, false);
     vbox->add_child_widget(post_text, false);
     vbox->add_child_widget(reply_div, false);
     vbox->add_child_widget(replies_text, false);
+}
+
 
-    main_box->set_child_widget(vbox, false /* rebuild */);
+bool Post4chanWidget::shows_same(const imageboard::post& a, const imageboard::post& b)
+{
+    return a.num == b.num &&
+           a.thread_num == b.thread_num &&
+           a.b_op == b.b_op &&
+           a.name == b.name &&
+           a.trip == b.trip &&
+           a.id == b.id &&
+           a.capcode == b.capcode &&
+           a.subject == b.subject &&
+           a.datetime == b.datetime &&
+           a.text == b.text &&
+           a.img_time == b.img_time &&
+           a.img_filename == b.img_filename &&
+           a.img_ext == b.img_ext &&
+           a.img_fsize == b.img_fsize &&
+           a.img_w == b.img_w &&
+           a.img_h == b.img_h &&
+           a.img_thumb_w == b.img_thumb_w &&
+           a.img_thumb_h == b.img_thumb_h &&
+           a.img_md5 == b.img_md5 &&
+           a.b_img_deleted == b.b_img_deleted &&
+           a.b_img_spoilered == b.b_img_spoilered &&
+           a.b_custom_spoiler == b.b_custom_spoiler &&
+           a.country == b.country &&
+           a.troll_country == b.troll_country &&
+           a.country_name == b.country_name;
 }
 
 
-void Post4chanWidget::parse_quotes()
+void Post4chanWidget::load_replies()
 {
-    if (!post_text || !thread)
-    {
-        return;
-    }
+    if (!main_box) return;
 
-    for (auto& word : post_text->get_term_words())
+    // the posts quoting this one have all been deleted
+    if (replies.size() < 1)
     {
-        int replied_to = post_text->parse_post_num_quote(word.text);
-        if (replied_to != -1)
+        if (replies_text)
         {
-            thread->add_reply(replied_to, post_num);
+            reply_div = nullptr;
+            replies_text = nullptr;
+            rebuild_vbox();
         }
-    }
-}
-
 
-void Post4chanWidget::load_replies()
-{
-    if (replies.size() < 1 || !main_box) return;
+        return;
+    }
 
     reply_div = std::make_shared<BoxDividerWidget>(true /* horizontal */, COLO.post_bg, COLO.post_border);
 
@@ -359,8 +743,38 @@ void Post4chanWidget::load_replies()
 }
 
 
+void Post4chanWidget::image_failed(const img_packet& pac)
+{
+    // the thumbnail only stands in until the image comes
+    if (pac.parser.pagetype == e_page_type::pt_image_thumbnail)
+        return;
+
+    bool b_flag = pac.parser.url.find("s.4cdn.org/image/country/") != std::string::npos;
+    bool b_for_good = !pac.b_retry || ++img_fails >= IMG_MAX_TRIES;
+
+    if (b_flag)
+        b_flag_failed = b_for_good;
+    else
+        b_img_failed = b_for_good;
+
+    // the thread asks for it again when the post is next near the
+    // screen, unless the other image is still on its way
+    bool b_other_pending = b_flag ?
+        !img_url.empty() && !b_img_loaded && !b_img_failed :
+        !flag_url.empty() && !b_flag_loaded && !b_flag_failed;
+    if (!b_other_pending)
+        b_img_requested = false;
+}
+
+
 bool Post4chanWidget::add_image(img_packet& pac, bool b_refresh_parent)
 {
+    if (pac.b_failed)
+    {
+        image_failed(pac);
+        return false;
+    }
+
     if (!DISPLAY_IMAGES || !thread ||
         !main_box || !vbox || pac.is_video())
         return false;
@@ -385,10 +799,18 @@ bool Post4chanWidget::add_image(img_packet& pac, bool b_refresh_parent)
 
         b_refresh_parent = false;
         b_added = true;
+        b_flag_loaded = true;
     }
     // post image
     else
     {
+        bool b_thumb =
+            pac.parser.pagetype == e_page_type::pt_image_thumbnail;
+
+        // full image beat the thumbnail to it
+        if (b_thumb && b_img_loaded)
+            return false;
+
         std::shared_ptr<ImageWidget> img = std::make_shared<ImageWidget>(
             pac,
             true, // maintain aspect ratio
@@ -420,26 +842,36 @@ bool Post4chanWidget::add_image(img_packet& pac, bool b_refresh_parent)
             b_refresh_parent = false;
         }
 
-        image_box->rebuild(false);
-        b_added = true;
-    }
+        if (b_refresh_parent)
+        {
+            // the box, the post and the boxes it's in are laid out
+            // again once, however many of the thread's images
+            // arrive before then
+            image_box->invalidate_measure();
+        }
+        else
+        {
+            image_box->rebuild(false);
+        }
 
-    if (b_refresh_parent &&
-        thread->get_posts_vbox() &&
-        thread->get_scroll_panel())
-    {
-        rebuild_vbox();
-        vbox->rebuild(false);
-        main_box->rebuild(false);
-        update_size(false /* recursive */);
-        thread->get_posts_vbox()->rebuild(false);
-        thread->get_scroll_panel()->rebuild(false);
+        b_added = true;
+        b_img_loaded = !b_thumb;
     }
 
     return b_added;
 }
 
 
+void Post4chanWidget::arrange()
+{
+    if (!main_box || !vbox) return;
+
+    vbox->rebuild(false);
+    main_box->rebuild(false);
+    update_size(false /* recursive */);
+}
+
+
 vector2d Post4chanWidget::get_child_widget_size() const
 {
     if (child_widget)
@@ -447,6 +879,11 @@ vector2d Post4chanWidget::get_child_widget_size() const
         return child_widget->get_size();
     }
 
+    if (b_virtual)
+    {
+        return vector2d(1, estimate_height());
+    }
+
     return vector2d();
 }
 
@@ -517,7 +954,7 @@ void Post4chanWidget::receive_left_click(vector2d coord, TermWidget* clicked, Te
     TextWidget* text = dynamic_cast<TextWidget*>(clicked);
     if (text)
     {
-        std::wstring word = text->get_word_at_coord(coord);
+        std::string word = text->get_word_at_coord(coord);
         int post_num = text->parse_post_num_quote(word);
         if (post_num != -1)
         {
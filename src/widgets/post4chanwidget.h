@@ -16,6 +16,43 @@ class BoxDividerWidget;
 class VerticalBoxWidget;
 class HorizontalBoxWidget;
 class ImageWidget;
+struct text_layout;
+
+
+// the text of a post made into words, and the post text wrapped
+// into cells, which can be done off the ui thread for many posts
+// at once (see Thread4chanWidget::layout_posts)
+struct post_layout
+{
+    std::vector<term_word> info_words;
+    std::vector<term_word> img_info_words;
+    std::vector<term_word> text_words;
+    // text_words wrapped at the width of the post text, if known
+    std::shared_ptr<const text_layout> text_cells;
+};
+
+
+// the widgets of a post that has been released. the thread keeps
+// a few of them, which go back to the post, images and all, if it
+// is built again soon, or are filled in with another post's data.
+struct post_tree
+{
+    std::shared_ptr<BoxWidget> main_box;
+    std::shared_ptr<VerticalBoxWidget> vbox;
+    std::shared_ptr<HorizontalBoxWidget> info_hbox;
+    std::shared_ptr<BoxWidget> flag_box;
+    std::shared_ptr<BoxWidget> image_box;
+    std::shared_ptr<BoxWidget> post_info_box;
+    std::shared_ptr<TextWidget> post_info;
+    std::shared_ptr<TextWidget> img_info;
+    std::shared_ptr<TextWidget> post_text;
+    std::shared_ptr<BoxDividerWidget> reply_div;
+    std::shared_ptr<TextWidget> replies_text;
+    bool b_img_requested;
+    bool b_img_loaded;
+    bool b_flag_loaded;
+    bool b_thumb_requested;
+};
 
 
 class Post4chanWidget : public TermWidget
@@ -32,6 +69,8 @@ protected:
     int post_num;
     Thread4chanWidget* thread;
     imageboard::post* post_data;
+    // made ahead of time, or by rebuild if not
+    std::shared_ptr<const post_layout> layout;
 
     std::shared_ptr<BoxWidget> main_box;
     std::shared_ptr<VerticalBoxWidget> vbox;
@@ -44,11 +83,42 @@ protected:
     std::shared_ptr<TextWidget> post_text;
     std::shared_ptr<BoxDividerWidget> reply_div;
     std::shared_ptr<TextWidget> replies_text;
+    // posts quoting this one, in order (see imageboard::reply_graph)
     std::vector<int> replies;
 
+    // images aren't requested when the post is built, the
+    // thread requests them once the post comes near the screen
+    std::string img_url;
+    std::string flag_url;
+    // cached thumbnail (e.g. from the catalog) that stands in
+    // for the image until the full image has been loaded
+    std::string thumb_url;
+    bool b_img_requested;
+    bool b_img_loaded;
+    bool b_flag_loaded;
+    bool b_thumb_requested;
+    // the download failed for good, or IMG_MAX_TRIES times. these
+    // belong to the post, not its widgets, so release() keeps them
+    bool b_img_failed;
+    bool b_flag_failed;
+    int img_fails;
+    // keeps the image from being requested again if it won't come
+    void image_failed(const img_packet& pac);
+
     virtual void rebuild_vbox();
 
     bool b_selected;
+    bool b_needs_reflow;
+
+    // a virtual post has no widgets of its own yet, or has had them
+    // released, and only takes up its height in the thread. that is
+    // the height it had when it was released, or an estimate if it
+    // has never been built (see estimate_height).
+    bool b_virtual;
+    int virtual_h;
+    // the widgets the post had when it was released, while
+    // they're still in the thread's pool
+    std::weak_ptr<post_tree> released_tree;
 
 
 public:
@@ -60,17 +130,61 @@ public:
 
     bool is_op() const { return b_is_op; };
     int get_post_num() const { return post_num; };
-
-    void add_reply(int reply) { replies.push_back(reply); };
-    // searches post text for post numbers (e.g. >>9398223)
-    // and notifies thread, adding this post's id to the replies
-    // vector of the post this post is quoting
-    void parse_quotes();
+    const imageboard::post* get_post_data() const { return post_data; };
+    // points the post at its data in a newer page_data
+    void set_post_data(imageboard::post& _post_data) { post_data = &_post_data; };
+
+    // true if a post built from a looks the same as one built from b.
+    // compares every post field a post widget could show, not only
+    // the ones it shows now, so that showing another one later
+    // can't leave stale posts up. the thread counts are left out
+    static bool shows_same(const imageboard::post& a, const imageboard::post& b);
+
+    // lays out p's text, wrapping the post text at text_width if it
+    // is > 0. only reads p, so it can run on any thread.
+    static std::shared_ptr<const post_layout> make_layout(const imageboard::post& p, int text_width);
+    // must be set before the post is first built
+    void set_layout(std::shared_ptr<const post_layout> _layout) { layout = _layout; };
+    // width the post text was wrapped at when the post was built,
+    // 0 if the post has no text
+    int get_text_wrap_width() const;
+
+    const std::vector<int>& get_replies() const { return replies; };
+    void set_replies(const std::vector<int>& _replies) { replies = _replies; };
+    // (re)builds the list of replies below the post text
     void load_replies();
 
+    // the post was built at another width and is
+    // rebuilt when it comes near the screen
+    void set_needs_reflow() { b_needs_reflow = true; };
+    bool needs_reflow() const { return b_needs_reflow; };
+
+    // rebuild() leaves a virtual post unbuilt
+    void set_virtual(bool b_set) { b_virtual = b_set; };
+    bool is_virtual() const { return b_virtual; };
+    // builds a virtual post along with its replies
+    void materialize();
+    // drops the widgets of the post, which keeps its height
+    // and is built again by materialize(). the widgets go to
+    // the thread's pool (see post_tree)
+    void release();
+    // rows the post is expected to take up once built, from its
+    // text layout if it has one
+    int estimate_height() const;
+
     virtual bool add_image(img_packet& pac, bool b_refresh_parent = true);
 
+    // true if the post has images that haven't been loaded yet
+    bool has_unloaded_images() const;
+    bool images_requested() const { return b_img_requested; };
+    void request_images(const std::string& job_pool_id);
+    // must be called after the jobs of the images'
+    // job pool have been killed, so that the images
+    // are requested again the next time
+    void cancel_image_requests() { b_img_requested = false; };
+
     virtual void rebuild(bool b_rebuild_children = true) override;
+    virtual void arrange() override;
 
     virtual vector2d get_child_widget_size() const override;
     virtual void update_child_size(bool b_recursive = false) override;
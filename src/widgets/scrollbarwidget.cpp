@@ -28,6 +28,8 @@ void ScrollBarWidget::rebuild(bool b_rebuild_children)
         return;
     }
 
+    invalidate_paint();
+
     // offset on screen, minus panel's offset as it is the
     // offset used to scroll the panel off screen
     vector2d p_offset = parent_panel->get_absolute_offset() - parent_panel->get_offset();
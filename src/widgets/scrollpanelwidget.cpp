@@ -35,40 +35,15 @@ bool ScrollPanelWidget::handle_key_input(const tb_event& input_event, bool b_bub
 
     if (b_allow_vert_scroll)
     {
-        switch(input_event.key)
+        int dist = get_scroll_dist(input_event);
+        if (dist != 0)
         {
-            case TB_KEY_ARROW_DOWN          :   scroll(-1);
-                                                b_handled = true;
-                                                break;
-
-            case TB_KEY_MOUSE_WHEEL_DOWN    :   scroll(-1);
-                                                b_handled = true;
-                                                break;
-
-            case TB_KEY_ARROW_UP            :   scroll(1);
-                                                b_handled = true;
-                                                break;
-
-            case TB_KEY_MOUSE_WHEEL_UP      :   scroll(1);
-                                                b_handled = true;
-                                                break;
-
-            case TB_KEY_PGUP                :   scroll(get_visible_height());
-                                                b_handled = true;
-                                                break;
-
-            case TB_KEY_ARROW_LEFT          :   scroll(get_visible_height());
-                                                b_handled = true;
-                                                break;
-
-            case TB_KEY_PGDN                :   scroll(-get_visible_height());
-                                                b_handled = true;
-                                                break;
-
-            case TB_KEY_ARROW_RIGHT         :   scroll(-get_visible_height());
-                                                b_handled = true;
-                                                break;
+            scroll(dist);
+            b_handled = true;
+        }
 
+        switch(input_event.key)
+        {
             case TB_KEY_HOME                :   scroll_to_beginning();
                                                 b_handled = true;
                                                 break;
@@ -100,6 +75,7 @@ bool ScrollPanelWidget::handle_key_input(const tb_event& input_event, bool b_bub
     if (b_handled)
     {
         // redraw
+        invalidate_paint();
         WIDGET_MAN.draw_widgets();
     }
 
@@ -107,6 +83,29 @@ bool ScrollPanelWidget::handle_key_input(const tb_event& input_event, bool b_bub
 }
 
 
+int ScrollPanelWidget::get_scroll_dist(const tb_event& input_event)
+{
+    if (!b_allow_vert_scroll) return 0;
+
+    switch(input_event.key)
+    {
+        case TB_KEY_ARROW_DOWN          :
+        case TB_KEY_MOUSE_WHEEL_DOWN    :   return -1;
+
+        case TB_KEY_ARROW_UP            :
+        case TB_KEY_MOUSE_WHEEL_UP      :   return 1;
+
+        case TB_KEY_PGUP                :
+        case TB_KEY_ARROW_LEFT          :   return get_visible_height();
+
+        case TB_KEY_PGDN                :
+        case TB_KEY_ARROW_RIGHT         :   return -get_visible_height();
+    }
+
+    return 0;
+}
+
+
 void ScrollPanelWidget::update_scroll_bar()
 {
     if (b_has_scrollbar && scroll_bar_widget)
@@ -121,6 +120,7 @@ void ScrollPanelWidget::scroll(int dist)
     offset.y += dist;
     scroll_pos_sanity_check();
     update_scroll_bar();
+    invalidate_paint();
 }
 
 
@@ -129,6 +129,7 @@ void ScrollPanelWidget::scroll_to(int pos)
     offset.y = pos;
     scroll_pos_sanity_check();
     update_scroll_bar();
+    invalidate_paint();
 }
 
 
@@ -137,6 +138,7 @@ void ScrollPanelWidget::scroll_to_end()
     vector4d pad = get_padding();
     offset.y = -(size.y - get_visible_height() + pad.b + pad.d);
     update_scroll_bar();
+    invalidate_paint();
 }
 
 
@@ -144,6 +146,7 @@ void ScrollPanelWidget::scroll_to_beginning()
 {
     offset.y = 0;
     update_scroll_bar();
+    invalidate_paint();
 }
 
 
@@ -217,6 +220,7 @@ int ScrollPanelWidget::get_visible_width()
 
 void ScrollPanelWidget::scroll_pos_sanity_check()
 {
+    int scroll_pos = offset.y;
     vector4d pad = get_padding();
     int vis_h = get_visible_height();
     vector2d c_size = get_child_widget_size();
@@ -235,6 +239,11 @@ void ScrollPanelWidget::scroll_pos_sanity_check()
     {
         offset.y = -(size.y - get_visible_height() + pad.b + pad.d);
     }
+
+    if (offset.y != scroll_pos)
+    {
+        flag_paint();
+    }
 }
 
 
@@ -38,13 +38,16 @@ public:
     void scroll_to(int pos);
     void scroll_to_end();
     void scroll_to_beginning();
+    // rows input_event scrolls the panel by, 0 if it doesn't
+    // scroll it by some rows (e.g. home and end)
+    int get_scroll_dist(const tb_event& input_event);
 
     // the dimensions of the panel that are visible in term
     int get_visible_height();
     int get_visible_width();
 
     vector2d get_scroll_position() const { return offset; };
-    void set_scroll_position(vector2d pos) { offset = pos; };
+    void set_scroll_position(vector2d pos) { offset = pos; invalidate_paint(); };
 
     virtual bool handle_key_input(const tb_event& input_event, bool b_bubble_up = true) override;
 
@@ -0,0 +1,257 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#include "searchwidget.h"
+#include "widgets.h"
+#include "../widgetman.h"
+#include "../stringutils.h"
+
+
+SearchWidget::SearchWidget()
+: TermWidget(vector2d(), vector4d(), vector4d(), COLO.post_bg, COLO.post_text, true)
+{
+    set_id("SEARCH");
+    title = "Search";
+
+    set_can_switch_to(true);
+    set_draw_img_buffer(false);
+    set_remove_img_artifacts_on_draw(true);
+
+    set_h_sizing(ws_fullscreen);
+    set_v_sizing(ws_fullscreen);
+
+    // only to pick up posts indexed while the page is open
+    b_ticks = true;
+    set_tick_rate(250);
+
+    search_time = std::chrono::microseconds(0);
+    index_generation = SEARCH_INDEX.get_generation();
+}
+
+
+void SearchWidget::tick_event(std::chrono::milliseconds /* delta */)
+{
+    if (!query.empty() && index_generation != SEARCH_INDEX.get_generation())
+    {
+        run_search();
+        show_results();
+    }
+}
+
+
+void SearchWidget::run_search()
+{
+    index_generation = SEARCH_INDEX.get_generation();
+
+    std::chrono::microseconds start = time_now_us();
+    hits = SEARCH_INDEX.search(query);
+    search_time = time_now_us() - start;
+}
+
+
+void SearchWidget::show_results()
+{
+    int sel = results_sel ? results_sel->get_selection() : 0;
+    results_sel = nullptr;
+    rebuild();
+
+    if (results_sel && sel > 0)
+    {
+        results_sel->set_selection(sel);
+        results_sel->rebuild(true);
+    }
+
+    WIDGET_MAN.draw_widgets(this);
+}
+
+
+void SearchWidget::rebuild(bool /* b_rebuild_children */)
+{
+    update_size(false /* recursive */);
+
+    query_text = std::make_shared<TextWidget>(
+        vector2d(),
+        vector4d(1, 0, 1, 0),
+        COLO.title_bg,
+        COLO.title_fg);
+    query_text->append_raw_text("Search: ", false, true);
+    // cursor
+    query_text->append_raw_text(query + "_", false);
+
+    std::string status;
+    if (!query.empty())
+    {
+        status += std::to_string(hits.size()) + " posts in ";
+        char ms[16];
+        snprintf(ms, sizeof(ms), "%.2f", search_time.count() / 1000.0f);
+        status += std::string(ms) + " ms, ";
+    }
+    status += std::to_string(SEARCH_INDEX.num_posts()) + " posts indexed";
+
+    status_text = std::make_shared<TextWidget>(
+        vector2d(),
+        vector4d(1, 0, 1, 1),
+        COLO.post_bg,
+        COLO.post_text);
+    status_text->append_raw_text(status, false);
+
+    content_box = std::make_shared<BoxWidget>(
+        vector2d(),
+        vector4d(),
+        vector2d(),
+        COLO.post_bg,
+        COLO.post_border);
+    content_box->set_h_sizing(e_widget_sizing::ws_fill);
+    content_box->set_v_sizing(e_widget_sizing::ws_fill);
+    content_box->set_child_padding(vector4d());
+    content_box->set_draw_border(false);
+
+    if (!hits.empty())
+    {
+        results_sel = std::make_shared<SelectionWidget>();
+        results_sel->set_draw_border(false);
+        results_sel->set_h_sizing(ws_fill);
+        results_sel->set_v_align(wa_top);
+
+        for (auto& hit : hits)
+        {
+            // the excerpt is plain text, keep it from
+            // being read as markup when it's shown
+            std::string item = "/" + hit.board + "/" + std::to_string(hit.thread_num);
+            item += " >>" + std::to_string(hit.post_num) + "  ";
+            for (char c : hit.excerpt)
+            {
+                if (c == '&') item += "&amp;";
+                else if (c == '<') item += "&lt;";
+                else item += c;
+            }
+
+            results_sel->add_selection(
+                item,
+                std::bind(WIDGET_MAN.open_thread, hit.thread_url, true, nullptr, nullptr, hit.post_num));
+        }
+
+        content_box->set_child_widget(results_sel, false);
+    }
+    else if (!query.empty())
+    {
+        auto none_text = std::make_shared<TextWidget>(
+            vector2d(),
+            vector4d(1, 0, 1, 0),
+            COLO.post_bg,
+            COLO.post_text);
+        none_text->append_raw_text("No results", false);
+        content_box->set_child_widget(none_text, false);
+    }
+
+    vbox = std::make_shared<VerticalBoxWidget>();
+    vbox->add_child_widget(query_text, false);
+    vbox->add_child_widget(status_text, false);
+    vbox->add_child_widget(content_box, false);
+
+    main_box = std::make_shared<BoxWidget>(
+        vector2d(),
+        vector4d(),
+        vector2d(),
+        COLO.post_bg,
+        COLO.post_border);
+    main_box->set_h_sizing(e_widget_sizing::ws_fill);
+    main_box->set_v_sizing(e_widget_sizing::ws_fill);
+    main_box->set_child_padding(vector4d());
+    main_box->set_draw_border(false);
+    main_box->set_child_widget(vbox);
+
+    set_child_widget(main_box, false);
+    main_box->rebuild(true);
+}
+
+
+bool SearchWidget::handle_key_input(const tb_event& input_event, bool /* b_bubble_up */)
+{
+    bool b_handled = false;
+    bool b_query_changed = false;
+
+    if (input_event.key == 0 && input_event.ch != 0)
+    {
+        utf8_encode(input_event.ch, query);
+        b_query_changed = true;
+    }
+    else if (input_event.key == TB_KEY_SPACE)
+    {
+        query += ' ';
+        b_query_changed = true;
+    }
+    else if (input_event.key == TB_KEY_BACKSPACE ||
+             input_event.key == TB_KEY_BACKSPACE2 ||
+             input_event.key == TB_KEY_CTRL_8 ||
+             input_event.key == TB_KEY_CTRL_H)
+    {
+        // remove the last character, not just its last byte
+        while (!query.empty() && ((unsigned char)query.back() & 0xC0) == 0x80)
+        {
+            query.pop_back();
+        }
+        if (!query.empty())
+        {
+            query.pop_back();
+        }
+        b_query_changed = true;
+    }
+    else if (input_event.key == TB_KEY_TAB)
+    {
+        WIDGET_MAN.open_switch_widget();
+        b_handled = true;
+    }
+    else if (input_event.key == TB_KEY_ESC ||
+             input_event.key == TB_KEY_CTRL_X)
+    {
+        delete_self();
+        return true;
+    }
+    else if (results_sel)
+    {
+        b_handled = results_sel->handle_key_input(input_event, false);
+    }
+
+    if (b_query_changed)
+    {
+        run_search();
+        results_sel = nullptr;
+        rebuild();
+        WIDGET_MAN.draw_widgets(this);
+        b_handled = true;
+    }
+
+    return b_handled;
+}
+
+
+void SearchWidget::handle_term_resize_event()
+{
+    show_results();
+}
+
+
+vector2d SearchWidget::get_child_widget_size() const
+{
+    if (child_widget)
+    {
+        return child_widget->get_size();
+    }
+
+    return vector2d();
+}
+
+
+void SearchWidget::update_child_size(bool b_recursive)
+{
+    if (child_widget)
+    {
+        child_widget->update_size(b_recursive);
+    }
+}
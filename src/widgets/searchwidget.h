@@ -0,0 +1,62 @@
+/**
+ * Comfy
+ *
+ *  Copyright 2019 by Wolfish <wolfish@airmail.cc>
+ *  https://wolfish.neocities.org/soft/comfy/
+ *
+ *  Licensed under the GPL v2.0 only.
+ */
+#pragma once
+#include "termwidget.h"
+#include "../searchindex.h"
+
+class BoxWidget;
+class VerticalBoxWidget;
+class TextWidget;
+class SelectionWidget;
+
+
+// full screen page for searching the posts in SEARCH_INDEX.
+// the results follow the query as it's typed, choosing
+// one opens its thread and scrolls to the post.
+class SearchWidget : public TermWidget
+{
+
+public:
+
+    SearchWidget();
+
+
+protected:
+
+    std::string query;
+    std::vector<search_hit> hits;
+    // how long the last search took
+    std::chrono::microseconds search_time;
+    // of the index when the last search was run
+    uint32_t index_generation;
+
+    std::shared_ptr<BoxWidget> main_box;
+    std::shared_ptr<VerticalBoxWidget> vbox;
+    std::shared_ptr<TextWidget> query_text;
+    std::shared_ptr<TextWidget> status_text;
+    std::shared_ptr<BoxWidget> content_box;
+    std::shared_ptr<SelectionWidget> results_sel;
+
+    void run_search();
+    // rebuilds and draws the page with the current hits
+    void show_results();
+
+
+public:
+
+    virtual void tick_event(std::chrono::milliseconds delta) override;
+
+    virtual void rebuild(bool b_rebuild_children = true) override;
+    virtual void handle_term_resize_event() override;
+    virtual bool handle_key_input(const tb_event& input_event, bool b_bubble_up = true) override;
+
+    virtual vector2d get_child_widget_size() const override;
+    virtual void update_child_size(bool b_recursive = false) override;
+
+};
@@ -28,6 +28,11 @@ TermWidget::TermWidget(vector2d _offset, vector4d _padding, vector4d _child_padd
 , fg_color(_fg_color)
 , b_hidden(false)
 , b_ticks(false)
+, b_needs_measure(false)
+, b_needs_arrange(false)
+, b_needs_paint(false)
+, b_paint_dirty(false)
+, b_painted(false)
 {
     if (b_fullscreen)
     {
@@ -84,10 +89,28 @@ void TermWidget::set_parent_widget(TermWidget* _parent_widget)
     if (_parent_widget && !_parent_widget->is_child_of(this))
     {
         parent_widget = _parent_widget;
+
+        // keep the new ancestors flagged
+        // if the widget is waiting on layout
+        if (needs_layout())
+        {
+            parent_widget->invalidate_arrange();
+        }
+        else if (b_needs_paint)
+        {
+            parent_widget->flag_paint();
+        }
     }
     else if (!_parent_widget)
     {
         parent_widget = nullptr;
+
+        // what's under it is drawn again
+        if (b_painted)
+        {
+            WIDGET_MAN.damage_rows(painted_rows.x, painted_rows.y);
+            b_painted = false;
+        }
     }
 }
 
@@ -316,6 +339,12 @@ void TermWidget::set_child_widget(std::shared_ptr<TermWidget> _child_widget, boo
     }
     else if (!_child_widget)
     {
+        // the old child can outlive this widget (see post_tree)
+        if (child_widget && child_widget->get_parent_widget() == this)
+        {
+            child_widget->set_parent_widget(nullptr);
+        }
+
         child_widget = nullptr;
     }
 
@@ -402,6 +431,7 @@ void TermWidget::set_size(int w, int h)
 
     if (size != size_cache)
     {
+        flag_paint();
         size_change_event();
     }
 }
@@ -413,6 +443,151 @@ void TermWidget::set_size(vector2d _size)
 }
 
 
+void TermWidget::invalidate_measure()
+{
+    b_needs_measure = true;
+    b_needs_paint = true;
+
+    if (parent_widget)
+    {
+        parent_widget->invalidate_arrange();
+    }
+}
+
+
+void TermWidget::invalidate_arrange()
+{
+    // the ancestors of a flagged widget are flagged already
+    if (b_needs_arrange && b_needs_paint) return;
+
+    b_needs_arrange = true;
+    b_needs_paint = true;
+
+    // the widget's size can follow its children's
+    if (parent_widget)
+    {
+        parent_widget->invalidate_arrange();
+    }
+}
+
+
+void TermWidget::invalidate_paint()
+{
+    b_paint_dirty = true;
+    flag_paint();
+}
+
+
+void TermWidget::flag_paint()
+{
+    if (b_needs_paint) return;
+
+    b_needs_paint = true;
+
+    if (parent_widget)
+    {
+        parent_widget->flag_paint();
+    }
+}
+
+
+void TermWidget::set_hidden(bool _b_hidden)
+{
+    if (b_hidden == _b_hidden) return;
+
+    b_hidden = _b_hidden;
+    invalidate_paint();
+}
+
+
+void TermWidget::update_layout()
+{
+    if (!b_needs_measure && !b_needs_arrange) return;
+
+    // cleared first, so a widget invalidated again
+    // while this is done is laid out next time
+    bool b_measure = b_needs_measure;
+    b_needs_measure = false;
+    b_needs_arrange = false;
+
+    for_each_child([](TermWidget* child) {
+        child->update_layout();
+    });
+
+    if (b_measure)
+    {
+        update_size(false);
+        rebuild(false);
+    }
+    else
+    {
+        arrange();
+    }
+}
+
+
+void TermWidget::collect_damage()
+{
+    // not on the terminal, and nothing under it changed
+    if (!b_needs_paint && !b_painted) return;
+
+    vector2d absolute_offset = get_absolute_offset();
+
+    // all of the widget is drawn again
+    if (b_hidden || b_paint_dirty || !b_painted ||
+        absolute_offset != painted_offset || size != painted_size)
+    {
+        if (b_painted)
+        {
+            WIDGET_MAN.damage_rows(painted_rows.x, painted_rows.y);
+            b_painted = false;
+        }
+
+        if (!b_hidden)
+        {
+            // clipped like it was the last time it was drawn
+            vector4d constraint = last_constraint;
+            if (constraint.c == -1) constraint.c = 0;
+            if (constraint.d == -1) constraint.d = term_h();
+
+            vector2d rows = rows_on_screen(absolute_offset, constraint);
+            WIDGET_MAN.damage_rows(rows.x, rows.y);
+        }
+
+        return;
+    }
+
+    if (b_needs_paint)
+    {
+        for_each_child([](TermWidget* child) {
+            child->collect_damage();
+        });
+    }
+}
+
+
+void TermWidget::paint_done()
+{
+    if (!b_needs_paint) return;
+
+    b_needs_paint = false;
+    b_paint_dirty = false;
+
+    for_each_child([](TermWidget* child) {
+        child->paint_done();
+    });
+}
+
+
+void TermWidget::for_each_child(const std::function<void(TermWidget*)>& fn)
+{
+    if (child_widget)
+    {
+        fn(child_widget.get());
+    }
+}
+
+
 void TermWidget::refresh(bool b_draw_term)
 {
     rebuild(true);
@@ -506,6 +681,26 @@ vector2d TermWidget::get_absolute_offset() const
 }
 
 
+void TermWidget::set_offset(vector2d _offset)
+{
+    if (offset != _offset)
+    {
+        offset = _offset;
+        flag_paint();
+    }
+}
+
+
+void TermWidget::set_inherited_offset(vector2d _offset)
+{
+    if (inherited_offset != _offset)
+    {
+        inherited_offset = _offset;
+        flag_paint();
+    }
+}
+
+
 vector4d TermWidget::get_padding() const
 {
     return default_padding + inherited_padding;
@@ -514,19 +709,23 @@ vector4d TermWidget::get_padding() const
 
 void TermWidget::add_inherited_padding(vector4d pad)
 {
-    inherited_padding += pad;
+    set_inherited_padding(inherited_padding + pad);
 }
 
 
 void TermWidget::set_inherited_padding(vector4d pad)
 {
-    inherited_padding = pad;
+    if (inherited_padding != pad)
+    {
+        inherited_padding = pad;
+        flag_paint();
+    }
 }
 
 
 void TermWidget::clear_inherited_padding()
 {
-    inherited_padding = vector4d();
+    set_inherited_padding(vector4d());
 }
 
 
@@ -566,32 +765,34 @@ void TermWidget::draw(vector4d constraint, bool b_draw_children) const
     last_constraint = cons;
 
     vector2d absolute_offset = get_absolute_offset();
-    term_cell cell;
+    if (paint_is_current(absolute_offset, rows_on_screen(absolute_offset, constraint)))
+    {
+        return;
+    }
 
-    // only draw cells that are visible
-    for (int y = constraint.c; y < constraint.d; ++y)
+    // only draw cells that are visible, copying each
+    // row's visible columns to the frame in one go
+    int y_start = std::max(constraint.c, absolute_offset.y);
+    int y_end = std::min(constraint.d, absolute_offset.y + (int)cells.size());
+    for (int y = y_start; y < y_end; ++y)
     {
-        int cell_row = -absolute_offset.y + y;
-        if (cell_row < cells.size())
+        // the other rows are still on the terminal
+        if (!WIDGET_MAN.row_damaged(y)) continue;
+
+        const std::vector<tb_cell>& row = cells[y - absolute_offset.y];
+        int x_start = std::max(constraint.a, absolute_offset.x);
+        int x_end = std::min(constraint.b, absolute_offset.x + (int)row.size());
+        if (x_end <= x_start) continue;
+
+        WIDGET_MAN.blit_to_frame(x_start, y, &row[x_start - absolute_offset.x], x_end - x_start);
+
+        // optionally blast out image artifacts
+        // where widget will be drawn
+        if (b_remove_img_artifacts_on_draw)
         {
-            const std::vector<tb_cell>& row = cells[cell_row];
-            for (int x = constraint.a; x < constraint.b; ++x)
+            for (int x = x_start; x < x_end; ++x)
             {
-                int cell_col = -absolute_offset.x + x;
-                if (cell_col < row.size())
-                {
-                    cell.tb_data = row[cell_col];
-                    cell.coord.x = x;
-                    cell.coord.y = y;
-                    WIDGET_MAN.add_cell_to_frame(cell);
-
-                    // optionally blast out image artifacts
-                    // where widget will be drawn
-                    if (b_remove_img_artifacts_on_draw)
-                    {
-                        WIDGET_MAN.remove_image_artifact(cell.coord);
-                    }
-                }
+                WIDGET_MAN.remove_image_artifact(vector2d(x, y));
             }
         }
     }
@@ -600,6 +801,42 @@ void TermWidget::draw(vector4d constraint, bool b_draw_children) const
 }
 
 
+vector2d TermWidget::rows_on_screen(vector2d absolute_offset, vector4d constraint) const
+{
+    int h = std::max(size.y, (int)cells.size());
+    int top = std::max(std::max(constraint.c, absolute_offset.y), 0);
+    int bottom = std::min(std::min(constraint.d, absolute_offset.y + h), term_h());
+
+    return vector2d(top, std::max(top, bottom));
+}
+
+
+bool TermWidget::paint_is_current(vector2d absolute_offset, vector2d rows) const
+{
+    e_paint_pass pass = WIDGET_MAN.get_paint_pass();
+
+    // drawn outside of a frame, which isn't what's on the terminal
+    if (pass == e_paint_pass::pp_none) return false;
+
+    // widgets without a parent (e.g. the focused one) are always
+    // drawn, as the rows their children cover can go past their own
+    if (pass == e_paint_pass::pp_damage && parent_widget &&
+        !b_needs_paint && b_painted &&
+        painted_offset == absolute_offset && painted_size == size &&
+        painted_rows == rows && !WIDGET_MAN.is_damaged(rows.x, rows.y))
+    {
+        return true;
+    }
+
+    b_painted = rows.y > rows.x;
+    painted_offset = absolute_offset;
+    painted_size = size;
+    painted_rows = rows;
+
+    return false;
+}
+
+
 void TermWidget::draw_children(vector4d constraint) const
 {
     if (child_widget)
@@ -8,6 +8,7 @@
  */
 #pragma once
 #include "../comfy.h"
+#include <functional>
 
 struct http_image_req;
 struct img_packet;
@@ -105,6 +106,36 @@ protected:
     // whether or not widget should appear in switch widget selection list
     bool b_can_switch_to;
 
+    // what has to be redone before the widget is next drawn. set by
+    // the invalidate functions, which flag the ancestors too, so that
+    // update_layout() only goes down into the subtrees that changed.
+    //
+    // measure: the widget's own content or constraints changed
+    // arrange: a child changed size, the children are placed again
+    // paint: the widget, or one under it, has to be drawn again
+    bool b_needs_measure;
+    bool b_needs_arrange;
+    bool b_needs_paint;
+    // the widget's own cells changed, not only something under it
+    bool b_paint_dirty;
+
+    // where the widget was last drawn to the terminal, and the rows
+    // of it that were on screen (top, and bottom exclusive). frames
+    // skip widgets that would be drawn the same way again, and
+    // redraw the rows a widget covered when it moves or goes away
+    mutable bool b_painted;
+    mutable vector2d painted_offset;
+    mutable vector2d painted_size;
+    mutable vector2d painted_rows;
+
+    // flags the widget and its ancestors as needing painting
+    void flag_paint();
+    // rows of the terminal the widget covers within constraint
+    vector2d rows_on_screen(vector2d absolute_offset, vector4d constraint) const;
+    // true if the widget is on the terminal as it would be drawn now,
+    // so drawing it can be skipped. otherwise records it as painted
+    bool paint_is_current(vector2d absolute_offset, vector2d rows) const;
+
 
 public:
 
@@ -197,13 +228,15 @@ public:
     virtual vector4d get_child_widget_padding() const;
     virtual void update_child_size(bool b_recursive = false) {};
 
-    void set_offset(vector2d _offset) { offset = _offset; };
+    // moving a widget flags it, so the next frame
+    // draws the rows it leaves and the rows it moves to
+    void set_offset(vector2d _offset);
     vector2d get_offset() const { return offset; };
-    void add_offset(vector2d add) { offset += add; };
+    void add_offset(vector2d add) { set_offset(offset + add); };
 
-    void set_inherited_offset(vector2d _offset) { inherited_offset = _offset; };
+    void set_inherited_offset(vector2d _offset);
     vector2d get_inherited_offset() const { return inherited_offset; };
-    void add_inherited_offset(vector2d add) { inherited_offset += add; };
+    void add_inherited_offset(vector2d add) { set_inherited_offset(inherited_offset + add); };
 
     // returns absolute position relative to terminal
     vector2d get_absolute_offset() const;
@@ -214,6 +247,26 @@ public:
     vector4d get_inherited_padding() const { return inherited_padding; };
     void clear_inherited_padding();
 
+    void invalidate_measure();
+    void invalidate_arrange();
+    // rebuild() calls this when the widget has cells of its own, as
+    // frames only draw the rows of the widgets that need painting
+    void invalidate_paint();
+    bool needs_layout() const { return b_needs_measure || b_needs_arrange; };
+    bool needs_paint() const { return b_needs_paint; };
+    // lays out the invalidated widgets under this one,
+    // children before their parents
+    void update_layout();
+    // damages the rows of the widgets under this one that need
+    // painting, or have moved or been hidden since they were drawn
+    void collect_damage();
+    // clears the paint flags once the widget has been drawn
+    void paint_done();
+    // places the children again after one of them changed
+    // size, without rebuilding them
+    virtual void arrange() { rebuild(false); };
+    virtual void for_each_child(const std::function<void(TermWidget*)>& fn);
+
     // can be used as a lighter version of rebuild
     virtual void refresh(bool b_draw_term = true);
     virtual void rebuild(bool b_rebuild_children = true) {};
@@ -230,7 +283,7 @@ public:
     // (i.e. it omits cells that are off-screen)
     virtual vector2d size_on_screen() const;
     
-    void set_hidden(bool _b_hidden) { b_hidden = _b_hidden; };
+    void set_hidden(bool _b_hidden);
     bool hidden() const { return b_hidden; };
     void hide() { set_hidden(true); };
     void show() { set_hidden(false); };
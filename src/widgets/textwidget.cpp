@@ -18,183 +18,321 @@ TextWidget::TextWidget(vector2d _offset, vector4d _padding, uint32_t _bg_color,
     set_h_sizing(e_widget_sizing::ws_fill);
     set_v_sizing(e_widget_sizing::ws_dynamic);
     b_parse_4chan = false;
+    b_parse_html = false;
     widest_row = 0;
     cell_index = 0;
+    wrap_width = 0;
+    layout = nullptr;
+    b_cells_from_layout = false;
+    b_cells_cacheable = false;
 }
 
 
 void TextWidget::override_format(int index, uint32_t bg, uint32_t fg, bool b_bold, bool b_underline, bool b_reverse)
 {
-    format_override[index] =
-        term_word(L"", bg, fg, b_bold, b_underline, b_reverse);
+    style_run run(index, 1, bg, fg, make_attrs(b_bold, b_underline, b_reverse));
+
+    auto it = std::lower_bound(
+        style_overrides.begin(),
+        style_overrides.end(),
+        index,
+        [](const style_run& r, int i) {
+            return r.end() <= i;
+        });
+
+    // cells of a run are only ever overridden one at a time,
+    // so a run that has index is the one at index
+    if (it != style_overrides.end() && it->start == index)
+    {
+        *it = run;
+    }
+    else
+    {
+        style_overrides.insert(it, run);
+    }
+
+    // was made without it
+    set_layout(nullptr);
 }
 
 
-// returns true if max height has been reached
-bool TextWidget::push_row(std::vector<tb_cell>& row)
+void TextWidget::set_layout(std::shared_ptr<const text_layout> _layout)
 {
-    // do not exceed maximum height, if v sizing is not dynamic
-    if (get_v_sizing() == ws_fixed ||
-        get_v_sizing() == ws_fill ||
-        get_v_sizing() == ws_fill_managed)
+    layout = _layout;
+    b_cells_from_layout = false;
+
+    // the words have changed
+    width_cache.clear();
+    b_cells_cacheable = false;
+}
+
+
+void TextWidget::cache_cells()
+{
+    // the layout they were copied from is still around
+    if (!b_cells_cacheable || b_cells_from_layout)
+    {
+        return;
+    }
+
+    if (width_cache.size() >= WIDTH_CACHE_SIZE)
+    {
+        width_cache.erase(width_cache.begin());
+    }
+
+    width_cache.emplace_back();
+    text_layout& cached = width_cache.back();
+    cached.width = wrap_width;
+    cached.cells = std::move(cells);
+    cached.widest_row = widest_row;
+    cached.cell_index = cell_index;
+    cells.clear();
+    b_cells_cacheable = false;
+}
+
+
+bool TextWidget::uncache_cells(int width)
+{
+    for (auto it = width_cache.begin(); it != width_cache.end(); ++it)
     {
-        int max_height = get_height_constraint();
-        if (cells.size() + 1 > max_height)
+        if (it->width == width)
         {
+            cells = std::move(it->cells);
+            widest_row = it->widest_row;
+            cell_index = it->cell_index;
+            width_cache.erase(it);
+            b_cells_from_layout = false;
+            b_cells_cacheable = true;
             return true;
         }
     }
 
-    cells.push_back(row);
-    if (row.size() > widest_row)
+    return false;
+}
+
+
+// returns true if max height has been reached
+bool TextWidget::push_row(text_layout& out, std::vector<tb_cell>& row, int max_height)
+{
+    // do not exceed maximum height, if v sizing is not dynamic
+    if (max_height > -1 && out.cells.size() + 1 > max_height)
     {
-        widest_row = row.size();
+        return true;
     }
+
+    if (row.size() > out.widest_row)
+    {
+        out.widest_row = row.size();
+    }
+    out.cells.push_back(std::move(row));
     row.clear();
 
     return false;
 }
 
 
-void TextWidget::make_cells(std::vector<tb_cell>& row, term_word& word)
+void TextWidget::make_cells(text_layout& out, std::vector<tb_cell>& row, const term_word& word, int max_height, const std::vector<style_run>& style_overrides, size_t& next_override)
 {
     if (word.b_newline)
     {
-        push_row(row);
+        push_row(out, row, max_height);
+        return;
     }
-    else
+
+    tb_cell word_cell;
+    word_cell.bg = word.bg;
+    word_cell.fg = word.fg | word.attrs;
+
+    const std::string& text = word.text;
+    size_t i = 0;
+    while (i < text.length())
     {
-        for (auto& ch : word.text)
+        uint32_t ch = utf8_decode(text.data(), text.length(), i);
+        int width = char_width(ch);
+
+        // termbox can't draw it over the char before it
+        if (width == 0)
         {
-            tb_cell cell;
-            cell.ch = ch;
-            bool b_bold = false;
-            bool b_underline = false;
-            bool b_reverse = false;
-            
-            try
-            {
-                term_word& fw = format_override.at(cell_index);
-                cell.bg = fw.bg;
-                cell.fg = fw.fg;
-                b_bold = fw.b_bold;
-                b_underline = fw.b_underline;
-                b_reverse = fw.b_reverse;
-            }
-            catch (const std::out_of_range& oor)
-            {
-                cell.bg = word.bg;
-                cell.fg = word.fg;
-                b_bold = word.b_bold;
-                b_underline = word.b_underline;
-                b_reverse = word.b_reverse;
-            }
+            continue;
+        }
 
-            if (b_bold)
-            {
-                cell.fg = cell.fg | TB_BOLD;
-            }
+        tb_cell cell = word_cell;
+        cell.ch = ch;
 
-            if (b_underline)
+        if (next_override < style_overrides.size())
+        {
+            while (next_override < style_overrides.size() &&
+                   style_overrides[next_override].end() <= out.cell_index)
             {
-                cell.fg = cell.fg | TB_UNDERLINE;
+                next_override++;
             }
 
-            if (b_reverse)
+            if (next_override < style_overrides.size() &&
+                style_overrides[next_override].start <= out.cell_index)
             {
-                cell.fg = cell.fg | TB_REVERSE;
+                const style_run& run = style_overrides[next_override];
+                cell.bg = run.bg;
+                cell.fg = run.fg | run.attrs;
             }
+        }
+
+        row.push_back(cell);
 
+        // wide chars are drawn over the next cell too,
+        // which termbox skips
+        if (width == 2)
+        {
+            cell.ch = ' ';
             row.push_back(cell);
-            cell_index++;
         }
+
+        out.cell_index++;
     }
 }
 
 
-void TextWidget::rebuild(bool b_rebuild_children)
+void TextWidget::wrap_words(const std::vector<term_word>& words, int max_width, int max_height, const std::vector<style_run>& style_overrides, text_layout& out)
 {
-    cells.clear();
-    widest_row = 0;
-    cell_index = 0;
-
-    // h_sizing of auto: no width limit
-    int max_width = std::numeric_limits<int>::max() - 1;
-    if (get_h_sizing() == ws_fixed)
-    {
-        max_width = size.x;
-    }
-    else if (get_h_sizing() == ws_fullscreen)
-    {
-        max_width = term_w();
-    }
-    else if (get_h_sizing() == ws_fill || get_h_sizing() == ws_dynamic)
-    {
-        // set to fill so that size of parent is used for max width
-        set_h_sizing(e_widget_sizing::ws_fill);
-        update_size();
-        max_width = size.x;
-    }
+    out.width = max_width;
+    out.cells.clear();
+    out.widest_row = 0;
+    out.cell_index = 0;
 
     std::vector<tb_cell> row;
+    size_t next_override = 0;
 
-    for (auto& word : term_words)
+    for (auto& word : words)
     {
+        // columns, not chars
+        int word_width = utf8_width(word.text);
         int space = 0;
         if (row.size() > 0) space = 1;
         // start new row if:
         //      row is not empty and word is not longer than max row width
         //      and
         //      word + row would exceed max row width
-        if (!(space == 0 && word.text.length() > max_width) &&
-            row.size() + space + word.text.length() > max_width)
+        if (!(space == 0 && word_width > max_width) &&
+            row.size() + space + word_width > max_width)
         {
-            if (push_row(row)) goto end;
+            if (push_row(out, row, max_height)) return;
         }
         // space
         else if (space > 0)
         {
-            term_word w_sp(L" ", word.bg, word.fg, false, false, false);
-            make_cells(row, w_sp);
+            term_word w_sp(" ", word.bg, word.fg, false, false, false);
+            make_cells(out, row, w_sp, max_height, style_overrides, next_override);
         }
 
         // word is longer than max row width
-        if (word.text.length() > max_width)
+        if (word_width > max_width)
         {
-            std::wstring spam = word.text;
-            while(!spam.empty())
+            const std::string& text = word.text;
+            size_t start = 0;
+            while (start < text.length())
             {
-                if (spam.length() > max_width)
+                // as many chars as fit in a row, at least one
+                size_t end = start;
+                int cols = 0;
+                while (end < text.length())
                 {
-                    std::wstring chop = spam.substr(0, max_width);
-                    spam = spam.substr(max_width);
-                    term_word w = word;
-                    w.text = chop;
-                    make_cells(row, w);
+                    size_t next = end;
+                    int w = char_width(utf8_decode(text.data(), text.length(), next));
+                    if (cols > 0 && cols + w > max_width)
+                    {
+                        break;
+                    }
 
-                    if (push_row(row)) goto end;
+                    cols += w;
+                    end = next;
                 }
-                else
+
+                term_word w = word;
+                w.text = text.substr(start, end - start);
+                make_cells(out, row, w, max_height, style_overrides, next_override);
+                start = end;
+
+                if (start < text.length())
                 {
-                    term_word w = word;
-                    w.text = spam;
-                    make_cells(row, w);
-                    spam = std::wstring();
+                    if (push_row(out, row, max_height)) return;
                 }
             }
         }
         else
         {
-            make_cells(row, word);
+            make_cells(out, row, word, max_height, style_overrides, next_override);
         }
     }
 
     if (row.size() > 0)
     {
-        push_row(row);
+        push_row(out, row, max_height);
+    }
+}
+
+
+void TextWidget::rebuild(bool b_rebuild_children)
+{
+    invalidate_paint();
+
+    // h_sizing of auto: no width limit
+    int max_width = std::numeric_limits<int>::max() - 1;
+    if (get_h_sizing() == ws_fixed)
+    {
+        max_width = size.x;
+    }
+    else if (get_h_sizing() == ws_fullscreen)
+    {
+        max_width = term_w();
+    }
+    else if (get_h_sizing() == ws_fill || get_h_sizing() == ws_dynamic)
+    {
+        // set to fill so that size of parent is used for max width
+        set_h_sizing(e_widget_sizing::ws_fill);
+        update_size();
+        max_width = size.x;
+    }
+
+    // do not exceed maximum height, if v sizing is not dynamic
+    int max_height = -1;
+    if (get_v_sizing() == ws_fixed ||
+        get_v_sizing() == ws_fill ||
+        get_v_sizing() == ws_fill_managed)
+    {
+        max_height = get_height_constraint();
+    }
+
+    if (max_width != wrap_width)
+    {
+        cache_cells();
     }
 
-    end:
+    wrap_width = max_width;
+
+    // laid out ahead of time
+    if (layout && layout->width == max_width && style_overrides.empty() &&
+        (max_height < 0 || layout->cells.size() <= max_height))
+    {
+        // still in place from the last rebuild
+        if (!b_cells_from_layout)
+        {
+            cells = layout->cells;
+            b_cells_from_layout = true;
+        }
+        widest_row = layout->widest_row;
+        cell_index = layout->cell_index;
+    }
+    // unless the cells are still in place from the last
+    // rebuild, or were wrapped at this width before
+    else if (max_height > -1 || (!b_cells_cacheable && !uncache_cells(max_width)))
+    {
+        text_layout out;
+        wrap_words(term_words, max_width, max_height, style_overrides, out);
+        cells = std::move(out.cells);
+        widest_row = out.widest_row;
+        cell_index = out.cell_index;
+        b_cells_from_layout = false;
+        b_cells_cacheable = max_height < 0;
+    }
 
     if (get_h_sizing() == ws_fixed)
     {
@@ -217,7 +355,7 @@ void TextWidget::rebuild(bool b_rebuild_children)
 // returns the integer portion of s
 // if s is a post num quote (e.g. ">>3264217777")
 // returns -1 if s is not a post num quote
-int TextWidget::parse_post_num_quote(const std::wstring& s)
+int TextWidget::parse_post_num_quote(const std::string& s)
 {
     for (int i = 0; i < s.length(); ++i)
     {
@@ -269,7 +407,7 @@ void TextWidget::parse_4chan(std::vector<term_word>& words)
             continue;
         }
 
-        std::wstring& text = w.text;
+        std::string& text = w.text;
 
         // begin greentext
         if (b_prev_was_newline && text.length() > 0 && text[0] == '>')
@@ -284,9 +422,10 @@ void TextWidget::parse_4chan(std::vector<term_word>& words)
         }
 
         // post num quote
-        if (parse_post_num_quote(text) != -1)
+        w.quote_num = parse_post_num_quote(text);
+        if (w.quote_num != -1)
         {
-            w.b_underline = true;
+            w.attrs |= TB_UNDERLINE;
             w.bg = COLO.post_bg;
             w.fg = COLO.post_reply;
         }
@@ -302,106 +441,124 @@ void TextWidget::append_text(const std::vector<term_word>& words)
     {
         term_words.push_back(w);
     }
+
+    set_layout(nullptr);
 }
 
 
-void TextWidget::append_text(const std::wstring& str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
+std::vector<term_word> TextWidget::make_words(std::string_view str, bool b_html, bool b_parse_4chan, uint32_t bg, uint32_t fg, bool b_bold, bool b_underline, bool b_reverse)
 {
-    std::wstring s = str;
-    sanitize_text(s);
-
-    if (bg == -1) bg = bg_color;
-    if (fg == -1) fg = fg_color;
-
-    std::vector<term_word> new_words;
-
-    // split text at space chars
-    std::wstring sp = str_to_wstring(" ");
-    std::vector<std::wstring> words1 = split(s, sp);
-
-    // split splitted words at newline chars
-    sp = str_to_wstring("\n");
-    for (auto& w : words1)
+    HTML_Utils::comment_text comment;
+    if (b_html)
     {
-        std::vector<std::wstring> words2 = split(w, sp);
-        int nl = words2.size() - 1;
-        for (auto& w2 : words2)
-        {
-            new_words.emplace_back(
-                w2, bg, fg, b_bold, b_underline, b_reverse);
-            // add newline chars as separate words
-            if (nl > 0)
-            {
-                term_word nl_w = term_word::newline();
-                nl_w.bg = bg;
-                nl_w.fg = fg;
-                new_words.push_back(nl_w);
-                nl--;
-            }
-        }
+        HTML_Utils::parse_comment(str.data(), str.length(), comment);
     }
-
-    if (b_parse_4chan)
+    else
     {
-        parse_4chan(new_words);
+        comment.text = str;
     }
+    const std::string& s = comment.text;
 
-    for (auto& w : new_words)
+    std::vector<term_word> new_words;
+    size_t run = 0;
+    size_t word_start = 0;
+    uint32_t style = HTML_Utils::ts_plain;
+    int quote_num = -1;
+
+    // split text at space and newline chars, newline
+    // chars are added as separate words
+    for (size_t i = 0; i <= s.length(); ++i)
     {
-        term_words.push_back(w);
-    }
+        char c = i < s.length() ? s[i] : ' ';
+        if (c != ' ' && c != '\n')
+        {
+            // styles of all of the runs the word is in
+            while (run < comment.runs.size() &&
+                   comment.runs[run].start + comment.runs[run].length <= i)
+            {
+                run++;
+            }
 
-    if (b_rebuild)
-    {
-        rebuild();
-    }
-}
+            if (run < comment.runs.size())
+            {
+                style |= comment.runs[run].style;
+                if (quote_num == -1)
+                {
+                    quote_num = comment.runs[run].quote_num;
+                }
+            }
 
+            continue;
+        }
 
-void TextWidget::append_text(const char* str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
-{
-    std::wstring wstr = str_to_wstring(str);
-    append_text(wstr, b_rebuild, b_bold, b_underline, b_reverse, bg, fg);
-}
+        new_words.emplace_back(
+            s.substr(word_start, i - word_start),
+            bg, fg, b_bold, b_underline, b_reverse);
 
+        if (b_parse_4chan)
+        {
+            term_word& w = new_words.back();
 
-void TextWidget::append_text(const std::string& str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
-{
-    append_text(str.c_str(), b_rebuild, b_bold, b_underline, b_reverse, bg, fg);
-}
+            if (style & HTML_Utils::ts_quote)
+            {
+                w.bg = COLO.post_bg;
+                w.fg = COLO.post_greentext;
+            }
 
+            if (style & HTML_Utils::ts_quotelink)
+            {
+                w.attrs |= TB_UNDERLINE;
+                w.bg = COLO.post_bg;
+                w.fg = COLO.post_reply;
+                w.quote_num = quote_num;
+            }
+            else if (style & HTML_Utils::ts_deadlink)
+            {
+                w.bg = COLO.post_bg;
+                w.fg = COLO.post_reply;
+            }
 
-void TextWidget::append_raw_text(const std::wstring& str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
-{
-    if (bg == -1) bg = bg_color;
-    if (fg == -1) fg = fg_color;
+            if (style & HTML_Utils::ts_bold)
+            {
+                w.attrs |= TB_BOLD;
+            }
 
-    std::vector<term_word> new_words;
+            if (style & HTML_Utils::ts_spoiler)
+            {
+                w.attrs |= TB_REVERSE;
+            }
+        }
 
-    // split words at newline chars
-    std::wstring sp = str_to_wstring("\n");
-    std::vector<std::wstring> words = split(str, sp);
-    int nl = words.size() - 1;
-    for (auto& w : words)
-    {
-        new_words.emplace_back(
-            w, bg, fg, b_bold, b_underline, b_reverse);
-        // add newline chars as separate words
-        if (nl > 0)
+        if (c == '\n')
         {
             term_word nl_w = term_word::newline();
             nl_w.bg = bg;
             nl_w.fg = fg;
             new_words.push_back(nl_w);
-            nl--;
         }
+
+        word_start = i + 1;
+        style = HTML_Utils::ts_plain;
+        quote_num = -1;
     }
 
-    for (auto& w : new_words)
+    // plain text, e.g. the list of replies to a post
+    if (b_parse_4chan && !comment.b_markup)
     {
-        term_words.push_back(w);
+        parse_4chan(new_words);
     }
 
+    return new_words;
+}
+
+
+void TextWidget::append_text(std::string_view str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
+{
+    if (bg == -1) bg = bg_color;
+    if (fg == -1) fg = fg_color;
+
+    append_text(make_words(str, b_parse_html, b_parse_4chan, bg, fg, b_bold, b_underline, b_reverse));
+
     if (b_rebuild)
     {
         rebuild();
@@ -409,73 +566,47 @@ void TextWidget::append_raw_text(const std::wstring& str, bool b_rebuild, bool b
 }
 
 
-void TextWidget::append_raw_text(const char* str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
+void TextWidget::append_raw_text(std::string_view str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
 {
-    std::wstring wstr = str_to_wstring(str);
-    append_raw_text(wstr, b_rebuild, b_bold, b_underline, b_reverse, bg, fg);
-}
-
+    if (bg == -1) bg = bg_color;
+    if (fg == -1) fg = fg_color;
 
-void TextWidget::append_raw_text(const std::string& str, bool b_rebuild, bool b_bold, bool b_underline, bool b_reverse, uint32_t bg, uint32_t fg)
-{
-    append_raw_text(str.c_str(), b_rebuild, b_bold, b_underline, b_reverse, bg, fg);
-}
+    std::vector<term_word> new_words;
 
+    // split words at newline chars
+    size_t start = 0;
+    while (true)
+    {
+        size_t nl = str.find('\n', start);
+        new_words.emplace_back(
+            std::string(str.substr(start, nl == std::string_view::npos ? nl : nl - start)),
+            bg, fg, b_bold, b_underline, b_reverse);
 
-void TextWidget::sanitize_text(std::wstring& str)
-{
-    str.erase(
-        std::remove_if(
-            str.begin(),
-            str.end(),
-            [](char c){
-                return (c == '\n' || c == '\r' ||
-                        c == '\t' || c == '\v' || c == '\f');
-            }),
-        str.end());
-
-    // TODO: all of this is super inefficient.
-    //       write an efficient sanitization algo,
-    //       and strip all HTML properly
-    replace_substr(str, "<wbr>", "");
-    replace_substr(str, "<b>", "");
-    replace_substr(str, "<i>", "");
-    replace_substr(str, "</b>", "");
-    replace_substr(str, "</i>", "");
-    replace_substr(str, "</a>", "");
-    replace_substr(str, "</span>", "");
-    replace_substr(str, "<span class=\"quote\">", "");
-    replace_substr(str, "&gt;", ">");
-    replace_substr(str, "&#039;", "'");
-    replace_substr(str, "&quot;", "\"");
-    replace_substr(str, "<br>", "\n");
-
-    {
-        std::wstring pat = str_to_wstring("<a href=");
-        std::wstring pat2 = str_to_wstring("\">");
-        std::wstring rep = str_to_wstring("");
-        size_t index = 0;
-        size_t len = 0;
-        while(1)
+        if (nl == std::string_view::npos)
         {
-            index = str.find(pat, index);
-            if (index == std::string::npos)
-            {
-                break;
-            }
+            break;
+        }
 
-            len = str.find(pat2, index);
-            len = len - index + pat2.length();
+        // add newline chars as separate words
+        term_word nl_w = term_word::newline();
+        nl_w.bg = bg;
+        nl_w.fg = fg;
+        new_words.push_back(nl_w);
+        start = nl + 1;
+    }
 
-            str.replace(index, len, rep);
-        }
+    append_text(new_words);
+
+    if (b_rebuild)
+    {
+        rebuild();
     }
 }
 
 
-std::wstring TextWidget::get_word_at_coord(vector2d coord)
+std::string TextWidget::get_word_at_coord(vector2d coord)
 {
-    if (coord.x < 0 || coord.y < 0) return std::wstring();
+    if (coord.x < 0 || coord.y < 0) return std::string();
 
     vector2d abs_off = get_absolute_offset();
     int x = coord.x - abs_off.x;
@@ -485,33 +616,33 @@ std::wstring TextWidget::get_word_at_coord(vector2d coord)
         std::vector<tb_cell>& row = cells[y];
         if (x < row.size())
         {
-            wchar_t ch = (wchar_t)row[x].ch;
+            uint32_t ch = row[x].ch;
             if (ch != ' ')
             {
                 while (ch != ' ' && x > 0)
                 {
                     x--;
-                    ch = (wchar_t)row[x].ch;
+                    ch = row[x].ch;
                 }
 
                 if (x != 0)
                 {
                     x++;
-                    ch = (wchar_t)row[x].ch;
+                    ch = row[x].ch;
                 }
 
-                std::wstring word;
+                std::string word;
 
                 while (ch != ' ' && x < row.size() - 1)
                 {
-                    word += ch;
+                    utf8_encode(ch, word);
                     x++;
-                    ch = (wchar_t)row[x].ch;
+                    ch = row[x].ch;
                 }
 
                 if (x == row.size() - 1 && ch != ' ')
                 {
-                    word += ch;
+                    utf8_encode(ch, word);
                 }
 
                 return word;
@@ -519,6 +650,5 @@ std::wstring TextWidget::get_word_at_coord(vector2d coord)
         }
     }
 
-    return std::wstring();
+    return std::string();
 }
-
@@ -10,6 +10,24 @@
 #include "termwidget.h"
 
 
+// words wrapped into rows of cells at a given width. built by
+// TextWidget::wrap_words, which can run off the ui thread, and
+// handed to a TextWidget whose words they were made from
+struct text_layout
+{
+    text_layout()
+    : width(0)
+    , widest_row(0)
+    , cell_index(0)
+    {}
+
+    int width;
+    std::vector<std::vector<tb_cell>> cells;
+    int widest_row;
+    int cell_index;
+};
+
+
 class TextWidget : public TermWidget
 {
 
@@ -22,13 +40,36 @@ protected:
 
     std::vector<term_word> term_words;
     bool b_parse_4chan;
+    // the text is html, e.g. a comment or subject from 4chan
+    bool b_parse_html;
     int widest_row;
     int cell_index;
-    std::map<int, term_word> format_override;
+    int wrap_width;
+    // formatting over the words', sorted by start.
+    // walked along with the cells as they are made.
+    std::vector<style_run> style_overrides;
+    // laid out ahead of time, used if the widget gets its width
+    std::shared_ptr<const text_layout> layout;
+    bool b_cells_from_layout;
+    // rows the words were wrapped into at the last few widths the
+    // widget had, oldest first, so that going back to one of them
+    // (e.g. while a window border is dragged) doesn't wrap them again
+    std::vector<text_layout> width_cache;
+    static const size_t WIDTH_CACHE_SIZE = 3;
+    // cells hold all of the words, wrapped at wrap_width
+    bool b_cells_cacheable;
+
+    // moves the cells into width_cache
+    void cache_cells();
+    // moves the cells wrapped at width out of width_cache,
+    // returns false if there are none
+    bool uncache_cells(int width);
 
     // returns true if max height has been reached
-    bool push_row(std::vector<tb_cell>& row);
-    void make_cells(std::vector<tb_cell>& row, term_word& word);
+    static bool push_row(text_layout& out, std::vector<tb_cell>& row, int max_height);
+    // next_override is the first of style_overrides that
+    // doesn't end before the word
+    static void make_cells(text_layout& out, std::vector<tb_cell>& row, const term_word& word, int max_height, const std::vector<style_run>& style_overrides, size_t& next_override);
 
 
 public:
@@ -36,6 +77,7 @@ public:
     std::vector<term_word>& get_term_words() { return term_words; };
     int get_cell_index() const { return cell_index; };
     void set_parse_4chan(bool b_parse) { b_parse_4chan = b_parse; };
+    void set_parse_html(bool b_parse) { b_parse_html = b_parse; };
 
     // override the cell formatting at index
     void override_format(
@@ -47,56 +89,55 @@ public:
         bool b_reverse = false
     );
 
-    void clear_override_formatting() { format_override.clear(); };
+    void clear_override_formatting() { style_overrides.clear(); set_layout(nullptr); };
 
-    static void sanitize_text(std::wstring& str);
+    // colors greentext and quotes in text without html
     static void parse_4chan(std::vector<term_word>& words);
 
+    // the words append_text adds for str. if b_html, str is html
+    // and is taken out of it (see HTML_Utils::parse_comment),
+    // else its text is kept as it is. thread safe.
+    static std::vector<term_word> make_words(
+        std::string_view str,
+        bool b_html,
+        bool b_parse_4chan,
+        uint32_t bg,
+        uint32_t fg,
+        bool b_bold = false,
+        bool b_underline = false,
+        bool b_reverse = false
+    );
+
+    // wraps words into rows of at most max_width cells, stopping
+    // after max_height rows if max_height > -1. thread safe.
+    static void wrap_words(
+        const std::vector<term_word>& words,
+        int max_width,
+        int max_height,
+        const std::vector<style_run>& style_overrides,
+        text_layout& out
+    );
+
+    // a layout of the widget's current words, which rebuild uses
+    // instead of wrapping them itself if the width matches.
+    // changing the text drops it.
+    void set_layout(std::shared_ptr<const text_layout> _layout);
+    // width the text was last wrapped at
+    int get_wrap_width() const { return wrap_width; };
+
     virtual void rebuild(bool b_rebuild_children = true) override;
 
     // returns the integer portion of s
     // if s is a post num quote (e.g. ">>3264217777")
     // returns -1 if s is not a post num quote
-    static int parse_post_num_quote(const std::wstring& s);
+    static int parse_post_num_quote(const std::string& s);
 
     void append_text(const std::vector<term_word>& words);
 
-    // sanitized and parsed text
-
-    void append_text(
-        const std::wstring& str,
-        bool b_rebuild = false,
-        bool b_bold = false,
-        bool b_underline = false,
-        bool b_reverse = false,
-        uint32_t bg = -1,
-        uint32_t fg = -1
-    );
-
-    void append_text(
-        const char* str,
-        bool b_rebuild = false,
-        bool b_bold = false,
-        bool b_underline = false,
-        bool b_reverse = false,
-        uint32_t bg = -1,
-        uint32_t fg = -1
-    );
+    // utf-8 text, with html taken out and parsed
 
     void append_text(
-        const std::string& str,
-        bool b_rebuild = false,
-        bool b_bold = false,
-        bool b_underline = false,
-        bool b_reverse = false,
-        uint32_t bg = -1,
-        uint32_t fg = -1
-    );
-
-    // raw text
-
-    void append_raw_text(
-        const std::wstring& str,
+        std::string_view str,
         bool b_rebuild = false,
         bool b_bold = false,
         bool b_underline = false,
@@ -105,18 +146,10 @@ public:
         uint32_t fg = -1
     );
 
-    void append_raw_text(
-        const char* str,
-        bool b_rebuild = false,
-        bool b_bold = false,
-        bool b_underline = false,
-        bool b_reverse = false,
-        uint32_t bg = -1,
-        uint32_t fg = -1
-    );
+    // raw utf-8 text
 
     void append_raw_text(
-        const std::string& str,
+        std::string_view str,
         bool b_rebuild = false,
         bool b_bold = false,
         bool b_underline = false,
@@ -125,9 +158,9 @@ public:
         uint32_t fg = -1
     );
 
-    std::wstring get_word_at_coord(vector2d coord);
+    std::string get_word_at_coord(vector2d coord);
 
-    void clear_text() { term_words.clear(); widest_row = 0; };
+    void clear_text() { term_words.clear(); widest_row = 0; set_layout(nullptr); };
 
 };
 
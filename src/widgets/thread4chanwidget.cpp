@@ -10,6 +10,7 @@
 #include "../netops.h"
 #include "../fileops.h"
 #include "../widgetman.h"
+#include "../postfilter.h"
 #include "widgets.h"
 
 
@@ -33,6 +34,7 @@ Thread4chanWidget::Thread4chanWidget(data_4chan& chan_data, bool b_update)
     reload_flash_count = reload_flash_num;
     b_reload_flash_sym = false;
     selected_post = nullptr;
+    chain_post = -1;
 
     header = nullptr;
     header_info = nullptr;
@@ -46,6 +48,13 @@ Thread4chanWidget::Thread4chanWidget(data_4chan& chan_data, bool b_update)
     b_auto_update = false;
     b_manual_update = false;
     b_can_save = true;
+    b_resize_pending = false;
+    filters_generation = POST_FILTER.get_generation();
+    pending_scroll = 0;
+    b_scroll_pending = false;
+    b_virtual_posts = false;
+    reset_posts_window();
+    resize_wait = std::chrono::milliseconds(0);
 
     if (b_update)
     {
@@ -56,6 +65,18 @@ Thread4chanWidget::Thread4chanWidget(data_4chan& chan_data, bool b_update)
 
 bool Thread4chanWidget::on_received_update(data_4chan& chan_data)
 {
+    // keep flashing the reload indicator until the rest arrives
+    if (chan_data.b_partial)
+    {
+        b_reloading = true;
+        b_manual_update = true;
+        reload_flash_count = 0;
+        b_reload_flash_sym = true;
+        auto_refresh_counter = std::chrono::milliseconds(0);
+
+        return false;
+    }
+
     b_reloading = false;
     auto_refresh_counter = std::chrono::milliseconds(0);
 
@@ -68,6 +89,17 @@ void Thread4chanWidget::tick_event(std::chrono::milliseconds delta)
 {
     using namespace std::chrono;
 
+    if (b_resize_pending)
+    {
+        resize_wait += delta;
+        if (resize_wait >= RESIZE_DEBOUNCE)
+        {
+            apply_term_resize();
+        }
+    }
+
+    check_filters();
+
     if ((!b_auto_update && !b_manual_update) ||
         b_archived || !footer_info || !footer)
     {
@@ -89,11 +121,11 @@ void Thread4chanWidget::tick_event(std::chrono::milliseconds delta)
             {
                 footer_info->clear_text();
                 footer_info->append_text(base_footer_text);
-                footer_countdown = L"| Reloading ";
-                std::wstring sym = L"\u25C9";   // (@)
+                footer_countdown = "| Reloading ";
+                std::string sym = u8"\u25C9";   // (@)
                 if (b_reload_flash_sym)
                 {
-                    sym = L"\u25CB";    // ( )
+                    sym = u8"\u25CB";    // ( )
                 }
                 footer_countdown += sym;
                 footer_info->append_text(footer_countdown, true);
@@ -110,7 +142,7 @@ void Thread4chanWidget::tick_event(std::chrono::milliseconds delta)
                 {
                     footer_info->clear_text();
                     footer_info->append_text(base_footer_text);
-                    footer_countdown = L"| Reload [paused]";
+                    footer_countdown = "| Reload [paused]";
                     footer_info->append_text(footer_countdown, true);
                 }
             }
@@ -147,9 +179,9 @@ void Thread4chanWidget::tick_event(std::chrono::milliseconds delta)
         uint32_t time = auto_refresh_counter.count();
         time /= 1000;
         time = (auto_refresh_interval.count() / 1000) - time;
-        footer_countdown = L"| Reload in ";
-        footer_countdown += std::to_wstring(time);
-        footer_countdown += L"s";
+        footer_countdown = "| Reload in ";
+        footer_countdown += std::to_string(time);
+        footer_countdown += "s";
         footer_info->append_text(footer_countdown, true);
 
         if (time != time_cache)
@@ -166,6 +198,31 @@ void Thread4chanWidget::tick_event(std::chrono::milliseconds delta)
 }
 
 
+void Thread4chanWidget::check_filters()
+{
+    // wait for a reload that's under way, it may
+    // have been parsed with the old filters
+    if (!page_data || !page_data->b_apply_filters || b_reloading) return;
+
+    // makes the filters file be checked for changes, a thread
+    // that's not modified isn't parsed and wouldn't check it
+    POST_FILTER.get_filters();
+
+    uint32_t generation = POST_FILTER.get_generation();
+    if (generation == filters_generation) return;
+
+    filters_generation = generation;
+    b_reloading = true;
+    // posts the new filters hide or no longer hide
+    // are taken out or built by apply_page_data()
+    NetOps::cache_get__4chan_json(
+        thread_url,
+        get_id(),
+        last_update_time,
+        get_id());
+}
+
+
 void Thread4chanWidget::refresh(bool b_draw_term)
 {
     if (child_widget)
@@ -188,21 +245,204 @@ void Thread4chanWidget::refresh(bool b_draw_term)
 
 void Thread4chanWidget::handle_term_resize_event()
 {
-    rebuild();
+    if (!main_vbox)
+    {
+        rebuild();
+        return;
+    }
+
+    // applied once the resizing stops, as dragging a window
+    // border sends a resize event for every step
+    b_resize_pending = true;
+    resize_wait = std::chrono::milliseconds(0);
 }
 
 
-void Thread4chanWidget::rebuild(bool b_rebuild_children)
+void Thread4chanWidget::apply_term_resize()
 {
-    if (!page_data || page_data->posts.size() < 1) return;
+    b_resize_pending = false;
 
-    vector2d cached_scroll_pos;
+    // done in full by on_focus_received
+    if (hidden())
+    {
+        return;
+    }
 
-    if (scroll_panel)
+    if (!main_vbox || !posts_vbox || !scroll_panel || !posts_box ||
+        !header || !footer)
     {
-        cached_scroll_pos = scroll_panel->get_scroll_position();
+        rebuild();
+        WIDGET_MAN.draw_widgets();
+        return;
+    }
+
+    // sets term size cache
+    update_size(false);
+
+    for (auto& child : posts_vbox->children)
+    {
+        Post4chanWidget* post = dynamic_cast<Post4chanWidget*>(child.get());
+        if (post)
+        {
+            post->set_needs_reflow();
+        }
+    }
+
+    header->rebuild(true);
+    footer->rebuild(true);
+    int shrink = header->get_height_constraint();
+    shrink += footer->get_height_constraint();
+    posts_box->set_size(1, term_h() - shrink);
+
+    // the rest are rebuilt as they're scrolled to
+    if (!update_visible_posts())
+    {
+        place_posts();
+    }
+
+    prefetch_images();
+    WIDGET_MAN.draw_widgets();
+}
+
+
+bool Thread4chanWidget::update_visible_posts()
+{
+    if (!posts_vbox || !scroll_panel || !posts_box || !main_vbox)
+    {
+        return false;
+    }
+
+    int view_h = scroll_panel->get_visible_height();
+    int view_top = -scroll_panel->get_scroll_position().y;
+
+    // posts this far above and below the visible part of the thread
+    // are built, so scrolling a bit doesn't show stale posts and the
+    // images that are prefetched have a post to go in. virtual posts
+    // twice as far away are released again.
+    int margin_above = std::max(view_h, IMG_PREFETCH_ROWS);
+    int margin_below = std::max(view_h * 2, IMG_PREFETCH_ROWS);
+
+    // the post at the top of the screen, and how
+    // far into it the screen starts
+    Post4chanWidget* anchor = nullptr;
+    int anchor_row = 0;
+    // rows the rebuilt posts have grown by so far
+    int shift = 0;
+    bool b_changed = false;
+    // the first post that changed height, the ones
+    // before it are left where they are
+    size_t first_changed = SIZE_MAX;
+
+    // only the posts around the screen, and around where it was the
+    // last time, can need building or releasing. the box's index of
+    // child offsets finds them without going through the thread.
+    std::vector<std::shared_ptr<TermWidget>>& children = posts_vbox->children;
+    size_t first = posts_window_first;
+    size_t last = posts_window_last;
+    if (posts_vbox->has_child_index() && !children.empty())
+    {
+        first = std::min(first, (size_t)posts_vbox->child_index_at(view_top - margin_above * 2));
+        last = std::max(last, (size_t)posts_vbox->child_index_at(view_top + view_h + margin_below * 2) + 1);
+    }
+    else
+    {
+        first = 0;
+        last = children.size();
+    }
+    last = std::min(last, children.size());
+
+    for (size_t i = first; i < last; ++i)
+    {
+        Post4chanWidget* post = dynamic_cast<Post4chanWidget*>(children[i].get());
+        if (!post) continue;
+
+        int old_top = post->get_inherited_offset().y;
+        int old_h = post->get_size().y;
+
+        if (!anchor && old_top + old_h > view_top)
+        {
+            anchor = post;
+            anchor_row = view_top - old_top;
+        }
+
+        int top = old_top + shift;
+        int above = view_top + shift - (top + old_h);
+        int below = top - (view_top + shift + view_h);
+
+        if (above > margin_above || below > margin_below)
+        {
+            if (!b_virtual_posts)
+            {
+                if (below > margin_below) break;
+                continue;
+            }
+
+            if (!post->is_virtual() &&
+                (above > margin_above * 2 || below > margin_below * 2))
+            {
+                post->release();
+                post->update_size(false);
+                shift += post->get_size().y - old_h;
+                b_changed = true;
+                first_changed = std::min(first_changed, i);
+            }
+
+            continue;
+        }
+
+        if (post->is_virtual())
+        {
+            post->materialize();
+            shift += post->get_size().y - old_h;
+            b_changed = true;
+            first_changed = std::min(first_changed, i);
+        }
+        else if (post->needs_reflow())
+        {
+            post->rebuild(true);
+            shift += post->get_size().y - old_h;
+            b_changed = true;
+            first_changed = std::min(first_changed, i);
+        }
     }
 
+    if (b_changed)
+    {
+        place_posts(first_changed);
+
+        if (anchor)
+        {
+            scroll_panel->scroll_to(-(anchor->get_inherited_offset().y + anchor_row));
+        }
+
+        view_top = -scroll_panel->get_scroll_position().y;
+    }
+
+    if (posts_vbox->has_child_index() && !children.empty())
+    {
+        posts_window_first = posts_vbox->child_index_at(view_top - margin_above * 2);
+        posts_window_last = posts_vbox->child_index_at(view_top + view_h + margin_below * 2) + 1;
+    }
+    else
+    {
+        reset_posts_window();
+    }
+
+    return b_changed;
+}
+
+
+void Thread4chanWidget::place_posts(size_t first_changed)
+{
+    posts_vbox->update_child_tops(first_changed);
+    scroll_panel->rebuild(false);
+    posts_box->rebuild(false);
+    main_vbox->rebuild(false);
+}
+
+
+void Thread4chanWidget::build_frame()
+{
     // main vertical box container
     main_vbox = std::make_shared<VerticalBoxWidget>(false /* b_stretch_offscreen */);
     main_vbox->set_h_sizing(e_widget_sizing::ws_fullscreen);
@@ -266,7 +506,6 @@ void Thread4chanWidget::rebuild(bool b_rebuild_children)
 
     header_info->set_h_sizing(e_widget_sizing::ws_fill);
     header_info->set_v_sizing(e_widget_sizing::ws_dynamic);
-    header_info->append_text("4chan /" + board + "/", false);
     header->set_child_widget(header_info);
 
     // footer bar
@@ -295,9 +534,44 @@ void Thread4chanWidget::rebuild(bool b_rebuild_children)
 
     footer->set_child_widget(footer_info);
 
+    main_vbox->add_child_widget(header, false /* rebuild */);
+    main_vbox->add_child_widget(posts_box, false /* rebuild */);
+    main_vbox->add_child_widget(footer, false /* rebuild */);
+
+    set_child_widget(main_vbox, false /* rebuild */);
+}
+
+
+void Thread4chanWidget::rebuild(bool b_rebuild_children)
+{
+    if (!page_data || page_data->posts.size() < 1) return;
+
+    vector2d cached_scroll_pos;
+
+    if (scroll_panel)
+    {
+        cached_scroll_pos = scroll_panel->get_scroll_position();
+    }
+
+    // the boxes around the posts are kept from one
+    // rebuild to the next, only the posts are put back
+    if (!main_vbox)
+    {
+        build_frame();
+    }
+    else
+    {
+        posts_vbox->clear_children();
+    }
+
+    b_virtual_posts = page_data->posts.size() >= VIRTUAL_POSTS_MIN;
+    reset_posts_window();
+
     // load post data
     std::vector<std::shared_ptr<Post4chanWidget>> post_vec;
     std::vector<std::shared_ptr<Post4chanWidget>> new_posts;
+    std::set<int> nums;
+    const imageboard::post* op = nullptr;
 
     for (auto& p : page_data->posts)
     {
@@ -307,9 +581,6 @@ void Thread4chanWidget::rebuild(bool b_rebuild_children)
         //       the image data won't be dumped
         //       and therefore need to be loaded
         //       from disk again
-        //
-        // TODO: handle case of deleted post or post image
-        //
         std::shared_ptr<Post4chanWidget> post = get_post(p.num);
 
         // create new post
@@ -319,155 +590,546 @@ void Thread4chanWidget::rebuild(bool b_rebuild_children)
             post_map[post->get_post_num()] = post;
             new_posts.push_back(post);
         }
+        else
+        {
+            post->set_post_data(p);
+        }
+
+        // posts away from the screen are built as they're scrolled to
+        post->set_virtual(b_virtual_posts && !post->get_child_widget());
 
         if (p.b_op)
         {
-            // subject
-            thread_subject = p.subject;
-            header_info->append_text("- " + thread_subject, false);
-            base_header_text = header_info->get_term_words();
+            op = &p;
+        }
+
+        nums.insert(p.num);
+        post_vec.push_back(post);
+        post->set_replies(page_data->graph.get_replies(p.num));
+
+        if (is_shown(p.num))
+        {
+            posts_vbox->add_child_widget(post, false /* rebuild */);
+        }
+        else
+        {
+            new_posts.erase(std::remove(new_posts.begin(), new_posts.end(), post), new_posts.end());
+        }
+    }
+
+    remove_deleted_posts(nums);
+
+    layout_posts(new_posts);
+
+    // posts must be built before replies can be loaded
+    posts_vbox->rebuild(true);
+
+    // add the quote replies to the post
+    for (auto& post : post_vec)
+    {
+        post->load_replies();
+    }
 
-            // widget title
-            title = "/" + board + "/ - ";
-            if (!thread_subject.empty())
+    set_thread_info(op);
+
+    // shrink posts_box to fit header and footer
+    header->rebuild(true);
+    footer->rebuild(true);
+    int shrink = header->get_height_constraint();
+    shrink += footer->get_height_constraint();
+    posts_box->set_size(1, term_h() - shrink);
+
+    main_vbox->rebuild(true /* recursive */);
+
+    // restore thread scroll position
+    // (must be done after being built, as it requires
+    // the inherited_offset to be set by its parent)
+    scroll_panel->set_scroll_position(cached_scroll_pos);
+    scroll_panel->rebuild(false);
+    update_visible_posts();
+
+    // sets term size cache
+    update_size(false);
+    b_resize_pending = false;
+
+    prefetch_images();
+}
+
+
+void Thread4chanWidget::set_thread_info(const imageboard::post* op)
+{
+    if (!header_info || !footer_info) return;
+
+    header_info->clear_text();
+    header_info->append_text("4chan /" + board + "/", false);
+    footer_info->clear_text();
+
+    if (op)
+    {
+        const imageboard::post& p = *op;
+
+        // subject
+        thread_subject = HTML_Utils::comment_to_text(p.subject.data(), p.subject.length());
+        header_info->append_text("- " + thread_subject, false);
+
+        // widget title
+        title = "/" + board + "/ - ";
+        if (!thread_subject.empty())
+        {
+            title += thread_subject;
+        }
+        else
+        {
+            std::string com(p.text);
+            com.erase(
+                std::remove_if(
+                    com.begin(),
+                    com.end(),
+                    [](char c){
+                        return (c == '\n' || c == '\r' ||
+                                c == '\t' || c == '\v' || c == '\f');
+                    }),
+                com.end());
+
+            if (com.length() > 36)
             {
-                title += thread_subject;
+                title += com.substr(0, 36);
+                title += "...";
             }
             else
             {
-                std::string com = p.text;
-                com.erase(
-                    std::remove_if(
-                        com.begin(),
-                        com.end(),
-                        [](char c){
-                            return (c == '\n' || c == '\r' ||
-                                    c == '\t' || c == '\v' || c == '\f');
-                        }),
-                    com.end());
-
-                if (com.length() > 36)
-                {
-                    title += com.substr(0, 36);
-                    title += "...";
-                }
-                else
-                {
-                    title += com.substr(0, com.length());
-                }
+                title += com.substr(0, com.length());
             }
+        }
+
+        // replies
+        footer_info->append_text("Replies:");
+        footer_info->append_text(
+            std::to_string(p.replies).c_str());
+
+        // images
+        footer_info->append_text("| Images:");
+        footer_info->append_text(
+            std::to_string(p.images).c_str());
+
+        // archived or not
+        if (p.b_archived)
+        {
+            b_archived = true;
+        }
+
+        // unique ips
+        footer_info->append_text("| IPs:");
+        footer_info->append_text(
+            std::to_string(p.unique_ips).c_str());
+    }
+
+    base_header_text = header_info->get_term_words();
+
+    // append "[Archived]" and "[Saved]" etc.
+    update_header_info();
+
+    base_footer_text = footer_info->get_term_words();
+    if (!b_archived)
+    {
+        if (!footer_countdown.empty())
+        {
+            footer_info->append_text(footer_countdown);
+        }
+        else
+        {
+            std::string t = "| Reload in " + std::to_string(auto_ref_s) + "s";
+            footer_info->append_text(t);
+            b_auto_update = true;
+        }
+    }
+}
+
+
+void Thread4chanWidget::apply_page_data(std::shared_ptr<imageboard::page_data> new_data)
+{
+    // keeps the posts the widgets were built from
+    // alive until they have been compared
+    std::shared_ptr<imageboard::page_data> old_data = page_data;
+    page_data = new_data;
+
+    if (!page_data || page_data->posts.size() < 1)
+    {
+        return;
+    }
 
-            // replies
-            footer_info->append_text("Replies:");
-            footer_info->append_text(
-                std::to_string(p.replies).c_str());
+    // not built yet
+    if (!old_data || !main_vbox || !posts_vbox || !scroll_panel ||
+        !header || !footer)
+    {
+        rebuild();
+        return;
+    }
 
-            // images
-            footer_info->append_text("| Images:");
-            footer_info->append_text(
-                std::to_string(p.images).c_str());
+    update_posts();
 
-            // archived or not
-            if (p.b_archived)
+    // the terminal was resized while the thread was in the background
+    if (term_size_cache != vector2d(term_w(), term_h()))
+    {
+        update_size(false);
+        rebuild();
+    }
+}
+
+
+void Thread4chanWidget::update_posts()
+{
+    std::vector<std::shared_ptr<Post4chanWidget>> post_vec;
+    // added posts, and posts that have changed and are built again
+    std::vector<std::shared_ptr<Post4chanWidget>> new_posts;
+    std::set<int> nums;
+    const imageboard::post* op = nullptr;
+
+    for (auto& p : page_data->posts)
+    {
+        std::shared_ptr<Post4chanWidget> post = get_post(p.num);
+
+        // changed since it was built (e.g. its image was deleted)
+        if (post && post->get_post_data() &&
+            !Post4chanWidget::shows_same(*post->get_post_data(), p))
+        {
+            if (selected_post == post.get())
             {
-                b_archived = true;
+                selected_post = nullptr;
             }
 
-            // unique ips
-            footer_info->append_text("| IPs:");
-            footer_info->append_text(
-                std::to_string(p.unique_ips).c_str());
+            post = std::make_shared<Post4chanWidget>(this, p, vector4d(), COLO.post_bg, COLO.post_text);
+            post_map[p.num] = post;
+            new_posts.push_back(post);
+        }
+        else if (!post)
+        {
+            post = std::make_shared<Post4chanWidget>(this, p, vector4d(), COLO.post_bg, COLO.post_text);
+            post_map[p.num] = post;
+            new_posts.push_back(post);
+        }
+        else
+        {
+            post->set_post_data(p);
+        }
+
+        if (p.b_op)
+        {
+            op = &p;
         }
 
+        nums.insert(p.num);
         post_vec.push_back(post);
-        posts_vbox->add_child_widget(post, false /* rebuild */);
     }
 
-    // posts must be built before replies can be parsed and loaded
-    posts_vbox->rebuild(true);
+    remove_deleted_posts(nums);
 
-    // find all quotes (e.g. >>38938922) and add
-    // them to the post that is being quoted
-    for (auto& post : new_posts)
+    // new replies join the reply chain being shown
+    if (chain_post != -1)
     {
-        post->parse_quotes();
+        if (nums.count(chain_post))
+        {
+            reply_chain = page_data->graph.get_chain(chain_post);
+        }
+        else
+        {
+            chain_post = -1;
+            reply_chain.clear();
+        }
     }
 
-    // add the quote replies to the post
+    std::vector<std::shared_ptr<Post4chanWidget>> shown_vec;
     for (auto& post : post_vec)
     {
-        post->load_replies();
+        if (is_shown(post->get_post_num()))
+        {
+            shown_vec.push_back(post);
+        }
     }
 
-    // append "[Archived]" and "[Saved]" etc.
-    update_header_info();
+    // take out the widgets of deleted and replaced posts,
+    // then put the new ones in between the others
+    posts_vbox->remove_children_if(
+        [this](TermWidget* child) {
+            Post4chanWidget* post = dynamic_cast<Post4chanWidget*>(child);
+            return !post || get_post(post->get_post_num()).get() != post ||
+                   !is_shown(post->get_post_num());
+        });
 
-    base_footer_text = footer_info->get_term_words();
-    if (!b_archived)
+    std::vector<std::shared_ptr<TermWidget>>& children = posts_vbox->children;
+
+    for (size_t i = 0; i < shown_vec.size(); ++i)
     {
-        if (!footer_countdown.empty())
+        if (i >= children.size() || children[i] != shown_vec[i])
         {
-            footer_info->append_text(footer_countdown);
+            posts_vbox->insert_child_widget(i, shown_vec[i], false /* rebuild */);
         }
-        else
+    }
+
+    // posts that kept their place but not their order
+    if (children.size() != shown_vec.size())
+    {
+        posts_vbox->clear_children();
+        for (auto& post : shown_vec)
         {
-            std::string t = "| Reload in " + std::to_string(auto_ref_s) + "s";
-            footer_info->append_text(t);
-            b_auto_update = true;
+            posts_vbox->add_child_widget(post, false /* rebuild */);
         }
     }
 
-    main_vbox->add_child_widget(header, false /* rebuild */);
-    main_vbox->add_child_widget(posts_box, false /* rebuild */);
-    main_vbox->add_child_widget(footer, false /* rebuild */);
+    // posts left out of the reply chain are built when it's closed
+    new_posts.erase(
+        std::remove_if(
+            new_posts.begin(),
+            new_posts.end(),
+            [this](const std::shared_ptr<Post4chanWidget>& post) {
+                return !is_shown(post->get_post_num());
+            }),
+        new_posts.end());
 
-    // shrink posts_box to fit header and footer
+    b_virtual_posts = page_data->posts.size() >= VIRTUAL_POSTS_MIN;
+    reset_posts_window();
+
+    layout_posts(new_posts);
+
+    for (auto& post : new_posts)
+    {
+        post->set_virtual(b_virtual_posts && !post->get_child_widget());
+        post->rebuild(true);
+    }
+
+    // the reply graph was built along with the page data, so only
+    // the posts whose list of replies differs from it are rebuilt
+    for (auto& post : post_vec)
+    {
+        const std::vector<int>& replies = page_data->graph.get_replies(post->get_post_num());
+        if (post->get_replies() != replies)
+        {
+            post->set_replies(replies);
+
+            if (is_shown(post->get_post_num()))
+            {
+                post->load_replies();
+                post->rebuild(true);
+            }
+        }
+    }
+
+    // the op's reply count etc.
+    set_thread_info(op);
     header->rebuild(true);
     footer->rebuild(true);
     int shrink = header->get_height_constraint();
     shrink += footer->get_height_constraint();
     posts_box->set_size(1, term_h() - shrink);
 
-    set_child_widget(main_vbox, false /* rebuild */);
-    main_vbox->rebuild(true /* recursive */);
+    // only moves the posts into place
+    if (!update_visible_posts())
+    {
+        place_posts();
+    }
 
-    // restore thread scroll position
-    // (must be done after being built, as it requires
-    // the inherited_offset to be set by its parent)
-    scroll_panel->set_scroll_position(cached_scroll_pos);
-    scroll_panel->rebuild(false);
+    prefetch_images();
+}
 
-    // sets term size cache
-    update_size(false);
+
+void Thread4chanWidget::remove_deleted_posts(const std::set<int>& nums)
+{
+    for (auto it = post_map.begin(); it != post_map.end();)
+    {
+        if (nums.count(it->first) == 0)
+        {
+            if (it->second && selected_post == it->second.get())
+            {
+                selected_post = nullptr;
+            }
+
+            it = post_map.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
 }
 
 
-std::shared_ptr<Post4chanWidget> Thread4chanWidget::get_post(int post_num)
+void Thread4chanWidget::layout_posts(const std::vector<std::shared_ptr<Post4chanWidget>>& posts)
 {
-    try
+    // a handful of posts (e.g. new replies) isn't worth the trouble
+    if (posts.size() < 8) return;
+
+    // the first post with text is built here to find out the width
+    // post text is wrapped at. the others are wrapped at that width
+    // by the workers, and rebuild throws their cells away if the
+    // post text ends up with a different width after all.
+    std::shared_ptr<Post4chanWidget> probe = nullptr;
+    for (auto& post : posts)
     {
-        std::shared_ptr<Post4chanWidget> wgt = post_map.at(post_num);
-        if (wgt)
+        if (!post->get_post_data()->text.empty())
         {
-            return wgt;
+            probe = post;
+            probe->materialize();
+            break;
         }
     }
-    catch (const std::out_of_range& oor)
+    int text_width = probe ? probe->get_text_wrap_width() : 0;
+
+    // the workers only read the posts' data
+    std::vector<const imageboard::post*> data;
+    for (auto& post : posts)
     {
-        return nullptr;
+        data.push_back(post == probe ? nullptr : post->get_post_data());
+    }
+
+    std::vector<std::shared_ptr<const post_layout>> layouts(posts.size());
+    THREAD_MAN.parallel_for(
+        posts.size(),
+        [&data, &layouts, text_width](size_t i) {
+            if (data[i])
+            {
+                layouts[i] = Post4chanWidget::make_layout(*data[i], text_width);
+            }
+        },
+        get_id() + "#layout");
+
+    for (size_t i = 0; i < posts.size(); ++i)
+    {
+        if (layouts[i])
+        {
+            posts[i]->set_layout(layouts[i]);
+        }
+    }
+}
+
+
+void Thread4chanWidget::prefetch_images()
+{
+    if (!DISPLAY_IMAGES || !posts_vbox || !scroll_panel)
+        return;
+
+    // visible rows of posts vbox
+    int view_top = -scroll_panel->get_scroll_position().y;
+    int view_bottom = view_top + scroll_panel->get_visible_height();
+
+    // posts that are still waiting for their images
+    // but are this far away get cancelled
+    int cancel_dist = IMG_PREFETCH_ROWS * 2 + scroll_panel->get_visible_height();
+
+    std::vector<std::pair<int, Post4chanWidget*>> wanted;
+    std::vector<Post4chanWidget*> pending;
+    int max_pending_dist = -1;
+    bool b_cancel = false;
+
+    for (auto& child : posts_vbox->children)
+    {
+        // virtual posts have nothing to put the images in yet
+        Post4chanWidget* post = dynamic_cast<Post4chanWidget*>(child.get());
+        if (!post || post->is_virtual() || !post->has_unloaded_images())
+            continue;
+
+        int post_top = post->get_inherited_offset().y;
+        int post_bottom = post_top + post->get_size().y;
+
+        // distance from visible part of the thread in rows
+        int dist = 0;
+        if (post_bottom < view_top)
+            dist = view_top - post_bottom;
+        else if (post_top > view_bottom)
+            dist = post_top - view_bottom;
+
+        if (post->images_requested())
+        {
+            pending.push_back(post);
+            if (dist > cancel_dist)
+                b_cancel = true;
+            else
+                max_pending_dist = std::max(max_pending_dist, dist);
+        }
+        else if (dist <= IMG_PREFETCH_ROWS)
+        {
+            wanted.push_back(std::make_pair(dist, post));
+        }
+    }
+
+    std::stable_sort(
+        wanted.begin(),
+        wanted.end(),
+        [](const std::pair<int, Post4chanWidget*>& a,
+           const std::pair<int, Post4chanWidget*>& b) {
+            return a.first < b.first;
+        });
+
+    // requests are run in the order they are queued, so if the
+    // queued requests are stale or further away than new ones,
+    // throw them out and queue everything again by distance
+    if (b_cancel ||
+        (!wanted.empty() && wanted.front().first < max_pending_dist))
+    {
+        THREAD_MAN.kill_jobs(get_img_job_pool_id());
+        for (auto& post : pending)
+            post->cancel_image_requests();
+
+        prefetch_images();
+        return;
+    }
+
+    for (auto& w : wanted)
+    {
+        w.second->request_images(get_img_job_pool_id());
+    }
+}
+
+
+std::shared_ptr<Post4chanWidget> Thread4chanWidget::get_post(int post_num)
+{
+    // called for every post on each update, most of
+    // which are new when a thread is first built
+    auto it = post_map.find(post_num);
+    if (it != post_map.end())
+    {
+        return it->second;
     }
 
     return nullptr;
 }
 
 
-void Thread4chanWidget::add_reply(int post, int reply)
+void Thread4chanWidget::pool_post_tree(std::shared_ptr<post_tree> tree)
 {
-    std::shared_ptr<Post4chanWidget> wgt = get_post(post);
-    if (wgt)
+    if (!tree) return;
+
+    while (post_tree_pool.size() >= POST_TREE_POOL_SIZE)
     {
-        wgt->add_reply(reply);
+        post_tree_pool.erase(post_tree_pool.begin());
     }
+
+    post_tree_pool.push_back(tree);
+}
+
+
+bool Thread4chanWidget::unpool_post_tree(const std::shared_ptr<post_tree>& tree)
+{
+    auto it = std::find(post_tree_pool.begin(), post_tree_pool.end(), tree);
+    if (it == post_tree_pool.end())
+    {
+        return false;
+    }
+
+    post_tree_pool.erase(it);
+    return true;
+}
+
+
+std::shared_ptr<post_tree> Thread4chanWidget::take_post_tree()
+{
+    if (post_tree_pool.empty())
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<post_tree> tree = post_tree_pool.front();
+    post_tree_pool.erase(post_tree_pool.begin());
+    return tree;
 }
 
 
@@ -476,6 +1138,8 @@ bool Thread4chanWidget::receive_img_packet(img_packet& pac)
     std::shared_ptr<Post4chanWidget> post = get_post(pac.post_key);
     if (post)
     {
+        // a post that grows is laid out with the others
+        // the next time the thread is drawn
         return post->add_image(pac, true /* refresh thread if needed */);
     }
 
@@ -494,6 +1158,8 @@ void Thread4chanWidget::on_focus_received()
 
     show();
 
+    THREAD_MAN.move_jobs_to_front(get_img_job_pool_id());
+
     WIDGET_MAN.termbox_clear(COLO.img_artifact_remove);
     WIDGET_MAN.termbox_draw();
     WIDGET_MAN.draw_widgets();
@@ -568,6 +1234,20 @@ bool Thread4chanWidget::handle_key_input(const tb_event& input_event, bool b_bub
         WIDGET_MAN.draw_widgets();
         b_handled = true;
     }
+    // show only the selected post's reply chain, or the whole thread again
+    else if (input_event.key == TB_KEY_CTRL_T)
+    {
+        if (chain_post != -1)
+        {
+            show_reply_chain(-1);
+        }
+        else if (selected_post)
+        {
+            show_reply_chain(selected_post->get_post_num());
+        }
+
+        b_handled = true;
+    }
     // enable or disable auto-update
     else if (input_event.key == TB_KEY_CTRL_A)
     {
@@ -584,9 +1264,9 @@ bool Thread4chanWidget::handle_key_input(const tb_event& input_event, bool b_bub
                 uint32_t time = auto_refresh_counter.count();
                 time /= 1000;
                 time = (auto_refresh_interval.count() / 1000) - time;
-                footer_countdown = L"| Reload in ";
-                footer_countdown += std::to_wstring(time);
-                footer_countdown += L"s";
+                footer_countdown = "| Reload in ";
+                footer_countdown += std::to_string(time);
+                footer_countdown += "s";
                 footer_info->append_text(footer_countdown, true);
             }
             else
@@ -607,16 +1287,39 @@ bool Thread4chanWidget::handle_key_input(const tb_event& input_event, bool b_bub
     else if (input_event.key == TB_KEY_CTRL_X)
     {
         THREAD_MAN.kill_jobs(get_id());
+        THREAD_MAN.kill_jobs(get_img_job_pool_id());
         delete_self();
         return true;
     }
 
-    if (!b_handled)
+    if (!b_handled && scroll_panel)
     {
-        if (scroll_panel)
+        // scrolling is added up until the next frame, which scrolls
+        // and builds the posts scrolled to once for all of it
+        int dist = scroll_panel->get_scroll_dist(input_event);
+        if (dist != 0)
         {
+            pending_scroll += dist;
+            b_handled = true;
+        }
+        else
+        {
+            // home and end go after the scrolling before them
+            if (pending_scroll != 0)
+            {
+                scroll_panel->scroll(pending_scroll);
+                pending_scroll = 0;
+            }
+
             b_handled = scroll_panel->handle_key_input(input_event, false);
         }
+
+        if (b_handled)
+        {
+            b_scroll_pending = true;
+            invalidate_arrange();
+            WIDGET_MAN.draw_widgets();
+        }
     }
 
     return b_handled;
@@ -686,7 +1389,48 @@ void Thread4chanWidget::update_header_info()
                 COLO.thread_header_bg,
                 COLO.thread_saved
             );
+
+        if (chain_post != -1)
+            header_info->append_text(
+                "[Replies: >>" + std::to_string(chain_post) + "]",
+                false,
+                false,
+                false,
+                false,
+                COLO.thread_header_bg,
+                COLO.thread_header_fg
+            );
+    }
+}
+
+
+bool Thread4chanWidget::apply_pending_scroll()
+{
+    if (!b_scroll_pending || !scroll_panel)
+    {
+        return false;
     }
+
+    if (pending_scroll != 0)
+    {
+        scroll_panel->scroll(pending_scroll);
+        pending_scroll = 0;
+    }
+
+    b_scroll_pending = false;
+    update_visible_posts();
+
+    return true;
+}
+
+
+void Thread4chanWidget::arrange()
+{
+    apply_pending_scroll();
+
+    // the boxes have been arranged by the time the thread is, so
+    // this is only what follows the post heights changing
+    prefetch_images();
 }
 
 
@@ -733,11 +1477,56 @@ void Thread4chanWidget::scroll_to_post(int post_num)
         vector2d abs_off = post->get_absolute_offset();
         vector2d posts_off = posts_box->get_inherited_offset();
         scroll_panel->scroll_to(-(abs_off.y - scroll_pos.y - posts_off.y));
+        update_visible_posts();
+        prefetch_images();
         WIDGET_MAN.draw_widgets();
     }
 }
 
 
+void Thread4chanWidget::go_to_post(int post_num)
+{
+    std::shared_ptr<Post4chanWidget> post = get_post(post_num);
+    if (!post) return;
+
+    if (!is_shown(post_num))
+    {
+        show_reply_chain(-1);
+    }
+
+    if (post.get() != selected_post)
+    {
+        select_post(post.get());
+    }
+
+    scroll_to_post(post_num);
+}
+
+
+void Thread4chanWidget::show_reply_chain(int post_num)
+{
+    if (!page_data) return;
+
+    // the post the chain was shown for stays in view
+    int scroll_num = post_num;
+
+    if (post_num == -1)
+    {
+        scroll_num = chain_post;
+        chain_post = -1;
+        reply_chain.clear();
+    }
+    else
+    {
+        chain_post = post_num;
+        reply_chain = page_data->graph.get_chain(post_num);
+    }
+
+    rebuild();
+    scroll_to_post(scroll_num);
+}
+
+
 void Thread4chanWidget::select_post(Post4chanWidget* post)
 {
     if (!post) return;
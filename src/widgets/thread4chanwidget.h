@@ -11,6 +11,7 @@
 
 struct data_4chan;
 class Post4chanWidget;
+struct post_tree;
 class ColorBlockWidget;
 class ScrollPanelWidget;
 class BoxWidget;
@@ -63,10 +64,77 @@ protected:
     bool b_reloading;
     bool b_can_save;
 
+    // generation of the filters the page was parsed with. the
+    // page is parsed again from its saved json when it changes
+    uint32_t filters_generation;
+    void check_filters();
+
+    // a terminal resize is waiting for RESIZE_DEBOUNCE to pass
+    bool b_resize_pending;
+    std::chrono::milliseconds resize_wait;
+    // lays the thread out at the new terminal size, only
+    // rebuilding the posts that are on or near the screen
+    virtual void apply_term_resize();
+
+    // rows scrolled by input since the last frame, and whether there
+    // was any, which arrange() applies once (see handle_key_input)
+    int pending_scroll;
+    bool b_scroll_pending;
+    // scrolls by pending_scroll and builds the posts scrolled
+    // to, returns false if there was no scrolling to do
+    bool apply_pending_scroll();
+    // builds the posts near the screen that are virtual or were built
+    // at another width, and releases the ones far from it, keeping
+    // the rows at the top of the screen in place. returns true if
+    // there were any.
+    bool update_visible_posts();
+    // the thread is long enough for its posts to be virtual
+    bool b_virtual_posts;
+    // children of posts_vbox around the screen the last time
+    // update_visible_posts() ran, which all of the built posts
+    // are in. all of them after posts have been added or removed.
+    size_t posts_window_first;
+    size_t posts_window_last;
+    void reset_posts_window() { posts_window_first = 0; posts_window_last = SIZE_MAX; };
+    // moves the posts and the boxes around them into place, without
+    // building the posts. the posts before first_changed haven't
+    // changed height, and are left where they are.
+    void place_posts(size_t first_changed = 0);
+    // makes the boxes, header and footer the posts are shown in
+    void build_frame();
+
     Post4chanWidget* selected_post;
-    std::wstring footer_countdown;
 
+    // post whose reply chain is shown instead of
+    // the whole thread, -1 if the whole thread is
+    int chain_post;
+    std::set<int> reply_chain;
+    bool is_shown(int post_num) const { return chain_post == -1 || reply_chain.count(post_num) > 0; };
+    std::string footer_countdown;
+
+    // requests the images of posts within IMG_PREFETCH_ROWS
+    // of the visible part of the thread, nearest posts first.
+    // requests that have fallen far behind are cancelled.
+    void prefetch_images();
+    std::string get_img_job_pool_id() const { return get_id() + "#images"; };
+
+    // widgets of released posts, oldest first
+    std::vector<std::shared_ptr<post_tree>> post_tree_pool;
+
+    // lays out the text of new posts on the worker threads
+    // before the posts are built (see post_layout)
+    void layout_posts(const std::vector<std::shared_ptr<Post4chanWidget>>& posts);
+
+    // fills in the header and footer from the op
+    void set_thread_info(const imageboard::post* op);
     void update_header_info();
+
+    // builds only the posts that are new or have changed since the
+    // last update, and takes out the deleted ones
+    virtual void apply_page_data(std::shared_ptr<imageboard::page_data> new_data) override;
+    void update_posts();
+    // drops the posts that aren't in nums
+    void remove_deleted_posts(const std::set<int>& nums);
     void save_to_disk() const;
     void delete_save_file() const;
 
@@ -81,6 +149,12 @@ public:
     virtual bool on_received_update(data_4chan& chan_data) override;
 
     void scroll_to_post(int post_num);
+    // selects the post and scrolls to it, showing the
+    // whole thread if it isn't in the reply chain shown
+    void go_to_post(int post_num);
+    // shows only the posts post_num quotes or is replied to by,
+    // directly or through other posts. -1 shows the whole thread.
+    void show_reply_chain(int post_num);
     void select_post(Post4chanWidget* post);
 
     // updates all widget sizes and redraws,
@@ -89,10 +163,17 @@ public:
 
     std::shared_ptr<Post4chanWidget> get_post(int post_num);
 
+    // keeps the widgets of a released post, dropping the
+    // oldest ones if there are POST_TREE_POOL_SIZE already
+    void pool_post_tree(std::shared_ptr<post_tree> tree);
+    // takes tree back out of the pool, returns false if it isn't in it
+    bool unpool_post_tree(const std::shared_ptr<post_tree>& tree);
+    // the oldest widgets in the pool, nullptr if there are none
+    std::shared_ptr<post_tree> take_post_tree();
+
     std::string get_board() const { return board; };
     std::string get_thread_num_str() const { return thread_num_str; }; 
     void get_thread_key() const { return thread_url; };
-    void add_reply(int post, int reply);
     virtual bool receive_img_packet(img_packet& pac) override;
 
     virtual bool handle_key_input(const tb_event& input_event, bool b_bubble_up = true) override;
@@ -100,6 +181,7 @@ public:
     virtual void on_focus_received();
 
     virtual void rebuild(bool b_rebuild_children = true) override;
+    virtual void arrange() override;
     virtual void child_widget_size_change_event() override;
 
     virtual void draw_children(vector4d constraint = vector4d(-1)) const override;
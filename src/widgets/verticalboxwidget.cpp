@@ -13,6 +13,8 @@
 VerticalBoxWidget::VerticalBoxWidget(bool _b_stretch_offscreen, vector2d _offset, vector4d _padding)
 : MultiChildWidget(_offset, _padding)
 , b_stretch_offscreen(_b_stretch_offscreen)
+, indexed_changes(0)
+, b_fill_children(false)
 {
 }
 
@@ -49,6 +51,8 @@ void VerticalBoxWidget::rebuild(bool b_rebuild_children)
         }
     }
 
+    b_fill_children = fill.size() > 0;
+
     if (fill.size() > 0 && h > fixed_h)
     {
         // divide space up between fill widgets
@@ -80,8 +84,11 @@ void VerticalBoxWidget::rebuild(bool b_rebuild_children)
 
     int width = 0;
     int height = 0;
+    child_tops.clear();
+    child_tops.reserve(children.size() + 1);
     for (auto& child : children)
     {
+        child_tops.push_back(height);
         if (child)
         {
             child->set_inherited_offset(vector2d(0, height));
@@ -95,6 +102,8 @@ void VerticalBoxWidget::rebuild(bool b_rebuild_children)
             height += child->get_size().y + pad.b + pad.d;
         }
     }
+    child_tops.push_back(height);
+    indexed_changes = child_changes;
 
     if (get_h_sizing() == ws_auto)
     {
@@ -164,3 +173,118 @@ vector2d VerticalBoxWidget::size_on_screen() const
     return draw_size;
 }
 
+
+
+void VerticalBoxWidget::update_child_tops(size_t index)
+{
+    // the width of an auto sized box can come from any child
+    if (!has_child_index() || index >= children.size() ||
+        b_fill_children || get_h_sizing() == ws_auto)
+    {
+        rebuild(false);
+        return;
+    }
+
+    int height = child_tops[index];
+    for (size_t i = index; i < children.size(); ++i)
+    {
+        child_tops[i] = height;
+        TermWidget* child = children[i].get();
+        if (child)
+        {
+            child->set_inherited_offset(vector2d(0, height));
+
+            vector4d pad = child->get_padding();
+            height += child->get_size().y + pad.b + pad.d;
+        }
+    }
+    child_tops.back() = height;
+
+    set_size(get_width_constraint(), height);
+}
+
+
+int VerticalBoxWidget::child_index_at(int y) const
+{
+    if (!has_child_index() || children.empty()) return -1;
+
+    // last child starting at or above y
+    auto it = std::upper_bound(child_tops.begin(), child_tops.end() - 1, y);
+    if (it == child_tops.begin()) return 0;
+
+    return (it - child_tops.begin()) - 1;
+}
+
+
+void VerticalBoxWidget::draw_children(vector4d constraint) const
+{
+    if (!has_child_index() || constraint.c == -1 || constraint.d == -1)
+    {
+        MultiChildWidget::draw_children(constraint);
+        return;
+    }
+
+    // rows of the box that are visible
+    int top = constraint.c - get_absolute_offset().y;
+    int bottom = constraint.d - get_absolute_offset().y;
+
+    int first = child_index_at(top);
+    int last = child_index_at(bottom - 1) + 1;
+
+    // the ones that have been scrolled off screen since,
+    // if they're still in the box
+    for (auto& w : drawn)
+    {
+        std::shared_ptr<TermWidget> child = w.lock();
+        if (!child) continue;
+
+        int i = child_index_at(child->get_inherited_offset().y);
+        if ((i < first || i >= last) && children[i] == child)
+        {
+            child->draw(constraint, true);
+        }
+    }
+
+    drawn.clear();
+    for (int i = first; i < last; ++i)
+    {
+        if (children[i])
+        {
+            children[i]->draw(constraint, true);
+            drawn.push_back(children[i]);
+        }
+    }
+}
+
+
+TermWidget* VerticalBoxWidget::get_topmost_child_at(vector2d coord)
+{
+    if (!has_child_index())
+    {
+        return MultiChildWidget::get_topmost_child_at(coord);
+    }
+
+    // click within box
+    vector2d abs = get_absolute_offset();
+    vector2d dim = get_size();
+    if (abs.x <= coord.x && abs.y <= coord.y &&
+        abs.x + dim.x > coord.x && abs.y + dim.y > coord.y)
+    {
+        // only one child can be at a row
+        int i = child_index_at(coord.y - abs.y);
+        if (i != -1 && children[i])
+        {
+            abs = children[i]->get_absolute_offset();
+            dim = children[i]->get_size();
+            if (abs.x <= coord.x && abs.y <= coord.y &&
+                abs.x + dim.x > coord.x && abs.y + dim.y > coord.y)
+            {
+                return children[i]->get_topmost_child_at(coord);
+            }
+        }
+
+        return this;
+    }
+
+    return nullptr;
+}
@@ -22,6 +22,19 @@ public:
     virtual void set_managed_sizing(std::shared_ptr<TermWidget> wgt) override;
     virtual vector2d get_child_widget_size() const override;
     virtual vector2d size_on_screen() const override;
+    virtual void draw_children(vector4d constraint = vector4d(-1)) const override;
+    virtual TermWidget* get_topmost_child_at(vector2d coord) override;
+
+    // false if children have been added or removed since the
+    // box was last rebuilt, and the child index is out of date
+    bool has_child_index() const { return indexed_changes == child_changes && child_tops.size() == children.size() + 1; };
+    // index of the child at row y of the box (clamped to the
+    // first and last child), or -1 if there is no child index
+    int child_index_at(int y) const;
+    // moves the children after the child at index to follow a change
+    // in its height, leaving the ones before it where they are. the
+    // box is rebuilt instead if the child index is out of date.
+    void update_child_tops(size_t index);
 
 
 protected:
@@ -29,5 +42,17 @@ protected:
 
     bool b_stretch_offscreen;
 
+    // row of the box each child starts at, and its height at the end,
+    // so the children at a row are found with a binary search
+    std::vector<int> child_tops;
+    // child_changes when child_tops was made
+    size_t indexed_changes;
+    // some children share out the height of the box (ws_fill_managed),
+    // so any of them changing moves the others
+    bool b_fill_children;
+    // children drawn last time, which are drawn again even if they're
+    // off screen now so that their images are cleared
+    mutable std::vector<std::weak_ptr<TermWidget>> drawn;
+
 };
 
@@ -18,6 +18,9 @@ WrapGrid::WrapGrid(
 )
 : TermWidget(_offset, _padding, _child_padding)
 , slot_size(_slot_size)
+, child_changes(0)
+, slots_per_row(0)
+, indexed_changes(0)
 {
     set_h_sizing(ws_fill);
 }
@@ -40,6 +43,7 @@ void WrapGrid::rebuild(bool b_rebuild_children)
     int width = 0;
     int largest_width = 0;
     int height = 0;
+    slots_per_row = 0;
     for (auto& child : children)
     {
         if (child)
@@ -50,6 +54,11 @@ void WrapGrid::rebuild(bool b_rebuild_children)
                 height += slot_size.y;
             }
 
+            if (height == 0)
+            {
+                ++slots_per_row;
+            }
+
             child->set_inherited_offset(vector2d(width, height));
             width += slot_size.x;
             if (width > largest_width)
@@ -59,6 +68,8 @@ void WrapGrid::rebuild(bool b_rebuild_children)
         }
     }
 
+    indexed_changes = child_changes;
+
     set_size(largest_width, height + slot_size.y);
 }
 
@@ -74,6 +85,7 @@ void WrapGrid::add_child_widget(std::shared_ptr<TermWidget> child_widget, bool b
 
         children.push_back(child_widget);
         child_widget->set_parent_widget(this);
+        ++child_changes;
         child_widget->update_size();
 
         if (b_rebuild)
@@ -84,6 +96,87 @@ void WrapGrid::add_child_widget(std::shared_ptr<TermWidget> child_widget, bool b
 }
 
 
+void WrapGrid::insert_child_widget(size_t index, std::shared_ptr<TermWidget> child_widget, bool b_rebuild)
+{
+    if (index >= children.size())
+    {
+        add_child_widget(child_widget, b_rebuild);
+        return;
+    }
+
+    if (child_widget)
+    {
+        child_widget->set_h_sizing(ws_fixed);
+        child_widget->set_v_sizing(ws_fixed);
+        child_widget->set_size(slot_size);
+
+        children.insert(children.begin() + index, child_widget);
+        child_widget->set_parent_widget(this);
+        ++child_changes;
+        child_widget->update_size();
+
+        if (b_rebuild)
+        {
+            rebuild();
+        }
+    }
+}
+
+
+void WrapGrid::remove_child_widget(TermWidget* child_widget, bool b_rebuild)
+{
+    auto it = std::find_if(
+        children.begin(),
+        children.end(),
+        [child_widget](const std::shared_ptr<TermWidget>& child) {
+            return child.get() == child_widget;
+        });
+
+    if (it != children.end())
+    {
+        if ((*it)->get_parent_widget() == this)
+        {
+            (*it)->set_parent_widget(nullptr);
+        }
+
+        children.erase(it);
+        ++child_changes;
+
+        if (b_rebuild)
+        {
+            rebuild();
+        }
+    }
+}
+
+
+void WrapGrid::clear_children()
+{
+    for (auto& child : children)
+    {
+        if (child && child->get_parent_widget() == this)
+        {
+            child->set_parent_widget(nullptr);
+        }
+    }
+
+    children.clear();
+    ++child_changes;
+}
+
+
+void WrapGrid::for_each_child(const std::function<void(TermWidget*)>& fn)
+{
+    for (auto& child : children)
+    {
+        if (child)
+        {
+            fn(child.get());
+        }
+    }
+}
+
+
 TermWidget* WrapGrid::get_topmost_child_at(vector2d coord)
 {
     // click within box
@@ -92,6 +185,25 @@ TermWidget* WrapGrid::get_topmost_child_at(vector2d coord)
     if (abs.x <= coord.x && abs.y <= coord.y &&
         abs.x + dim.x > coord.x && abs.y + dim.y > coord.y)
     {
+        // the slot the click is in
+        if (has_child_index() && !children.empty() && children[0])
+        {
+            vector2d origin = children[0]->get_absolute_offset();
+            int i = child_index_at(coord - origin);
+            if (i != -1 && children[i])
+            {
+                abs = children[i]->get_absolute_offset();
+                dim = children[i]->get_size();
+                if (abs.x <= coord.x && abs.y <= coord.y &&
+                    abs.x + dim.x > coord.x && abs.y + dim.y > coord.y)
+                {
+                    return children[i]->get_topmost_child_at(coord);
+                }
+            }
+
+            return this;
+        }
+
         // click within child
         for (auto& child : children)
         {
@@ -109,6 +221,8 @@ TermWidget* WrapGrid::get_topmost_child_at(vector2d coord)
 
         return this;
     }
+
+    return nullptr;
 }
 
 
@@ -118,15 +232,64 @@ void WrapGrid::child_widget_size_change_event()
 }
 
 
+int WrapGrid::child_index_at(vector2d coord) const
+{
+    if (!has_child_index() || coord.x < 0 || coord.y < 0) return -1;
+
+    int col = coord.x / slot_size.x;
+    if (col >= slots_per_row) return -1;
+
+    size_t i = (coord.y / slot_size.y) * slots_per_row + col;
+    return i < children.size() ? i : -1;
+}
+
+
 void WrapGrid::draw_children(vector4d constraint) const
 {
-    for (const auto& child : children)
+    if (!has_child_index() || children.empty() || !children[0] ||
+        constraint.c == -1 || constraint.d == -1)
     {
-        if (child)
+        for (const auto& child : children)
+        {
+            if (child)
+            {
+                child->draw(constraint);
+            }
+        }
+        return;
+    }
+
+    // the rows of slots that are visible
+    int origin = children[0]->get_absolute_offset().y;
+    int first_row = std::max(0, (constraint.c - origin) / slot_size.y);
+    int last_row = std::max(0, (constraint.d - 1 - origin) / slot_size.y);
+    size_t first = std::min(children.size(), (size_t)(first_row * slots_per_row));
+    size_t last = std::min(children.size(), (size_t)((last_row + 1) * slots_per_row));
+
+    // the ones that have been scrolled off screen since,
+    // if they're still in the grid
+    for (auto& w : drawn)
+    {
+        std::shared_ptr<TermWidget> child = w.lock();
+        if (!child) continue;
+
+        vector2d off = child->get_inherited_offset();
+        int i = child_index_at(off);
+        if (i != -1 && ((size_t)i < first || (size_t)i >= last) && children[i] == child)
         {
             child->draw(constraint);
         }
     }
+
+    drawn.clear();
+    for (size_t i = first; i < last; ++i)
+    {
+        if (children[i])
+        {
+            children[i]->draw(constraint);
+            drawn.push_back(children[i]);
+        }
+    }
 }
 
 
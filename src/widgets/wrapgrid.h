@@ -25,11 +25,16 @@ public:
     virtual void rebuild(bool b_rebuild_children = true) override;
     virtual void child_widget_size_change_event() override;
     void add_child_widget(std::shared_ptr<TermWidget> child_widget, bool b_rebuild);
+    void insert_child_widget(size_t index, std::shared_ptr<TermWidget> child_widget, bool b_rebuild);
+    void remove_child_widget(TermWidget* child_widget, bool b_rebuild);
+    void clear_children();
+    const std::vector<std::shared_ptr<TermWidget>>& get_children() const { return children; };
     virtual void draw_children(vector4d constraint = vector4d(-1)) const override;
 
     virtual vector2d get_child_widget_size() const override;
     virtual void update_child_size(bool b_recursive = false) override;
     virtual TermWidget* get_topmost_child_at(vector2d coord) override;
+    virtual void for_each_child(const std::function<void(TermWidget*)>& fn) override;
 
     virtual vector2d size_on_screen() const override;
 
@@ -38,6 +43,23 @@ protected:
     std::vector<std::shared_ptr<TermWidget>> children;
     vector2d slot_size;
 
+    // goes up each time children are added or removed
+    size_t child_changes;
+
+    // the slots are all the same size, so the child at a cell is
+    // found from its row and column. set by rebuild(), and out of
+    // date if children have been added or removed since.
+    int slots_per_row;
+    size_t indexed_changes;
+    bool has_child_index() const { return slots_per_row > 0 && indexed_changes == child_changes; };
+    // index of the child in the slot at coord, which is relative
+    // to the first slot, or -1 if there is none
+    int child_index_at(vector2d coord) const;
+
+    // children drawn last time, which are drawn again even if they're
+    // off screen now so that their images are cleared
+    mutable std::vector<std::weak_ptr<TermWidget>> drawn;
+
 
 };
 